@@ -0,0 +1,219 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "FastSeek.h"
+
+#if !FF_USE_FASTSEEK
+#error "FastSeek requires FF_USE_FASTSEEK in the ffconf.h"
+#endif
+
+#if FF_MAX_SS == FF_MIN_SS
+#define FAST_SEEK_SS(fs)    ((FSIZE_t)FF_MAX_SS)
+#else
+#define FAST_SEEK_SS(fs)    ((FSIZE_t)(fs)->ssize)
+#endif
+
+static FastSeekEntry *fastSeekFind(FastSeekH *handler, FIL *fp)
+{
+    for (uint32_t k = 0; k < FAST_SEEK_MAX_FILES; k++) {
+        if (handler->entries[k].fp == fp) {
+            return &handler->entries[k];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Drop the table of the entry and move the tables above it down, so the free
+ * space of the arena is always the one block at the arena tail
+ */
+static void fastSeekDrop(FastSeekH *handler, FastSeekEntry *entry)
+{
+    uint32_t offset = entry->offset;
+    uint32_t size = entry->size;
+
+    entry->fp->cltbl = NULL;
+    entry->fp = NULL;
+    memmove(&handler->arena[offset], &handler->arena[offset + size],
+            (handler->used - offset - size) * sizeof(DWORD));
+    handler->used -= size;
+    for (uint32_t k = 0; k < FAST_SEEK_MAX_FILES; k++) {
+        if (handler->entries[k].fp != NULL && handler->entries[k].offset > offset) {
+            handler->entries[k].offset -= size;
+            handler->entries[k].fp->cltbl = &handler->arena[handler->entries[k].offset];
+        }
+    }
+}
+
+static bool fastSeekDropLru(FastSeekH *handler, FIL *keep)
+{
+    FastSeekEntry *lru = NULL;
+
+    for (uint32_t k = 0; k < FAST_SEEK_MAX_FILES; k++) {
+        FastSeekEntry *entry = &handler->entries[k];
+        if (entry->fp == NULL || entry->fp == keep) {
+            continue;
+        }
+        if (lru == NULL || (int32_t)(entry->lastUse - lru->lastUse) < 0) {
+            lru = entry;
+        }
+    }
+    if (lru == NULL) {
+        return false;
+    }
+    fastSeekDrop(handler, lru);
+
+    return true;
+}
+
+/*
+ * Build the table of the file in the free tail of the arena. The FatFs returns
+ * FR_NOT_ENOUGH_CORE and the required size in tbl[0] if the table does not fit,
+ * then the least recently used tables are dropped until it fits
+ */
+static FRESULT fastSeekBuild(FastSeekH *handler, FastSeekEntry *entry, FIL *fp)
+{
+    FRESULT result;
+    DWORD *tbl;
+    FSIZE_t clusters = 0;
+
+    for (;;) {
+        uint32_t freeSize = handler->arenaSize - handler->used;
+
+        tbl = &handler->arena[handler->used];
+        if (freeSize >= 4) {
+            tbl[0] = freeSize;
+            fp->cltbl = tbl;
+            result = f_lseek(fp, CREATE_LINKMAP);
+            if (result == FR_OK) {
+                break;
+            }
+            fp->cltbl = NULL;
+            if (result != FR_NOT_ENOUGH_CORE) {
+                return result;
+            }
+            if (tbl[0] > handler->arenaSize) {
+                return FR_NOT_ENOUGH_CORE;
+            }
+        }
+        if (!fastSeekDropLru(handler, fp)) {
+            return FR_NOT_ENOUGH_CORE;
+        }
+    }
+    for (DWORD *item = &tbl[1]; *item != 0; item += 2) {
+        clusters += *item;
+    }
+    entry->fp = fp;
+    entry->offset = handler->used;
+    entry->size = tbl[0];
+    entry->mapSize = clusters * fp->obj.fs->csize * FAST_SEEK_SS(fp->obj.fs);
+    entry->lastUse = ++handler->useCnt;
+    handler->used += tbl[0];
+
+    return FR_OK;
+}
+
+FRESULT fastSeekInit(FastSeekH *handler, DWORD *arena, uint32_t arenaSize)
+{
+    if (handler == NULL || arena == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    memset(handler, 0, sizeof(FastSeekH));
+    handler->arena = arena;
+    handler->arenaSize = arenaSize;
+
+    return FR_OK;
+}
+
+FRESULT fastSeekAttach(FastSeekH *handler, FIL *fp)
+{
+    FastSeekEntry *entry;
+
+    if (handler == NULL || fp == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    entry = fastSeekFind(handler, fp);
+    if (entry != NULL) {
+        fastSeekDrop(handler, entry);
+    } else {
+        entry = fastSeekFind(handler, NULL);
+        if (entry == NULL) {
+            if (!fastSeekDropLru(handler, fp)) {
+                return FR_NOT_ENOUGH_CORE;
+            }
+            entry = fastSeekFind(handler, NULL);
+        }
+    }
+
+    return fastSeekBuild(handler, entry, fp);
+}
+
+FRESULT fastSeekDetach(FastSeekH *handler, FIL *fp)
+{
+    FastSeekEntry *entry;
+
+    if (handler == NULL || fp == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    entry = fastSeekFind(handler, fp);
+    if (entry != NULL) {
+        fastSeekDrop(handler, entry);
+    }
+
+    return FR_OK;
+}
+
+FRESULT fastSeekLseek(FastSeekH *handler, FIL *fp, FSIZE_t ofs)
+{
+    FastSeekEntry *entry;
+    FRESULT result;
+
+    if (handler == NULL || fp == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    entry = fastSeekFind(handler, fp);
+    if (entry == NULL) {
+        return f_lseek(fp, ofs);
+    }
+    entry->lastUse = ++handler->useCnt;
+    if (ofs <= f_size(fp)) {
+        return f_lseek(fp, ofs);
+    }
+    // In the fast seek mode the f_lseek does not expand the file
+    fp->cltbl = NULL;
+    result = f_lseek(fp, ofs);
+    fp->cltbl = &handler->arena[entry->offset];
+    if (result == FR_OK) {
+        result = fastSeekAttach(handler, fp);
+    }
+
+    return result;
+}
+
+FRESULT fastSeekWrite(FastSeekH *handler, FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+    FastSeekEntry *entry;
+    FRESULT result;
+
+    if (handler == NULL || fp == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    entry = fastSeekFind(handler, fp);
+    if (entry == NULL) {
+        return f_write(fp, buff, btw, bw);
+    }
+    entry->lastUse = ++handler->useCnt;
+    if (f_tell(fp) + btw <= entry->mapSize) {
+        return f_write(fp, buff, btw, bw);
+    }
+    // In the fast seek mode the f_write does not allocate the new clusters
+    fp->cltbl = NULL;
+    result = f_write(fp, buff, btw, bw);
+    fp->cltbl = &handler->arena[entry->offset];
+    if (result == FR_OK) {
+        result = fastSeekAttach(handler, fp);
+    }
+
+    return result;
+}
@@ -0,0 +1,70 @@
+#ifndef __FAST_SEEK_H__
+#define __FAST_SEEK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ff.h"
+
+/*
+ * The cluster link map tables (CLMT) of the hot files in the one bounded arena.
+ * With the CLMT the f_lseek / f_read of the file convert the file offset to the
+ * cluster without the FAT chain walk. If the arena is full, the map of the least
+ * recently used file is dropped, the file works in the normal seek mode.
+ * The handler is not thread safe, the files of the one arena are used by the one task.
+ */
+
+#define FAST_SEEK_MAX_FILES    8
+
+typedef struct {
+    FIL *fp;
+    uint32_t offset;    // the table position in the arena
+    uint32_t size;      // the table size in DWORD items
+    FSIZE_t mapSize;    // the file bytes covered by the mapped clusters
+    uint32_t lastUse;
+} FastSeekEntry;
+
+typedef struct {
+    DWORD *arena;
+    uint32_t arenaSize;  // in DWORD items
+    uint32_t used;
+    uint32_t useCnt;
+    FastSeekEntry entries[FAST_SEEK_MAX_FILES];
+} FastSeekH;
+
+/**
+ * @brief Init the arena for the link map tables
+ * @param[in,out] handler - the fast seek handler
+ * @param[in] arena - the arena memory
+ * @param[in] arenaSize - the arena size in DWORD items
+ */
+FRESULT fastSeekInit(FastSeekH *handler, DWORD *arena, uint32_t arenaSize);
+
+/**
+ * @brief Build the link map table of the open file and switch the file to the fast seek mode.
+ *        The least recently used maps are dropped if the arena is full
+ * @param[in,out] handler - the fast seek handler
+ * @param[in] fp - the open file
+ * @return FR_NOT_ENOUGH_CORE if the map is bigger than the arena
+ */
+FRESULT fastSeekAttach(FastSeekH *handler, FIL *fp);
+
+/**
+ * @brief Drop the link map table of the file, must be called before f_close
+ * @param[in,out] handler - the fast seek handler
+ * @param[in] fp - the file
+ */
+FRESULT fastSeekDetach(FastSeekH *handler, FIL *fp);
+
+/**
+ * @brief f_lseek of the file, mark the file map as recently used
+ */
+FRESULT fastSeekLseek(FastSeekH *handler, FIL *fp, FSIZE_t ofs);
+
+/**
+ * @brief f_write of the file. The write beyond the mapped clusters is done in the normal mode
+ *        and the map is rebuilt for the grown file
+ */
+FRESULT fastSeekWrite(FastSeekH *handler, FIL *fp, const void *buff, UINT btw, UINT *bw);
+
+#endif
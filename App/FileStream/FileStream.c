@@ -0,0 +1,94 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "FileStream.h"
+
+#if FF_MAX_SS == FF_MIN_SS
+#define FILE_STREAM_SS(fs)    ((FSIZE_t)FF_MAX_SS)
+#else
+#define FILE_STREAM_SS(fs)    ((FSIZE_t)(fs)->ssize)
+#endif
+
+static void fileStreamWaitSink(FileStreamH *handler)
+{
+    while (handler->sinkBusy) {
+        if (handler->sink.sinkWait != NULL) {
+            handler->sink.sinkWait();
+        }
+    }
+}
+
+static bool fileStreamStartSink(FileStreamH *handler, const uint8_t *data, uint32_t size)
+{
+    // The busy flag is set before the start, so the done of the short transmit is not lost
+    handler->sinkBusy = true;
+    if (!handler->sink.sinkStart(data, size)) {
+        handler->sinkBusy = false;
+        return false;
+    }
+
+    return true;
+}
+
+FRESULT fileStreamInit(FileStreamH *handler, const FileStreamSink *sink)
+{
+    if (handler == NULL || sink == NULL || sink->sinkStart == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    memset(handler, 0, sizeof(FileStreamH));
+    handler->sink = *sink;
+
+    return FR_OK;
+}
+
+FRESULT fileStreamSend(FileStreamH *handler, FIL *fp, FSIZE_t size, FSIZE_t *sent)
+{
+    FSIZE_t sectorSize;
+    uint32_t index = 0;
+    UINT chunk;
+    UINT br;
+    FRESULT result = FR_OK;
+
+    if (handler == NULL || fp == NULL || sent == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    *sent = 0;
+    if (size > f_size(fp) - f_tell(fp)) {
+        size = f_size(fp) - f_tell(fp);
+    }
+    sectorSize = FILE_STREAM_SS(fp->obj.fs);
+    // The f_read of the whole sectors reads to the stream buffer directly, the transmit of the previous
+    // buffer is in progress. The chunk ends on the sector boundary, so only the not full sectors of the start
+    // and the end of the range are copied from the file sector buffer. The sink never reads the file sector
+    // buffer, the buffer pool can give it to the other file during the transmit
+    while (result == FR_OK && size != 0) {
+        chunk = sizeof(handler->buff[0]) - (UINT)(f_tell(fp) % sectorSize);
+        if (size < chunk) {
+            chunk = (UINT)size;
+        }
+        result = f_read(fp, handler->buff[index], chunk, &br);
+        if (result == FR_OK && br != chunk) {
+            result = FR_INT_ERR;
+        }
+        fileStreamWaitSink(handler);
+        if (result != FR_OK) {
+            break;
+        }
+        if (!fileStreamStartSink(handler, handler->buff[index], chunk)) {
+            result = FR_INT_ERR;
+            break;
+        }
+        *sent += chunk;
+        size -= chunk;
+        index ^= 1;
+    }
+    fileStreamWaitSink(handler);
+
+    return result;
+}
+
+void fileStreamSinkDone(FileStreamH *handler)
+{
+    handler->sinkBusy = false;
+}
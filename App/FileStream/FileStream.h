@@ -0,0 +1,55 @@
+#ifndef __FILE_STREAM_H__
+#define __FILE_STREAM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ff.h"
+
+/*
+ * The file transmit by the DMA sink, for example the CRSF USART TX DMA stream of
+ * the BSP.h. The whole sectors of the file are read by the multi-block disk_read
+ * straight to the one of the two stream buffers while the other one is transmitted.
+ * The not full sectors of the start and the end of the range are copied to the
+ * stream buffer from the file sector buffer. The data of the sink is in the stream
+ * handler, it is valid up to the fileStreamSinkDone call. The streams of the
+ * several handlers are independent.
+ */
+
+// The size of the one of the two stream buffers, 4 KB
+#define FILE_STREAM_BUFF_SECTORS    ((4096 + FF_MAX_SS - 1) / FF_MAX_SS)
+
+typedef struct {
+    bool (*sinkStart)(const uint8_t *data, uint32_t size);  // start the transmit, false - the sink error
+    void (*sinkWait)(void);            // called while the transmit is in progress, NULL - the busy loop
+} FileStreamSink;
+
+typedef struct {
+    FileStreamSink sink;
+    volatile bool sinkBusy;
+    uint8_t buff[2][FILE_STREAM_BUFF_SECTORS * FF_MAX_SS];
+} FileStreamH;
+
+/**
+ * @brief Init the stream handler
+ * @param[out] handler - the stream handler
+ * @param[in] sink - the transmit callbacks
+ */
+FRESULT fileStreamInit(FileStreamH *handler, const FileStreamSink *sink);
+
+/**
+ * @brief Transmit the file data from the file pointer. The function returns after the end of
+ *        the last transmit
+ * @param[in] fp - the file opened for the read
+ * @param[in] size - the bytes to send, clipped by the file size
+ * @param[out] sent - the sent bytes
+ * @return FR_INT_ERR if the sink start fails
+ */
+FRESULT fileStreamSend(FileStreamH *handler, FIL *fp, FSIZE_t size, FSIZE_t *sent);
+
+/**
+ * @brief The transmit complete of the sink, called from the DMA interrupt
+ */
+void fileStreamSinkDone(FileStreamH *handler);
+
+#endif
@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "LazySync.h"
+
+#if !FF_USE_EXPAND
+#error "LazySync requires FF_USE_EXPAND in the ffconf.h"
+#endif
+
+#if FF_MAX_SS == FF_MIN_SS
+#define LAZY_SYNC_SS(fs)    ((FSIZE_t)FF_MAX_SS)
+#else
+#define LAZY_SYNC_SS(fs)    ((FSIZE_t)(fs)->ssize)
+#endif
+
+static FSIZE_t lazySyncClusterSize(FIL *fp)
+{
+    return (FSIZE_t)fp->obj.fs->csize * LAZY_SYNC_SS(fp->obj.fs);
+}
+
+/*
+ * Allocate the next extent by the f_lseek beyond the file end. The file pointer
+ * is on the cluster boundary, so the f_lseek does not touch the sector buffer and
+ * the file pointer, the current cluster and the file size are restored after it
+ */
+static FRESULT lazySyncExtend(LazySyncH *handler)
+{
+    FIL *fp = handler->fp;
+    FSIZE_t fptr = fp->fptr;
+    DWORD clust = fp->clust;
+    FSIZE_t size = f_size(fp);
+    FRESULT result;
+    FRESULT restored;
+
+    result = f_lseek(fp, handler->allocated + handler->config.extentClusters * lazySyncClusterSize(fp));
+    if (result == FR_OK) {
+        handler->allocated = fp->fptr;
+    }
+    fp->fptr = fptr;
+    fp->clust = clust;
+    restored = f_setsize(fp, size);
+
+    return result != FR_OK ? result : restored;
+}
+
+/*
+ * The exFAT file without the FAT chain has the clusters of its size only, so the
+ * file size covers the whole allocated extent while the f_write follows the chain
+ */
+static FRESULT lazySyncFileWrite(LazySyncH *handler, const void *buff, UINT btw, UINT *bw)
+{
+#if FF_FS_EXFAT
+    FIL *fp = handler->fp;
+    FSIZE_t size = f_size(fp);
+    FRESULT result;
+
+    if (fp->obj.fs->fs_type == FS_EXFAT) {
+        result = f_setsize(fp, handler->allocated);
+        if (result == FR_OK) {
+            result = f_write(fp, buff, btw, bw);
+        }
+        f_setsize(fp, f_tell(fp) > size ? f_tell(fp) : size);
+        return result;
+    }
+#endif
+
+    return f_write(handler->fp, buff, btw, bw);
+}
+
+FRESULT lazySyncInit(LazySyncH *handler, FIL *fp, const LazySyncConfig *config)
+{
+    FSIZE_t clusterSize;
+
+    if (handler == NULL || fp == NULL || config == NULL || config->extentClusters == 0
+        || (config->syncIntervalMs != 0 && config->getTimeMs == NULL)) {
+        return FR_INVALID_PARAMETER;
+    }
+    memset(handler, 0, sizeof(LazySyncH));
+    handler->fp = fp;
+    handler->config = *config;
+    clusterSize = lazySyncClusterSize(fp);
+    handler->allocated = (f_size(fp) + clusterSize - 1) / clusterSize * clusterSize;
+    if (config->getTimeMs != NULL) {
+        handler->lastSyncMs = config->getTimeMs();
+    }
+
+    return FR_OK;
+}
+
+FRESULT lazySyncWrite(LazySyncH *handler, const void *buff, UINT btw, UINT *bw)
+{
+    const BYTE *data = buff;
+    FRESULT result = FR_OK;
+    UINT chunk;
+    UINT written;
+
+    if (handler == NULL || buff == NULL || bw == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    *bw = 0;
+    while (btw != 0) {
+        if (f_tell(handler->fp) == handler->allocated) {
+            result = lazySyncExtend(handler);
+            if (result != FR_OK || f_tell(handler->fp) == handler->allocated) {
+                break;  // the disk is full
+            }
+        }
+        chunk = handler->allocated - f_tell(handler->fp) < btw
+                ? (UINT)(handler->allocated - f_tell(handler->fp)) : btw;
+        result = lazySyncFileWrite(handler, data, chunk, &written);
+        *bw += written;
+        handler->notSynced += written;
+        if (result != FR_OK || written != chunk) {
+            break;
+        }
+        data += chunk;
+        btw -= chunk;
+    }
+    if (result != FR_OK) {
+        return result;
+    }
+    if ((handler->config.syncBytes != 0 && handler->notSynced >= handler->config.syncBytes)
+        || (handler->config.syncIntervalMs != 0
+            && handler->config.getTimeMs() - handler->lastSyncMs >= handler->config.syncIntervalMs)) {
+        result = lazySyncFlush(handler);
+    }
+
+    return result;
+}
+
+FRESULT lazySyncFlush(LazySyncH *handler)
+{
+    if (handler == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    handler->notSynced = 0;
+    if (handler->config.getTimeMs != NULL) {
+        handler->lastSyncMs = handler->config.getTimeMs();
+    }
+
+    return f_sync(handler->fp);
+}
+
+FRESULT lazySyncClose(LazySyncH *handler)
+{
+    FIL *fp;
+    FSIZE_t size;
+    FRESULT result = FR_OK;
+
+    if (handler == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    fp = handler->fp;
+    size = f_size(fp);
+    // The f_truncate removes the chain after the file pointer of the whole allocated file
+    if (handler->allocated > size) {
+        if (f_tell(fp) != size) {
+            result = f_lseek(fp, size);
+        }
+        if (result == FR_OK) {
+            result = f_setsize(fp, handler->allocated);
+        }
+        if (result == FR_OK) {
+            result = f_truncate(fp);
+        }
+    }
+    if (result == FR_OK) {
+        result = f_close(fp);
+    }
+
+    return result;
+}
@@ -0,0 +1,55 @@
+#ifndef __LAZY_SYNC_H__
+#define __LAZY_SYNC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ff.h"
+
+/*
+ * The appends to the growing file with the lazy metadata sync. The clusters are
+ * allocated by the extents of the several clusters at once, the FAT and the
+ * directory entry changes stay in the FatFs window buffer and are written by the
+ * f_sync only on the sync interval, on the sync bytes threshold or by the
+ * explicit sync. The not used clusters of the last extent are freed on the close.
+ */
+
+typedef struct {
+    uint32_t extentClusters;           // the clusters allocated at once
+    uint32_t syncIntervalMs;           // 0 - no sync by time
+    uint32_t syncBytes;                // 0 - no sync by the written bytes
+    uint32_t (*getTimeMs)(void);       // required for the sync by time
+} LazySyncConfig;
+
+typedef struct {
+    FIL *fp;
+    LazySyncConfig config;
+    FSIZE_t allocated;                 // the file bytes covered by the cluster chain
+    uint32_t notSynced;
+    uint32_t lastSyncMs;
+} LazySyncH;
+
+/**
+ * @brief Start the lazy sync mode of the open file
+ * @param[out] handler - the lazy sync handler
+ * @param[in] fp - the file opened for the write
+ * @param[in] config - the extent size and the sync conditions
+ */
+FRESULT lazySyncInit(LazySyncH *handler, FIL *fp, const LazySyncConfig *config);
+
+/**
+ * @brief f_write of the file, the sync is done if the sync condition is met
+ */
+FRESULT lazySyncWrite(LazySyncH *handler, const void *buff, UINT btw, UINT *bw);
+
+/**
+ * @brief Write the FAT and the directory entry changes of the file
+ */
+FRESULT lazySyncFlush(LazySyncH *handler);
+
+/**
+ * @brief Free the not used clusters of the last extent and close the file
+ */
+FRESULT lazySyncClose(LazySyncH *handler);
+
+#endif
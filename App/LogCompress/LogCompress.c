@@ -0,0 +1,312 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "LogCompress.h"
+
+// The LZ4 block format limits
+#define LOG_COMPRESS_MIN_MATCH      4
+#define LOG_COMPRESS_LAST_LITERALS  5           // the block ends by the literals
+#define LOG_COMPRESS_MF_LIMIT       12          // the last match starts before it
+#define LOG_COMPRESS_RUN_MASK       15
+// The search step grows by the 64 missed searches, the not compressible data is skipped faster
+#define LOG_COMPRESS_SKIP_TRIGGER   6
+
+// The unaligned word access of the Cortex-M4
+static uint32_t logCompressRead32(const uint8_t *data)
+{
+    uint32_t value;
+
+    memcpy(&value, data, sizeof(value));
+
+    return value;
+}
+
+static uint32_t logCompressHash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - LOG_COMPRESS_HASH_LOG);
+}
+
+// The length bytes after the token of the length from 15
+static uint8_t *logCompressLength(uint8_t *dst, uint32_t length)
+{
+    for (length -= LOG_COMPRESS_RUN_MASK; length >= 255; length -= 255) {
+        *dst++ = 255;
+    }
+    *dst++ = (uint8_t)length;
+
+    return dst;
+}
+
+/*
+ * The sequence of the literals and the match, the match length 0 is the last literals. The
+ * worst size of the length bytes is checked before the write
+ */
+static uint8_t *logCompressSequence(uint8_t *dst, const uint8_t *dstEnd, const uint8_t *literals,
+                                    uint32_t literalLength, uint32_t offset, uint32_t matchLength)
+{
+    uint8_t *token = dst;
+
+    if ((uint32_t)(dstEnd - dst) < 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1) {
+        return NULL;
+    }
+    dst++;
+    *token = (literalLength < LOG_COMPRESS_RUN_MASK ? literalLength : LOG_COMPRESS_RUN_MASK) << 4;
+    if (literalLength >= LOG_COMPRESS_RUN_MASK) {
+        dst = logCompressLength(dst, literalLength);
+    }
+    memcpy(dst, literals, literalLength);
+    dst += literalLength;
+    if (matchLength == 0) {
+        return dst;
+    }
+    *dst++ = (uint8_t)offset;
+    *dst++ = (uint8_t)(offset >> 8);
+    matchLength -= LOG_COMPRESS_MIN_MATCH;
+    *token |= matchLength < LOG_COMPRESS_RUN_MASK ? matchLength : LOG_COMPRESS_RUN_MASK;
+    if (matchLength >= LOG_COMPRESS_RUN_MASK) {
+        dst = logCompressLength(dst, matchLength);
+    }
+
+    return dst;
+}
+
+uint32_t logCompressBlock(uint16_t hash[LOG_COMPRESS_HASH_SIZE], const uint8_t *src, uint32_t size,
+                          uint8_t *dst, uint32_t capacity)
+{
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + size;
+    const uint8_t *match;
+    const uint8_t *dstEnd = dst + capacity;
+    uint8_t *op = dst;
+    uint32_t length;
+    uint32_t searches;
+    uint32_t h;
+
+    if (size > 0xFFFF) {
+        return 0;
+    }
+    memset(hash, 0, LOG_COMPRESS_HASH_SIZE * sizeof(hash[0]));
+    while (size > LOG_COMPRESS_MF_LIMIT && ip < end - LOG_COMPRESS_MF_LIMIT) {
+        // The match of 4 bytes at the position of the same hash
+        searches = 1 << LOG_COMPRESS_SKIP_TRIGGER;
+        for (;;) {
+            h = logCompressHash(logCompressRead32(ip));
+            match = src + hash[h];
+            hash[h] = (uint16_t)(ip - src);
+            if (match < ip && logCompressRead32(match) == logCompressRead32(ip)) {
+                break;
+            }
+            ip += searches++ >> LOG_COMPRESS_SKIP_TRIGGER;
+            if (ip >= end - LOG_COMPRESS_MF_LIMIT) {
+                goto lastLiterals;
+            }
+        }
+        while (ip > anchor && match > src && ip[-1] == match[-1]) {
+            ip--;
+            match--;
+        }
+        length = LOG_COMPRESS_MIN_MATCH;
+        while (ip + length < end - LOG_COMPRESS_LAST_LITERALS && ip[length] == match[length]) {
+            length++;
+        }
+        op = logCompressSequence(op, dstEnd, anchor, ip - anchor, ip - match, length);
+        if (op == NULL) {
+            return 0;
+        }
+        ip += length;
+        anchor = ip;
+        // The position inside the match for the next match of the repeated data
+        if (ip < end - LOG_COMPRESS_MF_LIMIT) {
+            hash[logCompressHash(logCompressRead32(ip - 2))] = (uint16_t)(ip - 2 - src);
+        }
+    }
+lastLiterals:
+    op = logCompressSequence(op, dstEnd, anchor, end - anchor, 0, 0);
+
+    return op != NULL ? op - dst : 0;
+}
+
+// The length bytes after the token of the length 15
+static const uint8_t *logDecompressLength(const uint8_t *src, const uint8_t *srcEnd, uint32_t *length)
+{
+    uint8_t value;
+
+    do {
+        if (src == srcEnd) {
+            return NULL;
+        }
+        value = *src++;
+        *length += value;
+    } while (value == 255);
+
+    return src;
+}
+
+int32_t logDecompressBlock(const uint8_t *src, uint32_t size, uint8_t *dst, uint32_t capacity)
+{
+    const uint8_t *ip = src;
+    const uint8_t *srcEnd = src + size;
+    uint8_t *op = dst;
+    uint8_t *dstEnd = dst + capacity;
+    uint32_t token;
+    uint32_t length;
+    uint32_t offset;
+
+    while (ip < srcEnd) {
+        token = *ip++;
+        length = token >> 4;
+        if (length == LOG_COMPRESS_RUN_MASK && (ip = logDecompressLength(ip, srcEnd, &length)) == NULL) {
+            return LOG_COMPRESS_FORMAT_ERROR;
+        }
+        if (length > (uint32_t)(srcEnd - ip)) {
+            return LOG_COMPRESS_FORMAT_ERROR;
+        }
+        if (length > (uint32_t)(dstEnd - op)) {
+            return LOG_COMPRESS_SIZE_ERROR;
+        }
+        memcpy(op, ip, length);
+        ip += length;
+        op += length;
+        // The last sequence has the literals only
+        if (ip == srcEnd) {
+            break;
+        }
+        if (srcEnd - ip < 2) {
+            return LOG_COMPRESS_FORMAT_ERROR;
+        }
+        offset = ip[0] | (uint32_t)ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (uint32_t)(op - dst)) {
+            return LOG_COMPRESS_FORMAT_ERROR;
+        }
+        length = token & LOG_COMPRESS_RUN_MASK;
+        if (length == LOG_COMPRESS_RUN_MASK && (ip = logDecompressLength(ip, srcEnd, &length)) == NULL) {
+            return LOG_COMPRESS_FORMAT_ERROR;
+        }
+        length += LOG_COMPRESS_MIN_MATCH;
+        if (length > (uint32_t)(dstEnd - op)) {
+            return LOG_COMPRESS_SIZE_ERROR;
+        }
+        // The match overlaps the output for the offset less than the length, it repeats the data
+        if (offset >= length) {
+            memcpy(op, op - offset, length);
+            op += length;
+        } else {
+            for (const uint8_t *match = op - offset; length != 0; length--) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op - dst;
+}
+
+void logCompressInit(LogCompressH *handler)
+{
+    handler->rawCnt = 0;
+}
+
+uint32_t logCompressAppend(LogCompressH *handler, const void *data, uint32_t size)
+{
+    uint32_t free = LOG_COMPRESS_FRAME_SIZE - handler->rawCnt;
+
+    size = size < free ? size : free;
+    memcpy(&handler->raw[handler->rawCnt], data, size);
+    handler->rawCnt += size;
+
+    return size;
+}
+
+uint32_t logCompressGetFree(LogCompressH *handler)
+{
+    return LOG_COMPRESS_FRAME_SIZE - handler->rawCnt;
+}
+
+static uint16_t logCompressCheck(const LogCompressFrameHeader *header)
+{
+    return (uint16_t)~(header->sync + header->rawSize + header->packedSize);
+}
+
+uint32_t logCompressFrame(LogCompressH *handler, const uint8_t **frame)
+{
+    LogCompressFrameHeader header;
+    uint32_t size;
+    uint32_t padding;
+
+    if (handler->rawCnt == 0) {
+        return 0;
+    }
+    // The block is not more than the data, else the data is stored
+    size = logCompressBlock(handler->hash, handler->raw, handler->rawCnt,
+                            &handler->frame[LOG_COMPRESS_HEADER], handler->rawCnt - 1);
+    header.sync = LOG_COMPRESS_SYNC;
+    header.rawSize = (uint16_t)handler->rawCnt;
+    header.packedSize = (uint16_t)size;
+    if (size == 0) {
+        memcpy(&handler->frame[LOG_COMPRESS_HEADER], handler->raw, handler->rawCnt);
+        size = handler->rawCnt;
+        header.packedSize = (uint16_t)(size | LOG_COMPRESS_STORED);
+    }
+    header.check = logCompressCheck(&header);
+    memcpy(handler->frame, &header, LOG_COMPRESS_HEADER);
+    // The next frame starts on the alignment
+    padding = (LOG_COMPRESS_ALIGN - (LOG_COMPRESS_HEADER + size) % LOG_COMPRESS_ALIGN) % LOG_COMPRESS_ALIGN;
+    memset(&handler->frame[LOG_COMPRESS_HEADER + size], 0, padding);
+    handler->rawCnt = 0;
+    *frame = handler->frame;
+
+    return LOG_COMPRESS_HEADER + size + padding;
+}
+
+uint32_t logCompressGetFrameSize(const uint8_t *frame)
+{
+    LogCompressFrameHeader header;
+    uint32_t size;
+
+    memcpy(&header, frame, LOG_COMPRESS_HEADER);
+    size = header.packedSize & ~LOG_COMPRESS_STORED;
+    if (header.sync != LOG_COMPRESS_SYNC || header.check != logCompressCheck(&header)
+        || header.rawSize == 0 || header.rawSize > LOG_COMPRESS_FRAME_SIZE || size > LOG_COMPRESS_FRAME_SIZE) {
+        return 0;
+    }
+
+    return (LOG_COMPRESS_HEADER + size + LOG_COMPRESS_ALIGN - 1) / LOG_COMPRESS_ALIGN * LOG_COMPRESS_ALIGN;
+}
+
+uint32_t logCompressFindFrame(const uint8_t *data, uint32_t size)
+{
+    uint32_t pos;
+
+    for (pos = 0; pos + LOG_COMPRESS_HEADER <= size; pos += LOG_COMPRESS_ALIGN) {
+        if (logCompressGetFrameSize(&data[pos]) != 0) {
+            return pos;
+        }
+    }
+
+    return size;
+}
+
+int32_t logDecompressFrame(const uint8_t *frame, uint32_t size, uint8_t *dst)
+{
+    LogCompressFrameHeader header;
+    uint32_t packedSize;
+    int32_t rawSize;
+
+    if (size < LOG_COMPRESS_HEADER || logCompressGetFrameSize(frame) != size) {
+        return LOG_COMPRESS_FORMAT_ERROR;
+    }
+    memcpy(&header, frame, LOG_COMPRESS_HEADER);
+    packedSize = header.packedSize & ~LOG_COMPRESS_STORED;
+    if ((header.packedSize & LOG_COMPRESS_STORED) != 0) {
+        if (packedSize != header.rawSize) {
+            return LOG_COMPRESS_FORMAT_ERROR;
+        }
+        memcpy(dst, &frame[LOG_COMPRESS_HEADER], header.rawSize);
+        return header.rawSize;
+    }
+    rawSize = logDecompressBlock(&frame[LOG_COMPRESS_HEADER], packedSize, dst, header.rawSize);
+
+    return rawSize == header.rawSize ? rawSize : LOG_COMPRESS_FORMAT_ERROR;
+}
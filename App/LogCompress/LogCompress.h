@@ -0,0 +1,103 @@
+#ifndef __LOG_COMPRESS_H__
+#define __LOG_COMPRESS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * The log compression by the frames of up to 4 KB of the log data. The frame is the
+ * LZ4 block of its data only, so every frame is decompressed independently for the
+ * random access to the log. The frame header is the sync word, the data size, the
+ * block size and the check of them, the frames are read one by one by the block size.
+ * The frame is padded to 4 bytes, so after the damaged frame or the seek to any 4 bytes
+ * aligned log offset the next frame is found by the header at the aligned positions.
+ * The frame that is not reduced by the compression is stored as is. The compressor is
+ * the greedy LZ4 match search by the hash of 4 bytes with the 2 KB table, it needs no
+ * heap. Its speed on the Cortex-M4 is not measured yet, FatBench reports the host speed.
+ */
+
+#define LOG_COMPRESS_FRAME_SIZE     4096
+#define LOG_COMPRESS_HASH_LOG       10
+#define LOG_COMPRESS_HASH_SIZE      (1 << LOG_COMPRESS_HASH_LOG)
+#define LOG_COMPRESS_STORED         0x8000      // the packedSize flag, the data is not compressed
+#define LOG_COMPRESS_SYNC           0x5A4C      // "LZ"
+#define LOG_COMPRESS_ALIGN          4
+#define LOG_COMPRESS_HEADER         sizeof(LogCompressFrameHeader)
+#define LOG_COMPRESS_FRAME_BOUND    (LOG_COMPRESS_HEADER + LOG_COMPRESS_FRAME_SIZE)
+
+#define LOG_COMPRESS_FORMAT_ERROR   -1
+#define LOG_COMPRESS_SIZE_ERROR     -2
+
+// Little endian
+typedef struct {
+    uint16_t sync;                     // LOG_COMPRESS_SYNC
+    uint16_t rawSize;
+    uint16_t packedSize;               // the data size after the header and LOG_COMPRESS_STORED
+    uint16_t check;                    // the complement of the sum of the fields before it
+} LogCompressFrameHeader;
+
+typedef struct {
+    uint16_t hash[LOG_COMPRESS_HASH_SIZE];
+    uint32_t rawCnt;
+    uint8_t raw[LOG_COMPRESS_FRAME_SIZE];
+    uint8_t frame[LOG_COMPRESS_FRAME_BOUND];
+} LogCompressH;
+
+void logCompressInit(LogCompressH *handler);
+
+/**
+ * @brief Copy the data to the frame
+ * @return the copied size, it is less than the size if the frame is full
+ */
+uint32_t logCompressAppend(LogCompressH *handler, const void *data, uint32_t size);
+
+/**
+ * @brief Get the free bytes of the frame
+ */
+uint32_t logCompressGetFree(LogCompressH *handler);
+
+/**
+ * @brief Compress the collected data to the frame and start the next frame
+ * @param[out] frame - the frame with the header
+ * @return the frame size, 0 if there is no data
+ */
+uint32_t logCompressFrame(LogCompressH *handler, const uint8_t **frame);
+
+/**
+ * @brief Compress the data to the LZ4 block
+ * @param[in] hash - the hash table, it is cleared
+ * @param[in] size - the data size, up to 64 KB
+ * @param[in] capacity - the block buffer size
+ * @return the block size, 0 if the block does not fit in the capacity
+ */
+uint32_t logCompressBlock(uint16_t hash[LOG_COMPRESS_HASH_SIZE], const uint8_t *src, uint32_t size,
+                          uint8_t *dst, uint32_t capacity);
+
+/**
+ * @brief Decompress the LZ4 block, the block is checked against the buffer bounds
+ * @return the data size, LOG_COMPRESS_FORMAT_ERROR or LOG_COMPRESS_SIZE_ERROR if it does not fit in the capacity
+ */
+int32_t logDecompressBlock(const uint8_t *src, uint32_t size, uint8_t *dst, uint32_t capacity);
+
+/**
+ * @brief Get the frame size with the header and the padding by the frame header
+ * @return the frame size, 0 if the header is not valid
+ */
+uint32_t logCompressGetFrameSize(const uint8_t *frame);
+
+/**
+ * @brief Find the next frame header in the log data
+ * @param[in] data - the log data at the 4 bytes aligned log offset
+ * @return the offset of the frame, the size if there is no frame header
+ */
+uint32_t logCompressFindFrame(const uint8_t *data, uint32_t size);
+
+/**
+ * @brief Decompress the frame
+ * @param[in] size - the frame size with the header and the padding
+ * @param[out] dst - the buffer of LOG_COMPRESS_FRAME_SIZE
+ * @return the data size or the error
+ */
+int32_t logDecompressFrame(const uint8_t *frame, uint32_t size, uint8_t *dst);
+
+#endif
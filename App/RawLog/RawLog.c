@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "RawLog.h"
+#include "diskio.h"
+
+#if !FF_USE_EXPAND
+#error "RawLog requires FF_USE_EXPAND in the ffconf.h"
+#endif
+
+#if FF_MAX_SS == FF_MIN_SS
+#define RAW_LOG_SS(fs)    ((uint32_t)FF_MAX_SS)
+#else
+#define RAW_LOG_SS(fs)    ((uint32_t)(fs)->ssize)
+#endif
+
+static FRESULT rawLogDiskWrite(RawLogH *handler, const BYTE *buff, FSIZE_t pos, UINT count)
+{
+    LBA_t sector = handler->startSector + (LBA_t)(pos / handler->sectorSize);
+
+    return disk_write(handler->pdrv, buff, sector, count) == RES_OK ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT rawLogOpen(RawLogH *handler, const TCHAR *path, FSIZE_t capacity)
+{
+    FATFS *fs;
+    FRESULT result;
+
+    if (handler == NULL || path == NULL || capacity == 0) {
+        return FR_INVALID_PARAMETER;
+    }
+    memset(handler, 0, sizeof(RawLogH));
+    result = f_open(&handler->file, path, FA_WRITE | FA_CREATE_ALWAYS);
+    if (result != FR_OK) {
+        return result;
+    }
+    result = f_expand(&handler->file, capacity, 1);
+    if (result != FR_OK) {
+        f_close(&handler->file);
+        return result;
+    }
+    fs = handler->file.obj.fs;
+    handler->pdrv = fs->pdrv;
+    handler->sectorSize = RAW_LOG_SS(fs);
+    handler->startSector = fs->database + (LBA_t)fs->csize * (handler->file.obj.sclust - 2);
+    handler->capacity = capacity;
+    // The chain is on the FAT, the file size is the logged data size
+    result = f_setsize(&handler->file, 0);
+    if (result == FR_OK) {
+        result = f_sync(&handler->file);
+    }
+    if (result != FR_OK) {
+        f_close(&handler->file);
+    }
+
+    return result;
+}
+
+FRESULT rawLogWrite(RawLogH *handler, const void *buff, uint32_t size)
+{
+    const BYTE *data = buff;
+    uint32_t buffSize;
+    uint32_t chunk;
+    FRESULT result;
+
+    if (handler == NULL || buff == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    if (size > handler->capacity - handler->size) {
+        return FR_DENIED;
+    }
+    buffSize = RAW_LOG_BUFF_SECTORS * handler->sectorSize;
+    if (handler->buffCnt != 0) {
+        chunk = buffSize - handler->buffCnt;
+        chunk = size < chunk ? size : chunk;
+        memcpy(&handler->buff[handler->buffCnt], data, chunk);
+        handler->buffCnt += chunk;
+        handler->size += chunk;
+        data += chunk;
+        size -= chunk;
+        if (handler->buffCnt < buffSize) {
+            return FR_OK;
+        }
+        result = rawLogDiskWrite(handler, handler->buff, handler->size - buffSize, RAW_LOG_BUFF_SECTORS);
+        if (result != FR_OK) {
+            return result;
+        }
+        handler->buffCnt = 0;
+    }
+    if (size >= buffSize) {
+        chunk = size - size % handler->sectorSize;
+        result = rawLogDiskWrite(handler, data, handler->size, chunk / handler->sectorSize);
+        if (result != FR_OK) {
+            return result;
+        }
+        handler->size += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    memcpy(handler->buff, data, size);
+    handler->buffCnt = size;
+    handler->size += size;
+
+    return FR_OK;
+}
+
+/*
+ * Write the buffered sectors, the last not full sector stays in the buffer for the next appends
+ */
+static FRESULT rawLogFlush(RawLogH *handler)
+{
+    uint32_t full = handler->buffCnt - handler->buffCnt % handler->sectorSize;
+    uint32_t count = (handler->buffCnt + handler->sectorSize - 1) / handler->sectorSize;
+    FRESULT result;
+
+    if (handler->buffCnt == 0) {
+        return FR_OK;
+    }
+    memset(&handler->buff[handler->buffCnt], 0, count * handler->sectorSize - handler->buffCnt);
+    result = rawLogDiskWrite(handler, handler->buff, handler->size - handler->buffCnt, count);
+    if (result != FR_OK) {
+        return result;
+    }
+    memmove(handler->buff, &handler->buff[full], handler->buffCnt - full);
+    handler->buffCnt -= full;
+
+    return FR_OK;
+}
+
+FRESULT rawLogSync(RawLogH *handler)
+{
+    FRESULT result;
+
+    if (handler == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    result = rawLogFlush(handler);
+    if (result != FR_OK) {
+        return result;
+    }
+    result = f_setsize(&handler->file, handler->size);
+    if (result != FR_OK) {
+        return result;
+    }
+
+    return f_sync(&handler->file);
+}
+
+FRESULT rawLogClose(RawLogH *handler)
+{
+    FRESULT result;
+
+    if (handler == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    result = rawLogFlush(handler);
+    // The f_truncate removes the chain after the file pointer of the whole preallocated file
+    if (result == FR_OK) {
+        result = f_setsize(&handler->file, handler->capacity);
+    }
+    if (result == FR_OK) {
+        result = f_lseek(&handler->file, handler->size);
+    }
+    if (result == FR_OK) {
+        result = f_truncate(&handler->file);
+    }
+    if (result == FR_OK) {
+        result = f_close(&handler->file);
+    }
+
+    return result;
+}
@@ -0,0 +1,57 @@
+#ifndef __RAW_LOG_H__
+#define __RAW_LOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ff.h"
+
+/*
+ * The log file on the contiguous preallocated clusters. The start sector of the
+ * file is resolved once on open, the appends are written by the multi-block
+ * disk_write straight to the data sectors without the FAT and the directory
+ * updates. The file size in the directory entry is updated on the sync and on
+ * the close only, the not used preallocated clusters are freed on the close.
+ */
+
+// The appends are collected to the multi-block write of this size, 8 KB
+#define RAW_LOG_BUFF_SECTORS    (8192 / FF_MAX_SS)
+
+typedef struct {
+    FIL file;
+    BYTE pdrv;
+    LBA_t startSector;
+    uint32_t sectorSize;
+    FSIZE_t capacity;
+    FSIZE_t size;
+    uint32_t buffCnt;          // the not written bytes, the buffer starts on the sector boundary
+    BYTE buff[RAW_LOG_BUFF_SECTORS * FF_MAX_SS];
+} RawLogH;
+
+/**
+ * @brief Create the log file and preallocate the contiguous clusters for it
+ * @param[out] handler - the log handler
+ * @param[in] path - the file path, the existing file is overwritten
+ * @param[in] capacity - the preallocated size in bytes
+ * @return FR_DENIED if there is no contiguous free area of the capacity size
+ */
+FRESULT rawLogOpen(RawLogH *handler, const TCHAR *path, FSIZE_t capacity);
+
+/**
+ * @brief Append the data to the log. The data is collected to the buffer and written by the multi-block
+ *        write when the buffer is full, the big appends are written directly
+ * @return FR_DENIED if the data does not fit in the preallocated capacity, nothing is written
+ */
+FRESULT rawLogWrite(RawLogH *handler, const void *buff, uint32_t size);
+
+/**
+ * @brief Write the buffered data and update the file size in the directory entry
+ */
+FRESULT rawLogSync(RawLogH *handler);
+
+/**
+ * @brief Sync the log, free the not used preallocated clusters and close the file
+ */
+FRESULT rawLogClose(RawLogH *handler);
+
+#endif
@@ -4,6 +4,21 @@
 
 #include "RingBuff.h"
 
+// The data access is completed before the index update and vice versa
+#if defined(__arm__)
+#include "cmsis_compiler.h"
+#define RING_BUFF_DMB()    __DMB()
+#else
+#define RING_BUFF_DMB()    __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+// The MPSC record header: the data size and the flags, the data is padded to 4 bytes
+#define RING_BUFF_MPSC_HEADER     sizeof(uint32_t)
+#define RING_BUFF_MPSC_COMMIT     0x80000000
+#define RING_BUFF_MPSC_PAD        0x40000000
+#define RING_BUFF_MPSC_SIZE_MASK  0x3FFFFFFF
+#define RING_BUFF_MPSC_ALIGN(size) (((size) + 3) & ~(uint32_t)3)
+
 uint32_t ringBuffInit(RingBuffH *ringBuff, uint8_t *buff,
                       uint32_t size, uint32_t depth,
                       BlockAtomic blockAtomic)
@@ -27,7 +42,7 @@ uint32_t ringBuffInit(RingBuffH *ringBuff, uint8_t *buff,
     return RING_BUFF_OK;
 }
 
-uint8_t ringBuffGetCnt(RingBuffH *ringBuff)
+uint32_t ringBuffGetCnt(RingBuffH *ringBuff)
 {
     if (!ringBuff) {
         return 0;
@@ -114,3 +129,443 @@ int32_t ringBuffPop(RingBuffH *ringBuff, uint8_t buff[], RingBuffSizeT *size)
     }
     return RING_BUFF_OK;
 }
+
+int32_t ringBuffSpscInit(RingBuffSpscH *ring, uint8_t *buff, uint32_t size)
+{
+    if (buff == NULL) {
+        return RING_BUFF_BUFF_ERROR;
+    }
+    if (ring == NULL) {
+        return RING_BUFF_HANDLER_ERROR;
+    }
+    if (size == 0 || (size & (size - 1)) != 0) {
+        return RING_BUFF_SIZE_ERROR;
+    }
+    ring->buff = buff;
+    ring->size = size;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return RING_BUFF_OK;
+}
+
+uint32_t ringBuffSpscGetUsed(RingBuffSpscH *ring)
+{
+    return ring->head - ring->tail;
+}
+
+uint32_t ringBuffSpscGetFree(RingBuffSpscH *ring)
+{
+    return ring->size - (ring->head - ring->tail);
+}
+
+uint32_t ringBuffSpscReserve(RingBuffSpscH *ring, uint8_t **data)
+{
+    uint32_t head = ring->head;
+    uint32_t free = ring->size - (head - ring->tail);
+    uint32_t toEnd = ring->size - (head & ring->mask);
+
+    // The consumer released the space before the tail update
+    RING_BUFF_DMB();
+    *data = &ring->buff[head & ring->mask];
+
+    return free < toEnd ? free : toEnd;
+}
+
+int32_t ringBuffSpscCommit(RingBuffSpscH *ring, uint32_t size)
+{
+    if (size > ringBuffSpscGetFree(ring)) {
+        return RING_BUFF_SIZE_ERROR;
+    }
+    // The data is written before the head update
+    RING_BUFF_DMB();
+    ring->head += size;
+
+    return RING_BUFF_OK;
+}
+
+uint32_t ringBuffSpscPeek(RingBuffSpscH *ring, const uint8_t **data)
+{
+    uint32_t tail = ring->tail;
+    uint32_t used = ring->head - tail;
+    uint32_t toEnd = ring->size - (tail & ring->mask);
+
+    // The data is read after the head read
+    RING_BUFF_DMB();
+    *data = &ring->buff[tail & ring->mask];
+
+    return used < toEnd ? used : toEnd;
+}
+
+int32_t ringBuffSpscRelease(RingBuffSpscH *ring, uint32_t size)
+{
+    if (size > ringBuffSpscGetUsed(ring)) {
+        return RING_BUFF_SIZE_ERROR;
+    }
+    // The data is read before the space is returned to the producer
+    RING_BUFF_DMB();
+    ring->tail += size;
+
+    return RING_BUFF_OK;
+}
+
+int32_t ringBuffSpscWrite(RingBuffSpscH *ring, const uint8_t data[], uint32_t size)
+{
+    uint8_t *dst;
+    uint32_t chunk;
+
+    if (size > ringBuffSpscGetFree(ring)) {
+        return RING_BUFF_FULL;
+    }
+    chunk = ringBuffSpscReserve(ring, &dst);
+    chunk = size < chunk ? size : chunk;
+    memcpy(dst, data, chunk);
+    // The rest is at the buffer start
+    memcpy(ring->buff, &data[chunk], size - chunk);
+
+    return ringBuffSpscCommit(ring, size);
+}
+
+uint32_t ringBuffSpscRead(RingBuffSpscH *ring, uint8_t data[], uint32_t size)
+{
+    const uint8_t *src;
+    uint32_t used = ringBuffSpscGetUsed(ring);
+    uint32_t chunk;
+
+    size = size < used ? size : used;
+    chunk = ringBuffSpscPeek(ring, &src);
+    chunk = size < chunk ? size : chunk;
+    memcpy(data, src, chunk);
+    memcpy(&data[chunk], ring->buff, size - chunk);
+    ringBuffSpscRelease(ring, size);
+
+    return size;
+}
+
+int32_t ringBuffMpscInit(RingBuffMpscH *ring, uint8_t *buff, uint32_t size)
+{
+    if (buff == NULL || ((uintptr_t)buff & 3) != 0) {
+        return RING_BUFF_BUFF_ERROR;
+    }
+    if (ring == NULL) {
+        return RING_BUFF_HANDLER_ERROR;
+    }
+    if (size < 2 * RING_BUFF_MPSC_HEADER || (size & (size - 1)) != 0) {
+        return RING_BUFF_SIZE_ERROR;
+    }
+    memset(buff, 0, size);
+    ring->buff = buff;
+    ring->size = size;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return RING_BUFF_OK;
+}
+
+/*
+ * Claim the record space and the padding up to the buffer end if the record does not fit in it.
+ * The exclusive store fails if the head is changed by the other producer or by the interrupt after
+ * the exclusive load, then the claim is repeated
+ */
+static int32_t ringBuffMpscClaim(RingBuffMpscH *ring, uint32_t need, uint32_t *pos, uint32_t *pad)
+{
+    uint32_t head;
+    uint32_t toEnd;
+
+#if defined(__arm__)
+    do {
+        head = __LDREXW(&ring->head);
+        toEnd = ring->size - (head & ring->mask);
+        *pad = need <= toEnd ? 0 : toEnd;
+        if (*pad + need > ring->size - (head - ring->tail)) {
+            __CLREX();
+            return RING_BUFF_FULL;
+        }
+    } while (__STREXW(head + *pad + need, &ring->head) != 0);
+#else
+    head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    do {
+        toEnd = ring->size - (head & ring->mask);
+        *pad = need <= toEnd ? 0 : toEnd;
+        if (*pad + need > ring->size - (head - ring->tail)) {
+            return RING_BUFF_FULL;
+        }
+    } while (!__atomic_compare_exchange_n(&ring->head, &head, head + *pad + need, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#endif
+    *pos = head;
+
+    return RING_BUFF_OK;
+}
+
+int32_t ringBuffMpscReserve(RingBuffMpscH *ring, uint32_t size, uint8_t **data)
+{
+    uint32_t need = RING_BUFF_MPSC_HEADER + RING_BUFF_MPSC_ALIGN(size);
+    uint32_t pos;
+    uint32_t pad;
+    int32_t result;
+
+    if (size == 0 || need > ring->size / 2) {
+        return RING_BUFF_SIZE_ERROR;
+    }
+    result = ringBuffMpscClaim(ring, need, &pos, &pad);
+    if (result != RING_BUFF_OK) {
+        return result;
+    }
+    // The consumer zeroed the space before the tail update
+    RING_BUFF_DMB();
+    if (pad != 0) {
+        // The padding up to the buffer end is committed at once, the record is at the buffer start
+        *(volatile uint32_t *)&ring->buff[pos & ring->mask] = RING_BUFF_MPSC_COMMIT | RING_BUFF_MPSC_PAD | pad;
+        pos += pad;
+    }
+    *(volatile uint32_t *)&ring->buff[pos & ring->mask] = size;
+    *data = &ring->buff[(pos & ring->mask) + RING_BUFF_MPSC_HEADER];
+
+    return RING_BUFF_OK;
+}
+
+void ringBuffMpscCommit(RingBuffMpscH *ring, uint8_t *data)
+{
+    volatile uint32_t *header = (volatile uint32_t *)(data - RING_BUFF_MPSC_HEADER);
+
+    // The data is written before the commit flag
+    RING_BUFF_DMB();
+    *header |= RING_BUFF_MPSC_COMMIT;
+}
+
+int32_t ringBuffMpscPush(RingBuffMpscH *ring, const uint8_t data[], uint32_t size)
+{
+    uint8_t *dst;
+    int32_t result;
+
+    result = ringBuffMpscReserve(ring, size, &dst);
+    if (result == RING_BUFF_OK) {
+        memcpy(dst, data, size);
+        ringBuffMpscCommit(ring, dst);
+    }
+
+    return result;
+}
+
+uint32_t ringBuffMpscPeek(RingBuffMpscH *ring, const uint8_t **data)
+{
+    volatile uint32_t *header;
+    uint32_t value;
+
+    while (ring->tail != ring->head) {
+        header = (volatile uint32_t *)&ring->buff[ring->tail & ring->mask];
+        value = *header;
+        if ((value & RING_BUFF_MPSC_COMMIT) == 0) {
+            break;
+        }
+        // The data is read after the commit flag
+        RING_BUFF_DMB();
+        if ((value & RING_BUFF_MPSC_PAD) == 0) {
+            *data = (const uint8_t *)header + RING_BUFF_MPSC_HEADER;
+            return value & RING_BUFF_MPSC_SIZE_MASK;
+        }
+        // The padding has no data, only the header is not zero
+        *header = 0;
+        RING_BUFF_DMB();
+        ring->tail += value & RING_BUFF_MPSC_SIZE_MASK;
+    }
+
+    return 0;
+}
+
+void ringBuffMpscRelease(RingBuffMpscH *ring)
+{
+    uint8_t *record = &ring->buff[ring->tail & ring->mask];
+    uint32_t value = *(volatile uint32_t *)record;
+    uint32_t need;
+
+    if (ring->tail == ring->head || (value & RING_BUFF_MPSC_COMMIT) == 0 || (value & RING_BUFF_MPSC_PAD) != 0) {
+        return;
+    }
+    need = RING_BUFF_MPSC_HEADER + RING_BUFF_MPSC_ALIGN(value & RING_BUFF_MPSC_SIZE_MASK);
+    memset(record, 0, need);
+    // The space is zeroed before it is returned to the producers
+    RING_BUFF_DMB();
+    ring->tail += need;
+}
+
+int32_t ringBuffMpscPop(RingBuffMpscH *ring, uint8_t data[], uint32_t *size)
+{
+    const uint8_t *src;
+
+    *size = ringBuffMpscPeek(ring, &src);
+    if (*size == 0) {
+        return RING_BUFF_EMPTY;
+    }
+    memcpy(data, src, *size);
+    ringBuffMpscRelease(ring);
+
+    return RING_BUFF_OK;
+}
+
+uint32_t ringBuffMpscGetUsed(RingBuffMpscH *ring)
+{
+    return ring->head - ring->tail;
+}
+
+int32_t ringBuffBipInit(RingBuffBipH *ring, uint8_t *buff, uint32_t size)
+{
+    if (buff == NULL) {
+        return RING_BUFF_BUFF_ERROR;
+    }
+    if (ring == NULL) {
+        return RING_BUFF_HANDLER_ERROR;
+    }
+    if (size == 0) {
+        return RING_BUFF_SIZE_ERROR;
+    }
+    ring->buff = buff;
+    ring->size = size;
+    ring->write = 0;
+    ring->read = 0;
+    ring->watermark = size;
+    ring->reserveStart = 0;
+    ring->reserveSize = 0;
+
+    return RING_BUFF_OK;
+}
+
+/*
+ * The free region after the write position: up to the read position if the write is wrapped,
+ * else up to the buffer end. The wrapped write never reaches the read position, so the equal
+ * positions are the empty buffer
+ */
+static uint32_t ringBuffBipFreeAfter(RingBuffBipH *ring, uint32_t write, uint32_t read)
+{
+    return write < read ? read - write - 1 : ring->size - write;
+}
+
+// The free region at the buffer start for the wrap, the write is not wrapped
+static uint32_t ringBuffBipFreeBefore(uint32_t write, uint32_t read)
+{
+    return write >= read && read != 0 ? read - 1 : 0;
+}
+
+int32_t ringBuffBipReserve(RingBuffBipH *ring, uint32_t size, uint8_t **data)
+{
+    uint32_t write = ring->write;
+    uint32_t read = ring->read;
+    uint32_t start = write;
+
+    // The consumer released the space before the read update
+    RING_BUFF_DMB();
+    if (size == 0) {
+        return RING_BUFF_SIZE_ERROR;
+    }
+    if (size > ringBuffBipFreeAfter(ring, write, read)) {
+        // The region does not fit up to the buffer end, it is placed at the buffer start
+        if (size > ringBuffBipFreeBefore(write, read)) {
+            return RING_BUFF_FULL;
+        }
+        start = 0;
+    }
+    ring->reserveStart = start;
+    ring->reserveSize = size;
+    *data = &ring->buff[start];
+
+    return RING_BUFF_OK;
+}
+
+uint32_t ringBuffBipReserveUnits(RingBuffBipH *ring, uint32_t unit, uint8_t **data)
+{
+    uint32_t write = ring->write;
+    uint32_t read = ring->read;
+    uint32_t start = write;
+    uint32_t size;
+
+    RING_BUFF_DMB();
+    if (unit == 0) {
+        return 0;
+    }
+    size = ringBuffBipFreeAfter(ring, write, read);
+    size -= size % unit;
+    // The space up to the buffer end is less than the unit, the region is at the buffer start
+    if (size == 0) {
+        start = 0;
+        size = ringBuffBipFreeBefore(write, read);
+        size -= size % unit;
+    }
+    if (size == 0) {
+        return 0;
+    }
+    ring->reserveStart = start;
+    ring->reserveSize = size;
+    *data = &ring->buff[start];
+
+    return size;
+}
+
+int32_t ringBuffBipCommit(RingBuffBipH *ring, uint32_t size)
+{
+    uint32_t write = ring->write;
+    uint32_t start = ring->reserveStart;
+
+    if (size > ring->reserveSize) {
+        return RING_BUFF_SIZE_ERROR;
+    }
+    ring->reserveSize = 0;
+    if (size == 0) {
+        return RING_BUFF_OK;
+    }
+    if (start != write) {
+        // The wrap, the data before it ends on the watermark
+        ring->watermark = write;
+    } else if (start + size > ring->watermark) {
+        ring->watermark = ring->size;
+    }
+    // The data and the watermark are written before the write update
+    RING_BUFF_DMB();
+    ring->write = start + size;
+
+    return RING_BUFF_OK;
+}
+
+uint32_t ringBuffBipPeek(RingBuffBipH *ring, const uint8_t **data)
+{
+    uint32_t write = ring->write;
+    uint32_t read = ring->read;
+    uint32_t watermark;
+
+    // The data and the watermark are read after the write position
+    RING_BUFF_DMB();
+    watermark = ring->watermark;
+    if (write < read && read >= watermark) {
+        // All the data before the wrap is read, the data continues at the buffer start
+        read = 0;
+        ring->read = 0;
+    }
+    *data = &ring->buff[read];
+
+    return (write < read ? watermark : write) - read;
+}
+
+uint32_t ringBuffBipPeekUnits(RingBuffBipH *ring, uint32_t unit, const uint8_t **data)
+{
+    uint32_t size = ringBuffBipPeek(ring, data);
+
+    return unit != 0 ? size - size % unit : 0;
+}
+
+int32_t ringBuffBipRelease(RingBuffBipH *ring, uint32_t size)
+{
+    uint32_t write = ring->write;
+    uint32_t read = ring->read;
+
+    RING_BUFF_DMB();
+    if (size > (write < read ? ring->watermark : write) - read) {
+        return RING_BUFF_SIZE_ERROR;
+    }
+    // The data is read before the space is returned to the producer
+    RING_BUFF_DMB();
+    ring->read = read + size;
+
+    return RING_BUFF_OK;
+}
@@ -11,7 +11,7 @@
 #define RING_BUFF_HANDLER_ERROR    -2
 #define RING_BUFF_SIZE_ERROR       -3
 
-typedef uint8_t RingBuffSizeT;
+typedef uint32_t RingBuffSizeT;
 
 #define RING_BUFF_CREATE_BUFF(name, size, depth) \
     static uint8_t name[depth * (size + sizeof(RingBuffSizeT))];
@@ -20,9 +20,9 @@ typedef void (*BlockAtomic)(bool block);
 
 typedef struct {
     uint8_t *buff;
-    uint8_t writeP;
-    uint8_t readP;
-    uint8_t cnt;
+    uint32_t writeP;
+    uint32_t readP;
+    uint32_t cnt;
     uint32_t depth;
     RingBuffSizeT size;
     BlockAtomic blockAtomic;
@@ -31,9 +31,209 @@ typedef struct {
 uint32_t ringBuffInit(RingBuffH *ringBuff, uint8_t *buff,
                       uint32_t size, uint32_t depth,
                       BlockAtomic blockAtomic);
-uint8_t ringBuffGetCnt(RingBuffH *ringBuff);
+uint32_t ringBuffGetCnt(RingBuffH *ringBuff);
 int32_t ringBuffPush(RingBuffH *ringBuff, const uint8_t buff[], RingBuffSizeT size);
 int32_t ringBuffPop(RingBuffH *ringBuff, uint8_t buff[], RingBuffSizeT *size);
 int32_t ringBuffClear(RingBuffH *ringBuff);
 
+/*
+ * The lock-free byte ring of the single producer and the single consumer, for example
+ * the ISR and the task. The size is a power of two, the head and the tail are the free
+ * running 32-bit byte counters masked on the buffer access. The head is written by the
+ * producer only and the tail by the consumer only, the data access and the counter
+ * update are ordered by the DMB. The producer writes in place by the reserve/commit,
+ * the consumer reads in place by the peek/release, so the data can be passed to the DMA
+ * without the copy. The reserved and the peeked region ends on the buffer end.
+ */
+
+typedef struct {
+    uint8_t *buff;
+    uint32_t size;
+    uint32_t mask;
+    volatile uint32_t head;            // the written bytes, the producer only
+    volatile uint32_t tail;            // the read bytes, the consumer only
+} RingBuffSpscH;
+
+/**
+ * @brief Init the SPSC ring
+ * @param[in] buff - the ring buffer
+ * @param[in] size - the buffer size, power of two
+ */
+int32_t ringBuffSpscInit(RingBuffSpscH *ring, uint8_t *buff, uint32_t size);
+
+/**
+ * @brief Get the free space at the head to write in place, the producer side
+ * @param[out] data - the write position
+ * @return the contiguous free bytes up to the buffer end
+ */
+uint32_t ringBuffSpscReserve(RingBuffSpscH *ring, uint8_t **data);
+
+/**
+ * @brief Publish the written bytes of the reserved space to the consumer
+ * @return RING_BUFF_SIZE_ERROR if the size is more than the free space
+ */
+int32_t ringBuffSpscCommit(RingBuffSpscH *ring, uint32_t size);
+
+/**
+ * @brief Get the data at the tail to read in place, the consumer side
+ * @param[out] data - the read position
+ * @return the contiguous data bytes up to the buffer end
+ */
+uint32_t ringBuffSpscPeek(RingBuffSpscH *ring, const uint8_t **data);
+
+/**
+ * @brief Return the read bytes of the peeked data to the producer
+ * @return RING_BUFF_SIZE_ERROR if the size is more than the data in the ring
+ */
+int32_t ringBuffSpscRelease(RingBuffSpscH *ring, uint32_t size);
+
+/**
+ * @brief Copy the data to the ring, the data is written whole or not written
+ * @return RING_BUFF_FULL if there is no free space for the data
+ */
+int32_t ringBuffSpscWrite(RingBuffSpscH *ring, const uint8_t data[], uint32_t size);
+
+/**
+ * @brief Copy the data from the ring
+ * @return the read bytes
+ */
+uint32_t ringBuffSpscRead(RingBuffSpscH *ring, uint8_t data[], uint32_t size);
+
+uint32_t ringBuffSpscGetUsed(RingBuffSpscH *ring);
+uint32_t ringBuffSpscGetFree(RingBuffSpscH *ring);
+
+/*
+ * The lock-free record ring of the several producers and the single consumer, the
+ * producers are the ISRs and the tasks. The producer claims the record space by the
+ * LDREX/STREX of the head, so the interrupts are not disabled and the claim time does
+ * not depend on the record size. The record is written in place and published by the
+ * commit flag of its header. The record is contiguous, the space up to the buffer end
+ * is skipped by the padding record if the record does not fit in it. The consumer
+ * takes the records in the claim order, the record not committed yet stops it. The
+ * released space is zeroed by the consumer, so the header of the claimed and not
+ * committed record is always zero.
+ */
+
+typedef struct {
+    uint8_t *buff;                     // 4 bytes aligned
+    uint32_t size;
+    uint32_t mask;
+    volatile uint32_t head;            // the claimed bytes, the producers by the exclusive access
+    volatile uint32_t tail;            // the released bytes, the consumer only
+} RingBuffMpscH;
+
+/**
+ * @brief Init the MPSC ring, the buffer is zeroed
+ * @param[in] buff - the ring buffer, 4 bytes aligned
+ * @param[in] size - the buffer size, power of two
+ */
+int32_t ringBuffMpscInit(RingBuffMpscH *ring, uint8_t *buff, uint32_t size);
+
+/**
+ * @brief Claim the record space, the producer side. It is safe for the ISR
+ * @param[in] size - the record size
+ * @param[out] data - the record data to write in place
+ * @return RING_BUFF_FULL if there is no free space for the record
+ */
+int32_t ringBuffMpscReserve(RingBuffMpscH *ring, uint32_t size, uint8_t **data);
+
+/**
+ * @brief Publish the written record to the consumer
+ * @param[in] data - the record data of the ringBuffMpscReserve
+ */
+void ringBuffMpscCommit(RingBuffMpscH *ring, uint8_t *data);
+
+/**
+ * @brief Copy the record to the ring
+ * @return RING_BUFF_FULL if there is no free space for the record
+ */
+int32_t ringBuffMpscPush(RingBuffMpscH *ring, const uint8_t data[], uint32_t size);
+
+/**
+ * @brief Get the next committed record to read in place, the consumer side
+ * @param[out] data - the record data
+ * @return the record size, 0 if there is no committed record
+ */
+uint32_t ringBuffMpscPeek(RingBuffMpscH *ring, const uint8_t **data);
+
+/**
+ * @brief Release the peeked record
+ */
+void ringBuffMpscRelease(RingBuffMpscH *ring);
+
+/**
+ * @brief Copy the next committed record from the ring
+ * @param[out] data - the record data, the buffer of the maximal record size
+ * @param[out] size - the record size
+ * @return RING_BUFF_EMPTY if there is no committed record
+ */
+int32_t ringBuffMpscPop(RingBuffMpscH *ring, uint8_t data[], uint32_t *size);
+
+/**
+ * @brief Get the claimed bytes of the ring with the headers and the padding
+ */
+uint32_t ringBuffMpscGetUsed(RingBuffMpscH *ring);
+
+/*
+ * The bip-buffer of the single producer and the single consumer. The reserved and the
+ * peeked regions are always contiguous: the reservation that does not fit up to the
+ * buffer end is placed at the buffer start, and the end of the written data before the
+ * wrap is kept as the watermark. If the buffer size is a multiple of the unit and the
+ * producer commits the whole units only, the consumer always gets the whole units, for
+ * example the 512 bytes blocks for the one multiple block write from the buffer.
+ */
+
+typedef struct {
+    uint8_t *buff;
+    uint32_t size;
+    volatile uint32_t write;           // the producer only
+    volatile uint32_t read;            // the consumer only
+    volatile uint32_t watermark;       // the end of the data before the wrap, the producer only
+    uint32_t reserveStart;             // the reserved region, the producer only
+    uint32_t reserveSize;
+} RingBuffBipH;
+
+/**
+ * @brief Init the bip-buffer
+ */
+int32_t ringBuffBipInit(RingBuffBipH *ring, uint8_t *buff, uint32_t size);
+
+/**
+ * @brief Reserve the contiguous region of the size, the producer side
+ * @param[out] data - the region to write in place
+ * @return RING_BUFF_FULL if there is no contiguous free region of the size
+ */
+int32_t ringBuffBipReserve(RingBuffBipH *ring, uint32_t size, uint8_t **data);
+
+/**
+ * @brief Reserve the largest contiguous free region of the whole units
+ * @param[in] unit - the unit size
+ * @param[out] data - the region to write in place
+ * @return the region size, 0 if there is no free unit
+ */
+uint32_t ringBuffBipReserveUnits(RingBuffBipH *ring, uint32_t unit, uint8_t **data);
+
+/**
+ * @brief Publish the written bytes from the start of the reserved region, the rest is returned to the ring
+ */
+int32_t ringBuffBipCommit(RingBuffBipH *ring, uint32_t size);
+
+/**
+ * @brief Get the contiguous data to read in place, the consumer side
+ * @return the data size
+ */
+uint32_t ringBuffBipPeek(RingBuffBipH *ring, const uint8_t **data);
+
+/**
+ * @brief Get the largest contiguous data of the whole units
+ * @param[in] unit - the unit size
+ * @return the data size, 0 if there is no whole unit
+ */
+uint32_t ringBuffBipPeekUnits(RingBuffBipH *ring, uint32_t unit, const uint8_t **data);
+
+/**
+ * @brief Return the read bytes of the peeked data to the producer
+ */
+int32_t ringBuffBipRelease(RingBuffBipH *ring, uint32_t size);
+
 #endif
@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "SdFormat.h"
+#include "diskio.h"
+
+#if !FF_USE_MKFS
+#error "SdFormat requires FF_USE_MKFS in the ffconf.h"
+#endif
+
+typedef struct {
+    uint32_t capacityMb;       // the upper limit of the row
+    BYTE fmt;
+    uint32_t clusterKb;
+    uint32_t boundaryKb;
+} SdFormatRow;
+
+// The cluster size and the boundary unit by the card capacity, the SD Association File System Specification
+static const SdFormatRow sdFormatTable[] = {
+    {8,                  FM_FAT,   8,   8},
+    {64,                 FM_FAT,   16,  16},
+    {256,                FM_FAT,   16,  32},
+    {1024,               FM_FAT,   16,  64},
+    {2048,               FM_FAT,   32,  64},
+    {32 * 1024,          FM_FAT32, 32,  4 * 1024},
+    {512 * 1024,         FM_EXFAT, 128, 16 * 1024},
+    {2 * 1024 * 1024,    FM_EXFAT, 256, 32 * 1024},
+};
+
+// The maximal alignment of the f_mkfs
+#define SD_FORMAT_MAX_BOUNDARY    0x8000
+
+FRESULT sdFormatGetParam(BYTE pdrv, SdFormatParam *param)
+{
+    const SdFormatRow *row = sdFormatTable;
+    LBA_t sectorCount;
+    DWORD auSectors;
+    WORD sectorSize = FF_MAX_SS;
+    uint64_t capacityMb;
+    uint32_t k;
+
+    if (param == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    if (disk_ioctl(pdrv, GET_SECTOR_COUNT, &sectorCount) != RES_OK
+#if FF_MAX_SS != FF_MIN_SS
+        || disk_ioctl(pdrv, GET_SECTOR_SIZE, &sectorSize) != RES_OK
+#endif
+        ) {
+        return FR_DISK_ERR;
+    }
+    if (disk_ioctl(pdrv, GET_BLOCK_SIZE, &auSectors) != RES_OK) {
+        auSectors = 1;
+    }
+    // The capacity of the card is a bit less than the nominal capacity of the row
+    capacityMb = (uint64_t)sectorCount * sectorSize / (1024 * 1024);
+    for (k = 0; k < sizeof(sdFormatTable) / sizeof(sdFormatTable[0]) - 1 && capacityMb > row->capacityMb; k++) {
+        row++;
+    }
+#if !FF_FS_EXFAT
+    if (row->fmt == FM_EXFAT) {
+        row = &sdFormatTable[5];
+    }
+#endif
+    param->fmt = row->fmt;
+    param->clusterSize = row->clusterKb * 1024;
+    param->boundary = row->boundaryKb * 1024 / sectorSize;
+    // The f_mkfs alignment is a power of two, the 12 MB and 24 MB AUs are aligned by the largest power of two divisor
+    auSectors &= 0 - auSectors;
+    if (param->boundary < auSectors) {
+        param->boundary = auSectors;
+    }
+    if (param->boundary > SD_FORMAT_MAX_BOUNDARY) {
+        param->boundary = SD_FORMAT_MAX_BOUNDARY;
+    }
+    // The f_mkfs does not align by the boundary it rejects
+    if (param->boundary == 0 || (param->boundary & (param->boundary - 1)) != 0) {
+        return FR_INVALID_PARAMETER;
+    }
+
+    return FR_OK;
+}
+
+FRESULT sdFormat(const TCHAR *path, BYTE pdrv, void *work, UINT len)
+{
+    SdFormatParam param;
+    MKFS_PARM mkfsParam;
+    FRESULT result;
+
+    if (disk_initialize(pdrv) & STA_NOINIT) {
+        return FR_NOT_READY;
+    }
+    result = sdFormatGetParam(pdrv, &param);
+    if (result != FR_OK) {
+        return result;
+    }
+    memset(&mkfsParam, 0, sizeof(mkfsParam));
+    mkfsParam.fmt = param.fmt;
+    mkfsParam.n_fat = param.fmt == FM_EXFAT ? 1 : 2;
+    mkfsParam.align = param.boundary;
+    mkfsParam.au_size = param.clusterSize;
+    result = f_mkfs(path, &mkfsParam, work, len);
+    // The cluster count of the table cluster size is out of the FAT sub-type range on the volume
+    if (result == FR_MKFS_ABORTED) {
+        mkfsParam.au_size = 0;
+        result = f_mkfs(path, &mkfsParam, work, len);
+    }
+
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef __SD_FORMAT_H__
+#define __SD_FORMAT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ff.h"
+
+/*
+ * The format of the SD card by the parameters of the SD Association File System
+ * Specification. The file system type, the cluster size and the boundary unit
+ * are selected by the card capacity, the boundary is the larger of the boundary
+ * unit and the card AU size. The AU of 12 MB or 24 MB is not a power of two, its
+ * largest power of two divisor is used. The partition, the FAT and the data area
+ * start on the boundary, so the cluster never straddles the erase block.
+ */
+
+typedef struct {
+    BYTE fmt;                  // FM_FAT, FM_FAT32 or FM_EXFAT
+    DWORD clusterSize;         // bytes
+    DWORD boundary;            // sectors
+} SdFormatParam;
+
+/**
+ * @brief Get the format parameters of the drive
+ * @param[in] pdrv - the physical drive of the SD card, initialized by disk_initialize
+ * @param[out] param - the selected parameters
+ * @return FR_INVALID_PARAMETER if the boundary is not a power of two up to 0x8000 sectors
+ */
+FRESULT sdFormatGetParam(BYTE pdrv, SdFormatParam *param);
+
+/**
+ * @brief Format the SD card with the one partition by the parameters of the sdFormatGetParam.
+ *        The cluster size selected by the FatFs is used if the one of the table does not
+ *        fit the FAT sub-type on the volume
+ * @param[in] path - the logical drive of the card
+ * @param[in] pdrv - the physical drive of the card
+ * @param[in] work - the f_mkfs working buffer, at least FF_MAX_SS bytes
+ * @param[in] len - the size of the working buffer in bytes
+ */
+FRESULT sdFormat(const TCHAR *path, BYTE pdrv, void *work, UINT len);
+
+#endif
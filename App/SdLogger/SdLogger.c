@@ -0,0 +1,248 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "SdLogger.h"
+
+#if defined(__arm__)
+#include "cmsis_compiler.h"
+#endif
+
+/*
+ * The counter of the several producers, the ISR can preempt the read-modify-write of the task
+ */
+static void sdLoggerAtomicAdd(volatile uint32_t *value, uint32_t add)
+{
+#if defined(__arm__)
+    uint32_t sum;
+
+    do {
+        sum = __LDREXW(value) + add;
+    } while (__STREXW(sum, value) != 0);
+#else
+    __atomic_fetch_add(value, add, __ATOMIC_RELAXED);
+#endif
+}
+
+FRESULT sdLoggerOpen(SdLoggerH *handler, const TCHAR *path, FSIZE_t capacity, const SdLoggerConfig *config)
+{
+    FRESULT result;
+
+    if (handler == NULL || config == NULL || config->getTimeUs == NULL
+        || config->lowWatermark > config->highWatermark || config->highWatermark > config->ringSize) {
+        return FR_INVALID_PARAMETER;
+    }
+    memset(handler, 0, sizeof(SdLoggerH));
+    handler->config = *config;
+    if (ringBuffMpscInit(&handler->ring, config->ringBuff, config->ringSize) != RING_BUFF_OK) {
+        return FR_INVALID_PARAMETER;
+    }
+    if (config->compress != NULL) {
+        logCompressInit(config->compress);
+    }
+    result = rawLogOpen(&handler->log, path, capacity);
+    handler->lastSyncUs = config->getTimeUs();
+    handler->lastTimeUs = handler->lastSyncUs;
+
+    return result;
+}
+
+// The collected records are compressed and written to the raw log
+static FRESULT sdLoggerWriteFrame(SdLoggerH *handler)
+{
+    const uint8_t *frame;
+    uint32_t size = logCompressFrame(handler->config.compress, &frame);
+
+    return size != 0 ? rawLogWrite(&handler->log, frame, size) : FR_OK;
+}
+
+/*
+ * The record is collected to the frame of the compression, the frame is written before the
+ * record that does not fit in it. The record of more than the frame size continues in the next frames
+ */
+static FRESULT sdLoggerWrite(SdLoggerH *handler, const void *data, uint32_t size)
+{
+    LogCompressH *compress = handler->config.compress;
+    const uint8_t *record = data;
+    uint32_t chunk;
+    FRESULT result = FR_OK;
+
+    if (compress == NULL) {
+        return rawLogWrite(&handler->log, data, size);
+    }
+    if (size > logCompressGetFree(compress)) {
+        result = sdLoggerWriteFrame(handler);
+    }
+    while (result == FR_OK && size != 0) {
+        chunk = logCompressAppend(compress, record, size);
+        record += chunk;
+        size -= chunk;
+        if (size != 0) {
+            result = sdLoggerWriteFrame(handler);
+        }
+    }
+
+    return result;
+}
+
+SdLoggerResult sdLoggerPush(SdLoggerH *handler, uint16_t id, const void *data, uint16_t size)
+{
+    SdLoggerRecord *record;
+    uint8_t *space;
+    int32_t result;
+
+    result = ringBuffMpscReserve(&handler->ring, sizeof(SdLoggerRecord) + size, &space);
+    if (result == RING_BUFF_SIZE_ERROR) {
+        return SD_LOGGER_RESULT_SIZE_ERROR;
+    }
+    if (result != RING_BUFF_OK) {
+        sdLoggerAtomicAdd(&handler->droppedRecords, 1);
+        sdLoggerAtomicAdd(&handler->droppedBytes, size);
+        handler->throttled = true;
+        return SD_LOGGER_RESULT_DROPPED;
+    }
+    // The ring record is 4 bytes aligned
+    record = (SdLoggerRecord *)space;
+    record->timeUs = handler->config.getTimeUs();
+    record->id = id;
+    record->size = size;
+    memcpy(&space[sizeof(SdLoggerRecord)], data, size);
+    ringBuffMpscCommit(&handler->ring, space);
+    if (ringBuffMpscGetUsed(&handler->ring) > handler->config.highWatermark) {
+        handler->throttled = true;
+    }
+
+    return handler->throttled ? SD_LOGGER_RESULT_THROTTLED : SD_LOGGER_RESULT_OK;
+}
+
+bool sdLoggerIsThrottled(SdLoggerH *handler)
+{
+    return handler->throttled;
+}
+
+/*
+ * The drop record after the records of the ring, the records are dropped when the ring is full.
+ * It has the time of the record before it, the records pushed after it can be earlier than now
+ */
+static FRESULT sdLoggerWriteDrops(SdLoggerH *handler)
+{
+    struct {
+        SdLoggerRecord record;
+        uint32_t count;
+    } drop;
+    uint32_t dropped = handler->droppedRecords;
+    FRESULT result;
+
+    if (dropped == handler->loggedDrops) {
+        return FR_OK;
+    }
+    drop.record.timeUs = handler->lastTimeUs;
+    drop.record.id = SD_LOGGER_ID_DROP;
+    drop.record.size = sizeof(drop.count);
+    drop.count = dropped - handler->loggedDrops;
+    result = sdLoggerWrite(handler, &drop, sizeof(drop));
+    if (result == FR_OK) {
+        handler->loggedDrops = dropped;
+    }
+
+    return result;
+}
+
+FRESULT sdLoggerProcess(SdLoggerH *handler)
+{
+    uint32_t startUs;
+    uint32_t timeUs;
+    uint32_t budget;
+    uint32_t tail;
+    uint32_t size;
+    const uint8_t *data;
+    FRESULT result = FR_OK;
+
+    if (handler == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    startUs = handler->config.getTimeUs();
+    // The ring is at its maximum after the write stall
+    budget = ringBuffMpscGetUsed(&handler->ring);
+    if (budget > handler->statistic.maxRingUsed) {
+        handler->statistic.maxRingUsed = budget;
+    }
+    // The budget is of the ring bytes with the headers and the padding, the consumer tail counts them
+    tail = handler->ring.tail;
+    while (handler->ring.tail - tail < budget && (size = ringBuffMpscPeek(&handler->ring, &data)) != 0) {
+        result = sdLoggerWrite(handler, data, size);
+        if (result != FR_OK) {
+            break;
+        }
+        // The released record is zeroed
+        handler->lastTimeUs = ((const SdLoggerRecord *)data)->timeUs;
+        ringBuffMpscRelease(&handler->ring);
+        handler->statistic.records++;
+        handler->statistic.bytes += size;
+        if (handler->throttled && ringBuffMpscGetUsed(&handler->ring) <= handler->config.lowWatermark) {
+            handler->throttled = false;
+            handler->statistic.throttleEvents++;
+        }
+    }
+    if (result == FR_OK) {
+        result = sdLoggerWriteDrops(handler);
+    }
+    timeUs = handler->config.getTimeUs();
+    if (result == FR_OK && handler->config.syncIntervalMs != 0
+        && timeUs - handler->lastSyncUs >= handler->config.syncIntervalMs * 1000) {
+        result = sdLoggerSync(handler);
+        timeUs = handler->config.getTimeUs();
+    }
+    if (timeUs - startUs > handler->statistic.maxProcessUs) {
+        handler->statistic.maxProcessUs = timeUs - startUs;
+    }
+
+    return result;
+}
+
+FRESULT sdLoggerSync(SdLoggerH *handler)
+{
+    FRESULT result = FR_OK;
+
+    if (handler == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    handler->lastSyncUs = handler->config.getTimeUs();
+    // The synced log ends by the whole frame
+    if (handler->config.compress != NULL) {
+        result = sdLoggerWriteFrame(handler);
+    }
+
+    return result == FR_OK ? rawLogSync(&handler->log) : result;
+}
+
+FRESULT sdLoggerClose(SdLoggerH *handler)
+{
+    const uint8_t *data;
+    FRESULT result = FR_OK;
+
+    if (handler == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    while (result == FR_OK && ringBuffMpscPeek(&handler->ring, &data) != 0) {
+        result = sdLoggerProcess(handler);
+    }
+    if (result == FR_OK) {
+        result = sdLoggerWriteDrops(handler);
+    }
+    if (result == FR_OK && handler->config.compress != NULL) {
+        result = sdLoggerWriteFrame(handler);
+    }
+    if (result == FR_OK) {
+        result = rawLogClose(&handler->log);
+    }
+
+    return result;
+}
+
+void sdLoggerGetStatistic(SdLoggerH *handler, SdLoggerStatistic *statistic)
+{
+    *statistic = handler->statistic;
+    statistic->droppedRecords = handler->droppedRecords;
+    statistic->droppedBytes = handler->droppedBytes;
+}
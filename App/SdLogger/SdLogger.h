@@ -0,0 +1,122 @@
+#ifndef __SD_LOGGER_H__
+#define __SD_LOGGER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ff.h"
+#include "RingBuff.h"
+#include "RawLog.h"
+#include "LogCompress.h"
+
+/*
+ * The record log of the high rate producers. The producers are the ISRs and the
+ * tasks, they push the timestamped records to the lock-free MPSC ring and never
+ * wait for the card. The writer task takes the records from the ring to the raw
+ * log, the raw log collects them to the sector aligned batches and writes them by
+ * the multi-block write to the preallocated file. The ring keeps the records while
+ * the write is stalled by the card, its size is the record rate by the longest
+ * write latency. Above the high watermark the producers are throttled until the
+ * writer drains the ring below the low watermark. The record that does not fit in
+ * the ring is dropped and counted, the writer logs the drop record with the count.
+ * The records can be compressed by the frames of the LogCompress before the raw
+ * log, the frame starts on the record, so the log is read from any frame. The frame
+ * is found by its sync word from any 4 bytes aligned offset of the log.
+ * The record is copied once from the ring to the sector batch of the raw log or to
+ * the frame of the compression. The ring is not written to the card in place: each
+ * record has the claim header of the MPSC ring that is not in the log, and the
+ * bip-buffer of the RingBuff with the contiguous regions has the single producer only.
+ */
+
+#define SD_LOGGER_ID_DROP    0xFFFF    // the data is the uint32_t count of the dropped records
+
+typedef enum {
+    SD_LOGGER_RESULT_OK,
+    SD_LOGGER_RESULT_THROTTLED,        // the record is stored, the ring is above the high watermark
+    SD_LOGGER_RESULT_DROPPED,          // the ring is full, the record is dropped
+    SD_LOGGER_RESULT_SIZE_ERROR,       // the record is more than the half of the ring
+} SdLoggerResult;
+
+// The record in the log file, the data follows the header without the alignment
+typedef struct {
+    uint32_t timeUs;                   // the push time
+    uint16_t id;
+    uint16_t size;                     // the data size
+} SdLoggerRecord;
+
+typedef struct {
+    uint8_t *ringBuff;                 // 4 bytes aligned
+    uint32_t ringSize;                 // power of two
+    uint32_t highWatermark;            // the ring bytes to start the throttling
+    uint32_t lowWatermark;             // the ring bytes to end the throttling
+    uint32_t syncIntervalMs;           // 0 - the file size is updated by the sdLoggerSync only
+    uint32_t (*getTimeUs)(void);
+    LogCompressH *compress;            // NULL - the records are logged without the compression
+} SdLoggerConfig;
+
+typedef struct {
+    uint32_t records;                  // the records written to the log
+    uint32_t bytes;                    // with the record headers
+    uint32_t droppedRecords;
+    uint32_t droppedBytes;
+    uint32_t throttleEvents;
+    uint32_t maxRingUsed;              // the ring bytes with the ring headers
+    uint32_t maxProcessUs;             // the longest sdLoggerProcess call
+} SdLoggerStatistic;
+
+typedef struct {
+    RawLogH log;
+    RingBuffMpscH ring;
+    SdLoggerConfig config;
+    volatile bool throttled;
+    volatile uint32_t droppedRecords;  // the producers by the exclusive access
+    volatile uint32_t droppedBytes;
+    uint32_t loggedDrops;              // the writer only
+    uint32_t lastTimeUs;               // the time of the last written record
+    uint32_t lastSyncUs;
+    SdLoggerStatistic statistic;
+} SdLoggerH;
+
+/**
+ * @brief Create the log file and start the logging
+ * @param[out] handler - the logger handler
+ * @param[in] path - the file path, the existing file is overwritten
+ * @param[in] capacity - the preallocated file size in bytes
+ * @param[in] config - the ring and the watermarks
+ */
+FRESULT sdLoggerOpen(SdLoggerH *handler, const TCHAR *path, FSIZE_t capacity, const SdLoggerConfig *config);
+
+/**
+ * @brief Push the record, the producer side. It is safe for the ISR and does not wait
+ * @param[in] id - the record id, SD_LOGGER_ID_DROP is reserved
+ * @param[in] data - the record data
+ * @param[in] size - the data size
+ * @return SD_LOGGER_RESULT_THROTTLED if the producer should reduce the record rate
+ */
+SdLoggerResult sdLoggerPush(SdLoggerH *handler, uint16_t id, const void *data, uint16_t size);
+
+/**
+ * @brief Check the throttling before the record is sampled
+ */
+bool sdLoggerIsThrottled(SdLoggerH *handler);
+
+/**
+ * @brief Write the records of the ring to the log, the writer task side. The records pushed
+ *        during the call are left for the next call, so the call time is bounded
+ * @return FR_DENIED if the log capacity is exhausted
+ */
+FRESULT sdLoggerProcess(SdLoggerH *handler);
+
+/**
+ * @brief Write the buffered records and update the file size in the directory entry
+ */
+FRESULT sdLoggerSync(SdLoggerH *handler);
+
+/**
+ * @brief Write all the records of the ring and close the log. The producers are stopped before it
+ */
+FRESULT sdLoggerClose(SdLoggerH *handler);
+
+void sdLoggerGetStatistic(SdLoggerH *handler, SdLoggerStatistic *statistic);
+
+#endif
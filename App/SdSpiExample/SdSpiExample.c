@@ -85,11 +85,9 @@ static bool sdSpiSetCsStateCb(bool set)
     return true;
 }
 
-static bool sdSpiSetSckFrqCb(bool hight)
+static bool sdSpiSetSckFrqCb(uint32_t frq)
 {
-    //LL_GPIO_SetOutputPin(ETH_SPI_GPIO_CS_PORT, ETH_SPI_GPIO_CS_PIN);
-
-    return true;
+    return spiSetSpeed(SPI_ETH, frq) == SPI_RES_OK;
 }
 
 static uint32_t sdSpiGetTimeMsCb(void)
@@ -160,7 +158,28 @@ void  sdSpiExampleRun(void)
     sdSpiInitilisation();
 
     sdSpiGetMetaInformation(&sdSpiHandler, &metaInformation);
-    PRINT_LOG("Sd capacity: %u\n", (unsigned int)metaInformation.capcityMb);
+    PRINT_LOG("Sd capacity: %u MB\n", (unsigned int)(metaInformation.capacity / (1024 * 1024)));
+
+    /*
+     * Tune the clock and timeouts. The scratch area is at the end of the
+     * example buffer LBA range and its content is destroyed
+     */
+    SdSpiCalibration calibration = {
+        .scratchAddress = 8192 + 64,
+        .scratchBlocks = RX_DATA_SIZE / 512,
+        .buff = sdCardData,
+        .sckFrq = {1000000, 5000000, 10000000, 20000000, 25000000},
+        .sckFrqNumber = 5,
+    };
+    SdSpiTiming timing;
+
+    result = sdSpiCalibrate(&sdSpiHandler, &calibration);
+    sdSpiGetTiming(&sdSpiHandler, &timing);
+    PRINT_LOG("Sd calibration result: %u\n", result);
+    PRINT_LOG("Sd sck: %u Hz, chunk: %u blocks, %u B/s\n", (unsigned int)timing.sckFrq,
+              (unsigned int)timing.transferBlocks, (unsigned int)timing.throughput);
+    PRINT_LOG("Sd busy p50/p99/max: %u/%u/%u ms\n", (unsigned int)timing.busyP50Ms,
+              (unsigned int)timing.busyP99Ms, (unsigned int)timing.busyMaxMs);
 
     /*
      * Test receive 1 LBA (512 bytes)
@@ -317,3 +317,41 @@ SpiResult spiCsControl(SpiTarget target, bool set)
 
     return SPI_RES_OK;
 }
+
+SpiResult spiSetSpeed(SpiTarget target, uint32_t speed)
+{
+    static const uint32_t prescaler[] = {
+        LL_SPI_BAUDRATEPRESCALER_DIV2,
+        LL_SPI_BAUDRATEPRESCALER_DIV4,
+        LL_SPI_BAUDRATEPRESCALER_DIV8,
+        LL_SPI_BAUDRATEPRESCALER_DIV16,
+        LL_SPI_BAUDRATEPRESCALER_DIV32,
+        LL_SPI_BAUDRATEPRESCALER_DIV64,
+        LL_SPI_BAUDRATEPRESCALER_DIV128,
+        LL_SPI_BAUDRATEPRESCALER_DIV256,
+    };
+    LL_RCC_ClocksTypeDef clocks;
+    uint32_t k = 0;
+
+    if (target >= SPI_CNT) {
+        return SPI_RES_SPI_TARGET_ERROR;
+    }
+    if (spiIsTransactionComplete(target) == false) {
+        return SPI_RES_HW_ERROR;
+    }
+
+    /*
+     * SPI1 is clocked from APB2, SCK = PCLK2 / (2 << k)
+     */
+    LL_RCC_GetSystemClocksFreq(&clocks);
+    while (k < sizeof(prescaler) / sizeof(prescaler[0]) - 1
+           && (clocks.PCLK2_Frequency >> (k + 1)) > speed) {
+        k++;
+    }
+
+    LL_SPI_Disable(ETH_SPI_SPI);
+    LL_SPI_SetBaudRatePrescaler(ETH_SPI_SPI, prescaler[k]);
+    LL_SPI_Enable(ETH_SPI_SPI);
+
+    return SPI_RES_OK;
+}
@@ -44,4 +44,9 @@ SpiResult spiTx(SpiTarget target, uint8_t buff[], uint32_t size);
 SpiResult spiRx(SpiTarget target, uint8_t buff[], uint32_t size);
 SpiResult spiCsControl(SpiTarget target, bool set);
 
+/**
+ * @brief Set the highest SCK frequency not exceeding the requested one
+ */
+SpiResult spiSetSpeed(SpiTarget target, uint32_t speed);
+
 #endif
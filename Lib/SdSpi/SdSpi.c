@@ -18,12 +18,18 @@ static const struct {
     { SD_CMD9, SD_RESPONSE_TYPE_R1},
     { SD_CMD10, SD_RESPONSE_TYPE_R1},
     { SD_CMD12, SD_RESPONSE_TYPE_R1B},
+    { SD_CMD13, SD_RESPONSE_TYPE_R2},
     { SD_CMD16, SD_RESPONSE_TYPE_R1},
     { SD_CMD17, SD_RESPONSE_TYPE_R1},
     { SD_CMD18, SD_RESPONSE_TYPE_R1},
+    { SD_CMD22, SD_RESPONSE_TYPE_R1},
     { SD_CMD23, SD_RESPONSE_TYPE_R1},
     { SD_CMD24, SD_RESPONSE_TYPE_R1},
     { SD_CMD25, SD_RESPONSE_TYPE_R1},
+    { SD_CMD32, SD_RESPONSE_TYPE_R1},
+    { SD_CMD33, SD_RESPONSE_TYPE_R1},
+    { SD_CMD38, SD_RESPONSE_TYPE_R1B},
+    { SD_CMD51, SD_RESPONSE_TYPE_R1},
     { SD_CMD55, SD_RESPONSE_TYPE_R1},
     { SD_CMD58, SD_RESPONSE_TYPE_R3},
 };
@@ -62,6 +68,57 @@ static inline void sdSpiSwapBytes(uint8_t *buff, uint32_t buffSize)
     }
 }
 
+/*
+ * Return the field of the register content swapped by sdSpiSwapBytes:
+ * the bit N of the register is the bit (N % 8) of the byte (N / 8)
+ */
+static uint32_t sdSpiGetBits(const uint8_t *content, uint32_t pos, uint32_t width)
+{
+    uint32_t value = 0;
+
+    for (uint32_t k = 0; k < width; k++) {
+        value |= ((content[(pos + k) / 8] >> ((pos + k) % 8)) & 1) << k;
+    }
+
+    return value;
+}
+
+/*
+ * Return the card capacity in 512 bytes blocks
+ */
+static uint64_t sdSpiCsdBlockCount(const uint8_t csdContent[SD_SPI_CSD_BYTES])
+{
+    uint32_t cSize;
+    uint32_t shift;
+
+    if (sdSpiGetBits(csdContent, SD_CSD_STRUCTURE_POS, SD_CSD_STRUCTURE_WIDTH)
+        == SD_CSD_STRUCTURE_V1) {
+        /*
+         * capacity = (C_SIZE + 1) * 2^(C_SIZE_MULT + 2) * 2^READ_BL_LEN
+         */
+        cSize = sdSpiGetBits(csdContent, SD_CSD_V1_C_SIZE_POS, SD_CSD_V1_C_SIZE_WIDTH);
+        shift = sdSpiGetBits(csdContent, SD_CSD_V1_C_SIZE_MULT_POS, SD_CSD_V1_C_SIZE_MULT_WIDTH) + 2
+                + sdSpiGetBits(csdContent, SD_CSD_V1_READ_BL_LEN_POS, SD_CSD_V1_READ_BL_LEN_WIDTH);
+        return (uint64_t)(cSize + 1) << (shift - 9);
+    }
+
+    /*
+     * capacity = (C_SIZE + 1) * 512 KB
+     */
+    cSize = sdSpiGetBits(csdContent, SD_CSD_V2_C_SIZE_POS, SD_CSD_V2_C_SIZE_WIDTH);
+    return (uint64_t)(cSize + 1) * 1024;
+}
+
+/*
+ * Take / release the SPI bus if the application shares it, see sdSpiBusLock
+ */
+static inline void sdSpiBusLock(SdSpiH *handler, bool lock)
+{
+    if (handler->cb.sdSpiBusLock != NULL) {
+        handler->cb.sdSpiBusLock(lock);
+    }
+}
+
 static void sdSpiDelay(SdSpiH *handler, uint32_t delay)
 {
     uint32_t startTime = handler->cb.sdSpiGetTimeMs();
@@ -109,6 +166,10 @@ static SdSpiIntStatus sdSpiSerializeReq(uint8_t *buffer, SdSpiCmdReq request)
     case SD_CMD9:
     case SD_CMD10:
     case SD_CMD12:
+    case SD_CMD13:
+    case SD_CMD22:
+    case SD_CMD38:
+    case SD_CMD51:
     case SD_CMD55:
     case SD_CMD58:
     case SD_CMD0:
@@ -158,6 +219,14 @@ static SdSpiIntStatus sdSpiSerializeReq(uint8_t *buffer, SdSpiCmdReq request)
         arg = request.cmd25.address;
         break;
 
+    case SD_CMD32:
+        arg = request.cmd32.address;
+        break;
+
+    case SD_CMD33:
+        arg = request.cmd33.address;
+        break;
+
     default:
         return SD_SPI_UNSUPORTED_COMMAND_ERR_INT_STATUS;
     }
@@ -261,6 +330,8 @@ static size_t sdSpiGetRespSize(SdRespType respType)
         return SD_R3_RESP_SIZE;
     } else if (respType == SD_RESPONSE_TYPE_R7) {
         return SD_R7_RESP_SIZE;
+    } else if (respType == SD_RESPONSE_TYPE_R2) {
+        return SD_R2_RESP_SIZE;
     }
 
     return 0;
@@ -277,7 +348,32 @@ static SdRespType sdSpiGetRespType(SdSpiCmd cmd)
     return SD_RESPONSE_TYPE_CNT;
 }
 
-static SdSpiResult sdSpiWaiteBusy(SdSpiH *handler)
+static void sdSpiProbeBusy(SdSpiH *handler, uint32_t busyTime)
+{
+    struct SdSpiProbeStatistic *statistic = handler->probeStatistic;
+
+    if (statistic == NULL) {
+        return;
+    }
+    statistic->busyCnt++;
+    statistic->busyHistogram[busyTime < SD_BUSY_HISTOGRAM_SIZE
+                             ? busyTime
+                             : SD_BUSY_HISTOGRAM_SIZE - 1]++;
+    if (busyTime > statistic->busyMaxMs) {
+        statistic->busyMaxMs = busyTime;
+    }
+}
+
+static void sdSpiProbeDataToken(SdSpiH *handler, uint32_t waiteBytes)
+{
+    struct SdSpiProbeStatistic *statistic = handler->probeStatistic;
+
+    if (statistic != NULL && waiteBytes > statistic->dataTokenMaxBytes) {
+        statistic->dataTokenMaxBytes = waiteBytes;
+    }
+}
+
+static SdSpiResult sdSpiWaiteBusy(SdSpiH *handler, uint32_t timeoutMs)
 {
     uint8_t buff = 0x00;
     uint32_t startTime = handler->cb.sdSpiGetTimeMs();
@@ -285,7 +381,7 @@ static SdSpiResult sdSpiWaiteBusy(SdSpiH *handler)
     debugServicesPinSet(DebugPin1);
 
     handler->cb.sdSpiReceive(&buff, 1);
-    while (handler->cb.sdSpiGetTimeMs() - startTime < SD_BUSY_TIMEOUTE) {
+    while (handler->cb.sdSpiGetTimeMs() - startTime < timeoutMs) {
         if (handler->cb.sdSpiReceive(&buff, 1) == false) {
             return SD_SPI_RESULT_RECEIVE_CB_RETURN_ERROR;
         }
@@ -294,6 +390,7 @@ static SdSpiResult sdSpiWaiteBusy(SdSpiH *handler)
         }
     }
     debugServicesPinClear(DebugPin1);
+    sdSpiProbeBusy(handler, handler->cb.sdSpiGetTimeMs() - startTime);
     return buff == 0x00
            ? (intTrace->intStatus = SD_SPI_BUSY_TIMEOUTE_ERR_INT_STATUS, SD_SPI_RESULT_INTERNAL_ERROR)
            : SD_SPI_RESULT_OK;
@@ -400,7 +497,9 @@ static SdSpiResult sdSpiCmdTransaction(SdSpiH *handler, SdSpiCmdReq request,
      * before complete using the card
      */
     if (respType == SD_RESPONSE_TYPE_R1B) {
-        result = sdSpiWaiteBusy(handler);
+        result = sdSpiWaiteBusy(handler, request.cmd == SD_CMD38
+                                         ? request.cmd38.busyTimeoutMs
+                                         : handler->timing.busyTimeoutMs);
     }
 
     return result;
@@ -458,50 +557,95 @@ static SdSpiResult sdSpiCardRun(SdSpiH *handler, SdCardVersion sdVersion)
     return result;
 }
 
-SdSpiResult sdSpiInit(SdSpiH *handler, const SdSpiCb *cb)
+static void sdSpiReadEraseInformation(SdSpiH *handler)
 {
-#define SD_SPI_TRANSACTION_BUFF_SIZE           10
-    SdSpiResult result;
-    SdSpiCmdReq request;
-    SdSpiCmdResp response;
-    uint8_t transactionBuff[SD_SPI_TRANSACTION_BUFF_SIZE];
-    SdSpiInternalTrace *intTrace = (SdSpiInternalTrace *)handler->serviceBuff;
+    /*
+     * The AU size in 512 bytes blocks by the AU_SIZE field value
+     */
+    static const uint32_t auBlocks[] = {
+        0, 32, 64, 128, 256, 512, 1024, 2048,
+        4096, 8192, 16384, 24576, 32768, 49152, 65536, 131072,
+    };
+    static const uint8_t speedClass[] = {0, 2, 4, 6, 10};
+    uint8_t csdContent[SD_SPI_CSD_BYTES];
+    uint8_t sdStatus[SD_SPI_SD_STATUS_BYTES];
+    uint8_t scr[SD_SPI_SCR_BYTES];
+    SdSpiCsdV2 *csd = (SdSpiCsdV2 *)csdContent;
+    SdSpiMetaInformation *meta = &handler->metaInformation;
+    uint32_t auSize;
 
-    if (handler == NULL) {
-        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
-    }
-    memset(handler, 0, sizeof(handler));
-    if (cb == NULL) {
-        return SD_SPI_RESULT_CB_NULL_ERROR;
-    }
-    if (cb->sdSpiSend == NULL) {
-        return SD_SPI_RESULT_SEND_CB_NULL_ERROR;
-    }
-    if (cb->sdSpiReceive == NULL) {
-        return SD_SPI_RESULT_RECEIVE_CB_NULL_ERROR;
-    }
-    if (cb->sdSpiSetCsState == NULL) {
-        return SD_SPI_RESULT_SET_CS_CB_NULL_ERROR;
+    /*
+     * The SECTOR_SIZE and ERASE_BLK_EN has the same position in the CSD V1 and V2
+     */
+    if (sdSpiReadCsdRegister(handler, csdContent) == SD_SPI_RESULT_OK) {
+        meta->eraseSectorBlocks = csd->eraseSectorSize + 1;
+        meta->eraseSingleBlock = csd->eraseSingleBlockEnable == 1;
     }
-    if (cb->sdSpiSetSckFrq == NULL) {
-        return SD_SPI_RESULT_SET_FRQ_CB_NULL_ERROR;
+
+    if (sdSpiReadScrRegister(handler, scr) == SD_SPI_RESULT_OK) {
+        meta->erasedToZero = BIT_MASK(scr[SD_SCR_DATA_STAT_AFTER_ERASE_BYTE],
+                                      SD_SCR_DATA_STAT_AFTER_ERASE_POS,
+                                      SD_SCR_DATA_STAT_AFTER_ERASE_MASK) == 0;
     }
-    if (cb->sdSpiGetTimeMs == NULL) {
-        return SD_SPI_RESULT_GET_TIME_CB_NULL_ERROR;
+
+    if (sdSpiReadSdStatusRegister(handler, sdStatus) != SD_SPI_RESULT_OK) {
+        return;
     }
-    if (cb->sdSpiMalloc == NULL) {
-        return SD_SPI_RESULT_GET_TIME_CB_NULL_ERROR;
+
+    auSize = BIT_MASK(sdStatus[SD_STATUS_AU_SIZE_BYTE],
+                      SD_STATUS_AU_SIZE_POS, SD_STATUS_AU_SIZE_MASK);
+    if (auSize == 0) {
+        /*
+         * UHS card could report the AU only by the UHS_AU_SIZE
+         */
+        auSize = BIT_MASK(sdStatus[SD_STATUS_UHS_AU_SIZE_BYTE],
+                          SD_STATUS_UHS_AU_SIZE_POS, SD_STATUS_UHS_AU_SIZE_MASK);
     }
-    handler->cb = *cb;
-    handler->lba = 512;
+    meta->auBlocks = auBlocks[auSize];
+    meta->speedClass = sdStatus[SD_STATUS_SPEED_CLASS_BYTE] < sizeof(speedClass)
+                       ? speedClass[sdStatus[SD_STATUS_SPEED_CLASS_BYTE]]
+                       : 0;
+    meta->eraseSize = (sdStatus[SD_STATUS_ERASE_SIZE_BYTE] << 8)
+                      | sdStatus[SD_STATUS_ERASE_SIZE_BYTE + 1];
+    meta->eraseTimeoutS = BIT_MASK(sdStatus[SD_STATUS_ERASE_TIMEOUT_BYTE],
+                                   SD_STATUS_ERASE_TIMEOUT_POS, SD_STATUS_ERASE_TIMEOUT_MASK);
+    meta->eraseOffsetS = BIT_MASK(sdStatus[SD_STATUS_ERASE_TIMEOUT_BYTE],
+                                  SD_STATUS_ERASE_OFFSET_POS, SD_STATUS_ERASE_OFFSET_MASK);
+}
 
+/*
+ * The specification timeouts of the card type on the data transfer frequency. The
+ * read access time is converted to the bytes of the data token wait
+ */
+static void sdSpiSetSpecTiming(SdSpiH *handler)
+{
+    uint32_t dataTokenBytes = handler->timing.sckFrq / 8 * SD_READ_ACCESS_TIMEOUTE / 1000;
+
+    handler->timing.busyTimeoutMs = handler->metaInformation.capcityType == SD_CARD_CAPACITY_TYPE_EXTENDED
+                                    ? SD_BUSY_TIMEOUTE_SDXC
+                                    : SD_BUSY_TIMEOUTE;
+    handler->timing.dataTokenBytes = dataTokenBytes > SD_WAITE_DATA_TOKEN_BYTES
+                                     ? dataTokenBytes
+                                     : SD_WAITE_DATA_TOKEN_BYTES;
+}
+
+static SdSpiResult sdSpiInitCard(SdSpiH *handler)
+{
+#define SD_SPI_TRANSACTION_BUFF_SIZE           10
+    SdSpiResult result;
+    SdSpiCmdReq request;
+    SdSpiCmdResp response;
+    uint8_t transactionBuff[SD_SPI_TRANSACTION_BUFF_SIZE];
+    SdSpiInternalTrace *intTrace;
     uint32_t serviceBuffSize = 0;
 #ifdef ENABLE_ERROR_TRACE
     serviceBuffSize += sizeof(SdSpiInternalTrace);
 #endif
-    if (handler->cb.sdSpiMalloc(serviceBuffSize) == NULL) {
+    handler->serviceBuff = handler->cb.sdSpiMalloc(serviceBuffSize);
+    if (handler->serviceBuff == NULL) {
         return SD_SPI_RESULT_MALLOC_CB_RERTURN_NULL_ERROR;
     }
+    intTrace = (SdSpiInternalTrace *)handler->serviceBuff;
     /*
      * Accordnig to the SD Documentation
      * section: 7.2.1 Mode Selection and Initilisation
@@ -532,7 +676,7 @@ SdSpiResult sdSpiInit(SdSpiH *handler, const SdSpiCb *cb)
     /*
      * Send > 74 SCK pulces
      */
-    if (cb->sdSpiSend(transactionBuff, 10) == false) {
+    if (handler->cb.sdSpiSend(transactionBuff, 10) == false) {
         return SD_SPI_RESULT_SEND_CB_RETURN_ERROR;
     }
 
@@ -660,18 +804,89 @@ SdSpiResult sdSpiInit(SdSpiH *handler, const SdSpiCb *cb)
     }
 
     /*
-     * If init Ok, read capasity. Currently implemented only for the SD_CARD_VERSION_SD_VER_2_PLUS
+     * If init Ok, read capasity
      */
     if (result == SD_SPI_RESULT_OK) {
-        uint8_t cidContent[SD_SPI_CSD_BYTES];
-        SdSpiCsdV2 *csd = (SdSpiCsdV2 *)cidContent;
+        uint8_t csdContent[SD_SPI_CSD_BYTES];
 
-        result = sdSpiReadCsdRegister(handler, cidContent);
+        result = sdSpiReadCsdRegister(handler, csdContent);
         if (result == SD_SPI_RESULT_OK) {
-            handler->metaInformation.capcityMb = (csd->deviceSize * 512) / 1024;
+            uint64_t blockCount = sdSpiCsdBlockCount(csdContent);
+
+            handler->metaInformation.capacity = blockCount * 512;
+            handler->metaInformation.blockCount = blockCount > UINT32_MAX ? UINT32_MAX : (uint32_t)blockCount;
+            if (sdSpiGetBits(csdContent, SD_CSD_STRUCTURE_POS, SD_CSD_STRUCTURE_WIDTH) == SD_CSD_STRUCTURE_V1) {
+                handler->metaInformation.capcityType = SD_CARD_CAPACITY_TYPE_STANDART;
+            } else if (handler->metaInformation.capacity > (uint64_t)32 * 1024 * 1024 * 1024) {
+                handler->metaInformation.capcityType = SD_CARD_CAPACITY_TYPE_EXTENDED;
+            } else {
+                handler->metaInformation.capcityType = SD_CARD_CAPACITY_TYPE_HIGHT;
+            }
         }
     }
 
+    /*
+     * Read the AU size and the erase parameters. The SD Status is optional,
+     * the card is usable without it
+     */
+    if (result == SD_SPI_RESULT_OK
+        && handler->metaInformation.version != SD_CARD_VERSION_MMC_VER_2) {
+        sdSpiReadEraseInformation(handler);
+    }
+
+    /*
+     * The card is ready, switch to the data transfer frequency
+     */
+    if (result == SD_SPI_RESULT_OK
+        && handler->cb.sdSpiSetSckFrq(handler->timing.sckFrq) == false) {
+        result = SD_SPI_RESULT_SET_FRQ_CB_RETURN_ERROR;
+    }
+    if (result == SD_SPI_RESULT_OK) {
+        sdSpiSetSpecTiming(handler);
+    }
+
+    return result;
+}
+SdSpiResult sdSpiInit(SdSpiH *handler, const SdSpiCb *cb)
+{
+    SdSpiResult result;
+
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+    memset(handler, 0, sizeof(*handler));
+    if (cb == NULL) {
+        return SD_SPI_RESULT_CB_NULL_ERROR;
+    }
+    if (cb->sdSpiSend == NULL) {
+        return SD_SPI_RESULT_SEND_CB_NULL_ERROR;
+    }
+    if (cb->sdSpiReceive == NULL) {
+        return SD_SPI_RESULT_RECEIVE_CB_NULL_ERROR;
+    }
+    if (cb->sdSpiSetCsState == NULL) {
+        return SD_SPI_RESULT_SET_CS_CB_NULL_ERROR;
+    }
+    if (cb->sdSpiSetSckFrq == NULL) {
+        return SD_SPI_RESULT_SET_FRQ_CB_NULL_ERROR;
+    }
+    if (cb->sdSpiGetTimeMs == NULL) {
+        return SD_SPI_RESULT_GET_TIME_CB_NULL_ERROR;
+    }
+    if (cb->sdSpiMalloc == NULL) {
+        return SD_SPI_RESULT_GET_TIME_CB_NULL_ERROR;
+    }
+    handler->cb = *cb;
+    handler->lba = 512;
+    handler->timing.sckFrq = SD_SPI_FAST_FRQ;
+    handler->timing.transferBlocks = 1;
+    handler->timing.busyTimeoutMs = SD_BUSY_TIMEOUTE;
+    handler->timing.dataTokenBytes = SD_WAITE_DATA_TOKEN_BYTES;
+
+    sdSpiBusLock(handler, true);
+    result = sdSpiInitCard(handler);
+    sdSpiBusLock(handler, false);
+
     return result;
 }
 
@@ -686,7 +901,7 @@ static SdSpiResult sdSpiReadBlock(SdSpiH *handler, uint8_t *data, uint32_t dataS
      * Waite while the SD card start transmit data.
      * Receive Data Token
      */
-    for (; k < SD_WAITE_DATA_TOKEN_BYTES; k++) {
+    for (; k < handler->timing.dataTokenBytes; k++) {
         handler->cb.sdSpiReceive(&dataToken, sizeof(dataToken));
         if (dataToken == SD_TOKEN_DATA_17_18_24) {
             /*
@@ -702,7 +917,8 @@ static SdSpiResult sdSpiReadBlock(SdSpiH *handler, uint8_t *data, uint32_t dataS
         }
     }
 
-    if (k == SD_WAITE_DATA_TOKEN_BYTES) { // card don't reply
+    sdSpiProbeDataToken(handler, k);
+    if (k == handler->timing.dataTokenBytes) { // card don't reply
         result = SD_SPI_RESULT_NO_RESPONSE_ERROR;
     } else if (result == SD_SPI_RESULT_OK) {
         /*
@@ -719,24 +935,29 @@ static SdSpiResult sdSpiReadBlock(SdSpiH *handler, uint8_t *data, uint32_t dataS
     return result;
 }
 
-SdSpiResult sdSpiRead(SdSpiH *handler, uint32_t address, uint8_t *data, size_t dataLength)
+static bool sdSpiIsRecoverable(SdSpiResult result)
+{
+    return result == SD_SPI_RESULT_NO_RESPONSE_ERROR
+           || result == SD_SPI_RESULT_RESPONSE_ERROR
+           || result == SD_SPI_RESULT_RECEIVE_ERROR
+           || result == SD_SPI_RESULT_WRITE_ERROR
+           || result == SD_SPI_RESULT_INTERNAL_ERROR;
+}
+
+/*
+ * One read transaction. Return the number of the successfully read blocks
+ * through the completed, also in case of error
+ */
+static SdSpiResult sdSpiReadTransfer(SdSpiH *handler, uint32_t address, uint8_t *data,
+                                     size_t dataLength, size_t *completed)
 {
-    SdSpiResult result = SD_SPI_OK_INT_STATUS;
+    SdSpiResult result;
+    SdSpiResult stopResult;
     SdSpiCmdReq request;
     SdSpiCmdResp response;
     bool multipleBlock = dataLength > 1;
 
-    if (handler == NULL) {
-        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
-    }
-
-    if (data == NULL) {
-        return SD_SPI_RESULT_DATA_NULL_ERROR;
-    }
-
-    if (dataLength == 0) {
-        return SD_SPI_RESULT_DATA_LENGTH_ZERO_ERROR;
-    }
+    *completed = 0;
 
     /*
      * Send the address from which start read data
@@ -762,15 +983,20 @@ SdSpiResult sdSpiRead(SdSpiH *handler, uint32_t address, uint8_t *data, size_t d
                 if (result != SD_SPI_RESULT_OK) {
                     break;
                 }
+                (*completed)++;
             }
 
             /*
              * If read more than one LBA, send STOP command
-             * to stop data transacrion from the card
+             * to stop data transacrion from the card. The STOP command
+             * is sent also after the error to return the card to the transfer state
              */
-            if (dataLength > 1) {
+            if (multipleBlock) {
                 request.cmd = SD_CMD12;
-                result = sdSpiCmdTransaction(handler, request, &response, false);
+                stopResult = sdSpiCmdTransaction(handler, request, &response, false);
+                if (result == SD_SPI_RESULT_OK) {
+                    result = stopResult;
+                }
             }
         }
     }
@@ -783,6 +1009,48 @@ SdSpiResult sdSpiRead(SdSpiH *handler, uint32_t address, uint8_t *data, size_t d
     return result;
 }
 
+SdSpiResult sdSpiRead(SdSpiH *handler, uint32_t address, uint8_t *data, size_t dataLength)
+{
+    SdSpiResult result;
+    size_t done = 0;
+    size_t completed;
+    uint32_t retry = 0;
+
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+
+    if (data == NULL) {
+        return SD_SPI_RESULT_DATA_NULL_ERROR;
+    }
+
+    if (dataLength == 0) {
+        return SD_SPI_RESULT_DATA_LENGTH_ZERO_ERROR;
+    }
+
+    /*
+     * In case of error re-issue the rest of the data from the failed block.
+     * The retry counter is reset by any progress
+     */
+    sdSpiBusLock(handler, true);
+    do {
+        result = sdSpiReadTransfer(handler, address + done, data + done * SDIO_SPI_FAT_LBA,
+                                   dataLength - done, &completed);
+        done += completed;
+        if (completed != 0) {
+            retry = 0;
+        }
+    } while (result != SD_SPI_RESULT_OK
+             && done < dataLength
+             && sdSpiIsRecoverable(result)
+             && retry++ < SD_TRANSFER_RETRIES);
+    sdSpiBusLock(handler, false);
+
+    handler->completedBlocks = done;
+
+    return result;
+}
+
 static SdSpiResult sdSpiWriteBlock(SdSpiH *handler, uint8_t *data, WriteType writeType)
 {
     uint32_t k = 0;
@@ -823,7 +1091,7 @@ static SdSpiResult sdSpiWriteBlock(SdSpiH *handler, uint8_t *data, WriteType wri
     if (writeType == WRITE_TYPE_MULTIPLE_WITHOUT_PRE_ERACING ||
         writeType == WRITE_TYPE_SINGLE) {
 
-        for (; k < SD_WAITE_DATA_TOKEN_BYTES; k++) {
+        for (; k < handler->timing.dataTokenBytes; k++) {
             handler->cb.sdSpiReceive(&dataResponse, sizeof(dataResponse));
             dataResponse &= SD_WRITE_DATA_RESPONSE_MASK;
             if (dataResponse == SD_WRITE_DATA_RESPONSE_ACCEPTED
@@ -832,7 +1100,8 @@ static SdSpiResult sdSpiWriteBlock(SdSpiH *handler, uint8_t *data, WriteType wri
                 break;
             }
         }
-        if (k == SD_WAITE_DATA_TOKEN_BYTES) {
+        sdSpiProbeDataToken(handler, k);
+        if (k == handler->timing.dataTokenBytes) {
             result = SD_SPI_RESULT_NO_RESPONSE_ERROR;
         } else {
             if (dataResponse != SD_WRITE_DATA_RESPONSE_ACCEPTED) {
@@ -841,7 +1110,7 @@ static SdSpiResult sdSpiWriteBlock(SdSpiH *handler, uint8_t *data, WriteType wri
                 /*
                 * Waite to complete busy state
                 */
-                result = sdSpiWaiteBusy(handler);
+                result = sdSpiWaiteBusy(handler, handler->timing.busyTimeoutMs);
             }
         }
     }
@@ -849,28 +1118,74 @@ static SdSpiResult sdSpiWriteBlock(SdSpiH *handler, uint8_t *data, WriteType wri
     return result;
 }
 
-SdSpiResult sdSpiWrite(SdSpiH *handler, uint32_t address, uint8_t *data, size_t dataLength)
+/*
+ * Read the number of the well written blocks of the last write command (ACMD22).
+ * The error status of the failed write is cleared by CMD13 before
+ */
+static SdSpiResult sdSpiReadWrittenBlocks(SdSpiH *handler, size_t *written)
 {
-    SdSpiResult result = SD_SPI_OK_INT_STATUS;
+    SdSpiResult result;
     SdSpiCmdReq request;
     SdSpiCmdResp response;
-    WriteType writeType = (dataLength == 1)
-                          ? WRITE_TYPE_SINGLE
-                          : WRITE_TYPE_MULTIPLE_WITHOUT_PRE_ERACING;
-    uint8_t token;
+    uint8_t numWrBlocks[SD_NUM_WR_BLOCKS_BYTES];
+    uint32_t blocks = 0;
 
-    if (handler == NULL) {
-        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    request.cmd = SD_CMD13;
+    result = sdSpiCmdTransaction(handler, request, &response, true);
+    if (result != SD_SPI_RESULT_OK) {
+        return result;
     }
 
-    if (data == NULL) {
-        return SD_SPI_RESULT_DATA_NULL_ERROR;
+    /*
+     * CMD55 is a pre command before send comamnd ACMD22
+     */
+    request.cmd = SD_CMD55;
+    result = sdSpiCmdTransaction(handler, request, &response, true);
+    if (result != SD_SPI_RESULT_OK) {
+        return result;
+    } else if (response.r1 != 0) {
+        return SD_SPI_RESULT_RESPONSE_ERROR;
     }
 
-    if (dataLength == 0) {
-        return SD_SPI_RESULT_DATA_LENGTH_ZERO_ERROR;
+    request.cmd = SD_CMD22;
+    result = sdSpiCmdTransaction(handler, request, &response, false);
+    if (result == SD_SPI_RESULT_OK) {
+        if (response.r1 == 0) {
+            result = sdSpiReadBlock(handler, numWrBlocks, sizeof(numWrBlocks));
+        } else {
+            result = SD_SPI_RESULT_RESPONSE_ERROR;
+        }
+    }
+
+    handler->cb.sdSpiSetCsState(true);
+
+    if (result == SD_SPI_RESULT_OK) {
+        DESERIALIASE_ARG(numWrBlocks, blocks);
+        *written = blocks;
     }
 
+    return result;
+}
+
+/*
+ * One write transaction. Return the number of the written blocks
+ * through the completed, also in case of error
+ */
+static SdSpiResult sdSpiWriteTransfer(SdSpiH *handler, uint32_t address, uint8_t *data,
+                                      size_t dataLength, size_t *completed)
+{
+    SdSpiResult result = SD_SPI_RESULT_OK;
+    SdSpiResult stopResult;
+    SdSpiCmdReq request;
+    SdSpiCmdResp response;
+    WriteType writeType = (dataLength == 1)
+                          ? WRITE_TYPE_SINGLE
+                          : WRITE_TYPE_MULTIPLE_WITHOUT_PRE_ERACING;
+    uint8_t token;
+    size_t written = 0;
+
+    *completed = 0;
+
     /*
      * Inform about quantity of the write bloks for the case of multiple block write
      */
@@ -917,7 +1232,7 @@ SdSpiResult sdSpiWrite(SdSpiH *handler, uint32_t address, uint8_t *data, size_t
 
     if (result == SD_SPI_RESULT_OK && response.r1 != 0) {
          result = SD_SPI_RESULT_RESPONSE_ERROR;
-    } else {
+    } else if (result == SD_SPI_RESULT_OK) {
         /*
          * waite > 1 byte before send data
          */
@@ -941,50 +1256,235 @@ SdSpiResult sdSpiWrite(SdSpiH *handler, uint32_t address, uint8_t *data, size_t
         }
 
         /*
-        * If write more than one LBA, send STOP TRAN token.
+        * If write more than one LBA, send STOP TRAN token. The token is sent also
+        * after the error to complete the transaction
         */
-        if (writeType != WRITE_TYPE_SINGLE && result == SD_SPI_RESULT_OK) {
+        if (writeType != WRITE_TYPE_SINGLE) {
             /*
             * After sending we need waite >= 1 byte time and waite to complete busy state
             */
             token = SD_TOKEN_STOP_TRAN;
             if (handler->cb.sdSpiSend(&token, TOKEN_SIZE) == false) {
-                result = SD_SPI_RESULT_SEND_CB_RETURN_ERROR;
-            }
-            if (result == SD_SPI_RESULT_OK) {
+                stopResult = SD_SPI_RESULT_SEND_CB_RETURN_ERROR;
+            } else {
                 /*
                 * waite > 1 byte
                 */
-                result = sdSpiWaiteBusy(handler);
+                stopResult = sdSpiWaiteBusy(handler, handler->timing.busyTimeoutMs);
+            }
+            if (result == SD_SPI_RESULT_OK) {
+                result = stopResult;
             }
         }
     }
 
     handler->cb.sdSpiSetCsState(true);
 
+    if (result == SD_SPI_RESULT_OK) {
+        *completed = dataLength;
+    } else if (writeType != WRITE_TYPE_SINGLE
+               && sdSpiIsRecoverable(result)
+               && sdSpiReadWrittenBlocks(handler, &written) == SD_SPI_RESULT_OK) {
+        /*
+         * The blocks accepted by the card are not always written, ask the card.
+         * If the card can't tell, the whole transaction is repeated
+         */
+        *completed = written < dataLength ? written : dataLength;
+    }
+
     return result;
 }
 
-SdSpiResult sdSpiReadCsdRegister(SdSpiH *handler, uint8_t csdContent[SD_SPI_CSD_BYTES])
+SdSpiResult sdSpiWrite(SdSpiH *handler, uint32_t address, uint8_t *data, size_t dataLength)
 {
     SdSpiResult result;
-    SdSpiCmdReq request;
-    SdSpiCmdResp response;
+    size_t done = 0;
+    size_t completed;
+    uint32_t retry = 0;
 
     if (handler == NULL) {
         return SD_SPI_RESULT_HANDLER_NULL_ERROR;
     }
 
-    if (csdContent == NULL) {
+    if (data == NULL) {
         return SD_SPI_RESULT_DATA_NULL_ERROR;
     }
 
-    request.cmd = SD_CMD9;
-    result = sdSpiCmdTransaction(handler, request, &response, false);
+    if (dataLength == 0) {
+        return SD_SPI_RESULT_DATA_LENGTH_ZERO_ERROR;
+    }
 
-    if (result == SD_SPI_RESULT_OK) {
-        if (response.r1 == 0) {
-            result = sdSpiReadBlock(handler, csdContent, SD_SPI_CSD_BYTES);
+    /*
+     * In case of error re-issue the rest of the data from the first not written block.
+     * The retry counter is reset by any progress
+     */
+    sdSpiBusLock(handler, true);
+    do {
+        result = sdSpiWriteTransfer(handler, address + done, data + done * SDIO_SPI_FAT_LBA,
+                                    dataLength - done, &completed);
+        done += completed;
+        if (completed != 0) {
+            retry = 0;
+        }
+    } while (result != SD_SPI_RESULT_OK
+             && done < dataLength
+             && sdSpiIsRecoverable(result)
+             && retry++ < SD_TRANSFER_RETRIES);
+    sdSpiBusLock(handler, false);
+
+    handler->completedBlocks = done;
+
+    return result;
+}
+
+SdSpiResult sdSpiWriteAuAligned(SdSpiH *handler, uint32_t address, uint8_t *data, size_t dataLength)
+{
+    SdSpiResult result = SD_SPI_RESULT_OK;
+    uint32_t auBlocks;
+    size_t chunk;
+
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+
+    auBlocks = handler->metaInformation.auBlocks;
+    if (auBlocks == 0) {
+        return sdSpiWrite(handler, address, data, dataLength);
+    }
+
+    /*
+     * The first chunk complete the current AU, the next chunks are whole AUs
+     */
+    sdSpiBusLock(handler, true);
+    while (dataLength > 0 && result == SD_SPI_RESULT_OK) {
+        chunk = auBlocks - (address % auBlocks);
+        if (chunk > dataLength) {
+            chunk = dataLength;
+        }
+        result = sdSpiWrite(handler, address, data, chunk);
+        address += chunk;
+        data += chunk * SDIO_SPI_FAT_LBA;
+        dataLength -= chunk;
+    }
+    sdSpiBusLock(handler, false);
+
+    return result;
+}
+
+/*
+ * The erase timeout for the blocks number. Use the SD Status erase parameters if the
+ * card report them, otherwise SD_ERASE_SECTOR_TIMEOUTE per the CSD erasable sector
+ */
+static uint32_t sdSpiEraseTimeoute(SdSpiH *handler, uint32_t blocks)
+{
+    SdSpiMetaInformation *meta = &handler->metaInformation;
+    uint64_t timeout;
+    uint64_t units;
+
+    /*
+     * The erase of the whole SDXC card is longer than the 32-bit ms, it is calculated in 64 bits
+     */
+    if (meta->eraseSize != 0 && meta->eraseTimeoutS != 0 && meta->auBlocks != 0) {
+        units = ((uint64_t)blocks + meta->auBlocks - 1) / meta->auBlocks;
+        timeout = (meta->eraseTimeoutS * units * 1000) / meta->eraseSize
+                  + meta->eraseOffsetS * 1000;
+    } else {
+        units = meta->eraseSectorBlocks != 0
+                ? ((uint64_t)blocks + meta->eraseSectorBlocks - 1) / meta->eraseSectorBlocks
+                : blocks;
+        timeout = units * SD_ERASE_SECTOR_TIMEOUTE;
+    }
+    if (timeout > UINT32_MAX) {
+        timeout = UINT32_MAX;
+    }
+
+    return timeout < handler->timing.busyTimeoutMs
+           ? handler->timing.busyTimeoutMs
+           : (uint32_t)timeout;
+}
+
+static SdSpiResult sdSpiEraseBlocks(SdSpiH *handler, uint32_t startAddress, uint32_t endAddress)
+{
+    SdSpiResult result;
+    SdSpiCmdReq request;
+    SdSpiCmdResp response;
+
+    /*
+     * Select the erase range
+     */
+    request.cmd = SD_CMD32;
+    request.cmd32.address = startAddress * handler->lba;
+    result = sdSpiCmdTransaction(handler, request, &response, true);
+    if (result != SD_SPI_RESULT_OK) {
+        return result;
+    } else if (response.r1 != 0) {
+        return SD_SPI_RESULT_RESPONSE_ERROR;
+    }
+
+    request.cmd = SD_CMD33;
+    request.cmd33.address = endAddress * handler->lba;
+    result = sdSpiCmdTransaction(handler, request, &response, true);
+    if (result != SD_SPI_RESULT_OK) {
+        return result;
+    } else if (response.r1 != 0) {
+        return SD_SPI_RESULT_RESPONSE_ERROR;
+    }
+
+    /*
+     * Erase. The card keeps the busy state up to complete erasing
+     */
+    request.cmd = SD_CMD38;
+    request.cmd38.busyTimeoutMs = sdSpiEraseTimeoute(handler, endAddress - startAddress + 1);
+    result = sdSpiCmdTransaction(handler, request, &response, false);
+    if (result == SD_SPI_RESULT_OK && response.r1 != 0) {
+        result = SD_SPI_RESULT_RESPONSE_ERROR;
+    }
+
+    handler->cb.sdSpiSetCsState(true);
+
+    return result;
+}
+
+SdSpiResult sdSpiErase(SdSpiH *handler, uint32_t startAddress, uint32_t endAddress)
+{
+    SdSpiResult result;
+
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+
+    if (endAddress < startAddress) {
+        return SD_SPI_RESULT_DATA_LENGTH_ZERO_ERROR;
+    }
+
+    sdSpiBusLock(handler, true);
+    result = sdSpiEraseBlocks(handler, startAddress, endAddress);
+    sdSpiBusLock(handler, false);
+
+    return result;
+}
+
+SdSpiResult sdSpiReadCsdRegister(SdSpiH *handler, uint8_t csdContent[SD_SPI_CSD_BYTES])
+{
+    SdSpiResult result;
+    SdSpiCmdReq request;
+    SdSpiCmdResp response;
+
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+
+    if (csdContent == NULL) {
+        return SD_SPI_RESULT_DATA_NULL_ERROR;
+    }
+
+    sdSpiBusLock(handler, true);
+    request.cmd = SD_CMD9;
+    result = sdSpiCmdTransaction(handler, request, &response, false);
+
+    if (result == SD_SPI_RESULT_OK) {
+        if (response.r1 == 0) {
+            result = sdSpiReadBlock(handler, csdContent, SD_SPI_CSD_BYTES);
             if (result == SD_SPI_RESULT_OK) {
                 sdSpiSwapBytes(csdContent, SD_SPI_CSD_BYTES);
             }
@@ -994,6 +1494,7 @@ SdSpiResult sdSpiReadCsdRegister(SdSpiH *handler, uint8_t csdContent[SD_SPI_CSD_
     }
 
     handler->cb.sdSpiSetCsState(true);
+    sdSpiBusLock(handler, false);
 
     return result;
 }
@@ -1012,6 +1513,7 @@ SdSpiResult sdSpiReadCidRegister(SdSpiH *handler, uint8_t cidContent[SD_SPI_CID_
         return SD_SPI_RESULT_DATA_NULL_ERROR;
     }
 
+    sdSpiBusLock(handler, true);
     request.cmd = SD_CMD10;
     result = sdSpiCmdTransaction(handler, request, &response, false);
 
@@ -1027,6 +1529,111 @@ SdSpiResult sdSpiReadCidRegister(SdSpiH *handler, uint8_t cidContent[SD_SPI_CID_
     }
 
     handler->cb.sdSpiSetCsState(true);
+    sdSpiBusLock(handler, false);
+
+    return result;
+}
+
+static SdSpiResult sdSpiReadSdStatus(SdSpiH *handler, uint8_t sdStatus[SD_SPI_SD_STATUS_BYTES])
+{
+    SdSpiResult result;
+    SdSpiCmdReq request;
+    SdSpiCmdResp response;
+
+    /*
+     * CMD55 is a pre command before send comamnd ACMD13
+     */
+    request.cmd = SD_CMD55;
+    result = sdSpiCmdTransaction(handler, request, &response, true);
+    if (result != SD_SPI_RESULT_OK) {
+        return result;
+    } else if (response.r1 != 0) {
+        return SD_SPI_RESULT_RESPONSE_ERROR;
+    }
+
+    request.cmd = SD_CMD13;
+    result = sdSpiCmdTransaction(handler, request, &response, false);
+
+    if (result == SD_SPI_RESULT_OK) {
+        if (response.r1 == 0) {
+            result = sdSpiReadBlock(handler, sdStatus, SD_SPI_SD_STATUS_BYTES);
+        } else {
+            result = SD_SPI_RESULT_RESPONSE_ERROR;
+        }
+    }
+
+    handler->cb.sdSpiSetCsState(true);
+
+    return result;
+}
+
+SdSpiResult sdSpiReadSdStatusRegister(SdSpiH *handler, uint8_t sdStatus[SD_SPI_SD_STATUS_BYTES])
+{
+    SdSpiResult result;
+
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+
+    if (sdStatus == NULL) {
+        return SD_SPI_RESULT_DATA_NULL_ERROR;
+    }
+
+    sdSpiBusLock(handler, true);
+    result = sdSpiReadSdStatus(handler, sdStatus);
+    sdSpiBusLock(handler, false);
+
+    return result;
+}
+
+static SdSpiResult sdSpiReadScr(SdSpiH *handler, uint8_t scr[SD_SPI_SCR_BYTES])
+{
+    SdSpiResult result;
+    SdSpiCmdReq request;
+    SdSpiCmdResp response;
+
+    /*
+     * CMD55 is a pre command before send comamnd ACMD51
+     */
+    request.cmd = SD_CMD55;
+    result = sdSpiCmdTransaction(handler, request, &response, true);
+    if (result != SD_SPI_RESULT_OK) {
+        return result;
+    } else if (response.r1 != 0) {
+        return SD_SPI_RESULT_RESPONSE_ERROR;
+    }
+
+    request.cmd = SD_CMD51;
+    result = sdSpiCmdTransaction(handler, request, &response, false);
+
+    if (result == SD_SPI_RESULT_OK) {
+        if (response.r1 == 0) {
+            result = sdSpiReadBlock(handler, scr, SD_SPI_SCR_BYTES);
+        } else {
+            result = SD_SPI_RESULT_RESPONSE_ERROR;
+        }
+    }
+
+    handler->cb.sdSpiSetCsState(true);
+
+    return result;
+}
+
+SdSpiResult sdSpiReadScrRegister(SdSpiH *handler, uint8_t scr[SD_SPI_SCR_BYTES])
+{
+    SdSpiResult result;
+
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+
+    if (scr == NULL) {
+        return SD_SPI_RESULT_DATA_NULL_ERROR;
+    }
+
+    sdSpiBusLock(handler, true);
+    result = sdSpiReadScr(handler, scr);
+    sdSpiBusLock(handler, false);
 
     return result;
 }
@@ -1044,4 +1651,232 @@ SdSpiResult sdSpiGetMetaInformation(SdSpiH *handler, SdSpiMetaInformation *metaI
     *metaInformation = handler->metaInformation;
 
     return SD_SPI_RESULT_OK;
-}
\ No newline at end of file
+}
+static inline uint8_t sdSpiProbePattern(uint32_t seed, uint32_t pos)
+{
+    return (uint8_t)((pos * 7) ^ (pos >> 8) ^ seed);
+}
+
+static uint32_t sdSpiBusyPercentile(const struct SdSpiProbeStatistic *statistic, uint32_t percent)
+{
+    uint32_t threshold = (statistic->busyCnt * percent + 99) / 100;
+    uint32_t cnt = 0;
+
+    if (threshold == 0) {
+        return 0;
+    }
+    for (uint32_t k = 0; k < SD_BUSY_HISTOGRAM_SIZE - 1; k++) {
+        cnt += statistic->busyHistogram[k];
+        if (cnt >= threshold) {
+            return k;
+        }
+    }
+
+    /*
+     * The percentile is in the overflow cell
+     */
+    return statistic->busyMaxMs;
+}
+
+/*
+ * Write and read back the scratch area by the blocks portions up to transfer
+ * SD_CALIBRATION_PROBE_BLOCKS in each direction, then verify the content.
+ * Return the throughput in bytes per second through the throughput
+ */
+static SdSpiResult sdSpiProbe(SdSpiH *handler, const SdSpiCalibration *calibration,
+                              uint32_t blocks, uint32_t seed, uint32_t *throughput)
+{
+    SdSpiResult result = SD_SPI_RESULT_OK;
+    uint32_t size = blocks * SDIO_SPI_FAT_LBA;
+    uint32_t transferred = 0;
+    uint32_t startTime;
+    uint32_t time;
+
+    for (uint32_t k = 0; k < size; k++) {
+        calibration->buff[k] = sdSpiProbePattern(seed, k);
+    }
+
+    startTime = handler->cb.sdSpiGetTimeMs();
+    for (; transferred < SD_CALIBRATION_PROBE_BLOCKS; transferred += blocks) {
+        result = sdSpiWrite(handler, calibration->scratchAddress, calibration->buff, blocks);
+        if (result != SD_SPI_RESULT_OK) {
+            return result;
+        }
+        result = sdSpiRead(handler, calibration->scratchAddress, calibration->buff, blocks);
+        if (result != SD_SPI_RESULT_OK) {
+            return result;
+        }
+    }
+    time = handler->cb.sdSpiGetTimeMs() - startTime;
+
+    /*
+     * The verification read is not included to the measured time
+     */
+    memset(calibration->buff, 0, size);
+    result = sdSpiRead(handler, calibration->scratchAddress, calibration->buff, blocks);
+    if (result != SD_SPI_RESULT_OK) {
+        return result;
+    }
+    for (uint32_t k = 0; k < size; k++) {
+        if (calibration->buff[k] != sdSpiProbePattern(seed, k)) {
+            return SD_SPI_RESULT_CALIBRATION_VERIFY_ERROR;
+        }
+    }
+
+    *throughput = (uint32_t)(((uint64_t)transferred * 2 * SDIO_SPI_FAT_LBA * 1000)
+                             / (time == 0 ? 1 : time));
+
+    return SD_SPI_RESULT_OK;
+}
+
+static SdSpiResult sdSpiCalibrateTiming(SdSpiH *handler, const SdSpiCalibration *calibration)
+{
+    SdSpiResult result = SD_SPI_RESULT_OK;
+    struct SdSpiProbeStatistic statistic;
+    struct SdSpiProbeStatistic bestStatistic;
+    SdSpiTiming best;
+    SdSpiTiming previous = handler->timing;
+    uint32_t maxBlocks;
+    uint32_t throughput;
+
+    maxBlocks = calibration->scratchBlocks < SD_CALIBRATION_MAX_TRANSFER_BLOCKS
+                ? calibration->scratchBlocks
+                : SD_CALIBRATION_MAX_TRANSFER_BLOCKS;
+
+    /*
+     * Probe with the specification timeouts, the previous calibration could make them longer
+     */
+    memset(&best, 0, sizeof(best));
+    memset(&bestStatistic, 0, sizeof(bestStatistic));
+    handler->probeStatistic = &statistic;
+
+    for (uint32_t f = 0; f < calibration->sckFrqNumber; f++) {
+        SdSpiTiming frqBest = {
+            .sckFrq = calibration->sckFrq[f],
+        };
+
+        if (handler->cb.sdSpiSetSckFrq(calibration->sckFrq[f]) == false) {
+            result = SD_SPI_RESULT_SET_FRQ_CB_RETURN_ERROR;
+            break;
+        }
+        handler->timing.sckFrq = calibration->sckFrq[f];
+        sdSpiSetSpecTiming(handler);
+        memset(&statistic, 0, sizeof(statistic));
+
+        for (uint32_t blocks = 1; blocks <= maxBlocks; blocks <<= 1) {
+            result = sdSpiProbe(handler, calibration, blocks, f ^ blocks, &throughput);
+            if (result != SD_SPI_RESULT_OK) {
+                break;
+            }
+            if (throughput > frqBest.throughput) {
+                frqBest.throughput = throughput;
+                frqBest.transferBlocks = blocks;
+            }
+        }
+
+        /*
+         * Any error on the frequency makes it unusable
+         */
+        if (result != SD_SPI_RESULT_OK) {
+            continue;
+        }
+        if (frqBest.throughput > best.throughput) {
+            best = frqBest;
+            bestStatistic = statistic;
+        }
+    }
+    handler->probeStatistic = NULL;
+
+    if (result == SD_SPI_RESULT_SET_FRQ_CB_RETURN_ERROR) {
+        handler->timing = previous;
+        handler->cb.sdSpiSetSckFrq(handler->timing.sckFrq);
+        return result;
+    }
+
+    if (best.throughput == 0) {
+        handler->timing = previous;
+        handler->cb.sdSpiSetSckFrq(handler->timing.sckFrq);
+        return SD_SPI_RESULT_CALIBRATION_VERIFY_ERROR;
+    }
+
+    best.busyP50Ms = sdSpiBusyPercentile(&bestStatistic, 50);
+    best.busyP99Ms = sdSpiBusyPercentile(&bestStatistic, 99);
+    best.busyMaxMs = bestStatistic.busyMaxMs;
+    /*
+     * The measured time with the margin never shortens the specification timeouts
+     */
+    handler->timing.sckFrq = best.sckFrq;
+    sdSpiSetSpecTiming(handler);
+    best.busyTimeoutMs = bestStatistic.busyMaxMs * SD_CALIBRATION_MARGIN;
+    if (best.busyTimeoutMs < handler->timing.busyTimeoutMs) {
+        best.busyTimeoutMs = handler->timing.busyTimeoutMs;
+    } else if (best.busyTimeoutMs > SD_CALIBRATION_MAX_BUSY_TIMEOUTE) {
+        best.busyTimeoutMs = SD_CALIBRATION_MAX_BUSY_TIMEOUTE;
+    }
+    best.dataTokenBytes = bestStatistic.dataTokenMaxBytes * SD_CALIBRATION_MARGIN;
+    if (best.dataTokenBytes < handler->timing.dataTokenBytes) {
+        best.dataTokenBytes = handler->timing.dataTokenBytes;
+    }
+
+    handler->timing = best;
+    if (handler->cb.sdSpiSetSckFrq(handler->timing.sckFrq) == false) {
+        return SD_SPI_RESULT_SET_FRQ_CB_RETURN_ERROR;
+    }
+
+    return SD_SPI_RESULT_OK;
+}
+
+SdSpiResult sdSpiCalibrate(SdSpiH *handler, const SdSpiCalibration *calibration)
+{
+    SdSpiResult result;
+
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+
+    if (calibration == NULL || calibration->buff == NULL) {
+        return SD_SPI_RESULT_DATA_NULL_ERROR;
+    }
+
+    if (calibration->scratchBlocks == 0
+        || calibration->sckFrqNumber == 0
+        || calibration->sckFrqNumber > SD_SPI_CALIBRATION_MAX_FRQ) {
+        return SD_SPI_RESULT_CALIBRATION_SETTINGS_ERROR;
+    }
+
+    sdSpiBusLock(handler, true);
+    result = sdSpiCalibrateTiming(handler, calibration);
+    sdSpiBusLock(handler, false);
+
+    return result;
+}
+
+SdSpiResult sdSpiGetCompletedBlocks(SdSpiH *handler, size_t *completedBlocks)
+{
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+
+    if (completedBlocks == NULL) {
+        return SD_SPI_RESULT_DATA_NULL_ERROR;
+    }
+
+    *completedBlocks = handler->completedBlocks;
+
+    return SD_SPI_RESULT_OK;
+}
+
+SdSpiResult sdSpiGetTiming(SdSpiH *handler, SdSpiTiming *timing)
+{
+    if (handler == NULL) {
+        return SD_SPI_RESULT_HANDLER_NULL_ERROR;
+    }
+
+    if (timing == NULL) {
+        return SD_SPI_RESULT_DATA_NULL_ERROR;
+    }
+
+    *timing = handler->timing;
+
+    return SD_SPI_RESULT_OK;
+}
@@ -7,6 +7,13 @@
 
 #define SD_SPI_CSD_BYTES    16
 #define SD_SPI_CID_BYTES    16
+#define SD_SPI_SD_STATUS_BYTES    64
+#define SD_SPI_SCR_BYTES          8
+
+/*
+ * The maximum number of the SCK frequencies could be probed by the sdSpiCalibrate
+ */
+#define SD_SPI_CALIBRATION_MAX_FRQ    8
 
 typedef enum {
     SD_SPI_RESULT_OK,
@@ -29,6 +36,7 @@ typedef enum {
     SD_SPI_RESULT_MALLOC_CB_RERTURN_NULL_ERROR,
     SD_SPI_RESULT_DATA_NULL_ERROR,
     SD_SPI_RESULT_DATA_LENGTH_ZERO_ERROR,
+    SD_SPI_RESULT_CALIBRATION_SETTINGS_ERROR,
 
     SD_SPI_RESULT_INTERNAL_ERROR,
 
@@ -52,6 +60,12 @@ typedef enum {
      */
     SD_SPI_RESULT_WRITE_ERROR,
 
+    /*
+     * The data read back from the scratch area during calibration
+     * don't match the written data on all probed SCK frequencies
+     */
+    SD_SPI_RESULT_CALIBRATION_VERIFY_ERROR,
+
     SD_SPI_RESULT_UNKNOWN_ERROR,
 } SdSpiResult;
 
@@ -70,16 +84,132 @@ typedef enum {
 typedef struct {
     SdCardVersion version;
     SdCardCapacityType capcityType;
-    uint32_t capcityMb;
+
+    /*
+     * The card capacity in bytes, from the CSD. The SDXC card is up to 2 TB
+     */
+    uint64_t capacity;
+
+    /*
+     * The number of the addressable 512 bytes blocks. The block address
+     * of the SDHC / SDXC card is 32 bits, so the 2 TB card loses the last block
+     */
+    uint32_t blockCount;
+
+    /*
+     * The allocation unit (AU) size in 512 bytes blocks, from the SD Status register.
+     * 0 if the card don't report it
+     */
+    uint32_t auBlocks;
+
+    /*
+     * The speed class: 0, 2, 4, 6, 10
+     */
+    uint8_t speedClass;
+
+    /*
+     * The erase of eraseSize AUs takes eraseTimeoutS seconds, plus eraseOffsetS
+     * seconds for the whole operation. eraseSize == 0 if the card don't report it
+     */
+    uint16_t eraseSize;
+    uint8_t eraseTimeoutS;
+    uint8_t eraseOffsetS;
+
+    /*
+     * CSD: the size of the erasable sector in 512 bytes blocks and
+     * the possibility to erase by the single block
+     */
+    uint32_t eraseSectorBlocks;
+    bool eraseSingleBlock;
+
+    /*
+     * SCR: the erased blocks are read as zeros (DATA_STAT_AFTER_ERASE == 0).
+     * false if the erased content is 0xFF or the SCR is not available
+     */
+    bool erasedToZero;
 } SdSpiMetaInformation;
 
+/*
+ * The transfer timings. sdSpiInit set the specification values of the card type, sdSpiCalibrate
+ * select the SCK frequency and raise the timeouts by the values measured on the current card
+ */
+typedef struct {
+    /*
+     * SCK frequency used for the data transfer, Hz
+     */
+    uint32_t sckFrq;
+
+    /*
+     * The number of blocks per one multi-block transfer with the best throughput, the batch
+     * size of the multiple block transfers. 1 if the calibration was not run
+     */
+    uint32_t transferBlocks;
+
+    /*
+     * The timeout of the busy state after the write/stop transaction, ms. Not less than
+     * the specification 250 ms, 500 ms for the SDXC card
+     */
+    uint32_t busyTimeoutMs;
+
+    /*
+     * The number of bytes to waite the data token / data response. Not less than
+     * the bytes of the specification 100 ms read access time on the sckFrq
+     */
+    uint32_t dataTokenBytes;
+
+    /*
+     * The measured busy time percentiles, ms. Zero if the calibration was not run
+     */
+    uint32_t busyP50Ms;
+    uint32_t busyP99Ms;
+    uint32_t busyMaxMs;
+
+    /*
+     * The measured throughput on the sckFrq with transferBlocks, bytes per second
+     */
+    uint32_t throughput;
+} SdSpiTiming;
+
+typedef struct {
+    /*
+     * The first block of the scratch area. The content of the scratch area is destroyed
+     */
+    uint32_t scratchAddress;
+
+    /*
+     * The number of blocks in the scratch area. Define the maximum probed transfer size
+     */
+    uint32_t scratchBlocks;
+
+    /*
+     * The buffer for the probe data. The buffer size must be (scratchBlocks * 512)
+     */
+    uint8_t *buff;
+
+    /*
+     * The probed SCK frequencies, Hz
+     */
+    uint32_t sckFrq[SD_SPI_CALIBRATION_MAX_FRQ];
+    uint32_t sckFrqNumber;
+} SdSpiCalibration;
+
+struct SdSpiProbeStatistic;
+
 typedef struct {
     bool (*sdSpiSend)(uint8_t *data, size_t dataLength);
     bool (*sdSpiReceive)(uint8_t *data, size_t dataLength);
     bool (*sdSpiSetCsState)(bool set);
-    bool (*sdSpiSetSckFrq)(bool hight);
+    bool (*sdSpiSetSckFrq)(uint32_t frq);
     uint32_t (*sdSpiGetTimeMs)(void);
     uint8_t *(*sdSpiMalloc)(uint32_t size);
+
+    /*
+     * Optional (could be NULL). Take (lock = true) and release (lock = false) the SPI bus
+     * and the handler for the whole card access: every API call with the bus transfer is
+     * inside the lock. The API calls could be nested, so the lock must be recursive
+     * (for example the FreeRTOS recursive mutex)
+     */
+    void (*sdSpiBusLock)(bool lock);
 } SdSpiCb;
 
 typedef struct {
@@ -98,6 +228,19 @@ typedef struct {
     uint8_t *serviceBuff;
 
     uint8_t *transactionBuffer;
+
+    SdSpiTiming timing;
+
+    /*
+     * The number of blocks transferred by the last sdSpiRead / sdSpiWrite.
+     * In case of error - the number of blocks transferred before the error
+     */
+    size_t completedBlocks;
+
+    /*
+     * Not NULL only while the calibration is running
+     */
+    struct SdSpiProbeStatistic *probeStatistic;
 } SdSpiH;
 
 /**
@@ -107,7 +250,37 @@ typedef struct {
 SdSpiResult sdSpiInit(SdSpiH *handler, const SdSpiCb *cb);
 
 /**
- * @brief read data from the card
+ * @brief Measure the transfer timings of the card and replace the default timings by the measured one.
+ *        The card must be init before calling this function, see sdSpiInit.
+ *        For each SCK frequency from the list write, read back and verify the scratch area
+ *        with the different multi-block sizes. The fastest verified frequency is used as the
+ *        data transfer frequency. The measured busy time and data token delay with the margin
+ *        raise the busy timeout and data token timeout, they are never less than the specification.
+ * @param[in,out] handler - the handler of the SdCard item
+ * @param[in] calibration - the scratch area and the probed SCK frequencies
+ */
+SdSpiResult sdSpiCalibrate(SdSpiH *handler, const SdSpiCalibration *calibration);
+
+/**
+ * @brief Return the current transfer timings
+ * @param[in] handler - the handler of the SdCard item
+ * @param[out] timing - the pointer to structure with timings
+ */
+SdSpiResult sdSpiGetTiming(SdSpiH *handler, SdSpiTiming *timing);
+
+/**
+ * @brief Return the number of blocks transferred by the last sdSpiRead / sdSpiWrite call.
+ *        If the call failed, the blocks from the start address up to the returned number
+ *        are transferred successfully
+ * @param[in] handler - the handler of the SdCard item
+ * @param[out] completedBlocks - the number of the transferred blocks
+ */
+SdSpiResult sdSpiGetCompletedBlocks(SdSpiH *handler, size_t *completedBlocks);
+
+/**
+ * @brief read data from the card. In case of error inside the multiple block transaction, the transaction
+ *        is stopped and the rest of the data is read again from the failed block, up to
+ *        SD_TRANSFER_RETRIES times without progress
  * @param[in] handler - the handler of the SdCard item
  * @param[in] address - the address of the target sector. The absolute address is calculated as (address * 512)
  * @param[in] data - the buffer for the read data. The buffer size must be (data length * 512)
@@ -116,7 +289,9 @@ SdSpiResult sdSpiInit(SdSpiH *handler, const SdSpiCb *cb);
 SdSpiResult sdSpiRead(SdSpiH *handler, uint32_t address, uint8_t *data, size_t dataLength);
 
 /**
- * @brief write data from the card
+ * @brief write data from the card. In case of error inside the multiple block transaction, the transaction
+ *        is stopped, the number of the written blocks is read from the card (ACMD22) and the rest of the data
+ *        is written again, up to SD_TRANSFER_RETRIES times without progress
  * @param[in] handler - the handler of the SdCard item
  * @param[in] address - the address of the target block. The absolute address is calculated as (address * 512)
  * @param[out] data - the buffer for the write data. The buffer size must be (data length * 512)
@@ -124,6 +299,25 @@ SdSpiResult sdSpiRead(SdSpiH *handler, uint32_t address, uint8_t *data, size_t d
  */
 SdSpiResult sdSpiWrite(SdSpiH *handler, uint32_t address, uint8_t *data, size_t dataLength);
 
+/**
+ * @brief write data to the card, split the data so none of the multi-block write transactions
+ *        crosses the allocation unit boundary. Equal to the sdSpiWrite if the AU size is unknown
+ * @param[in] handler - the handler of the SdCard item
+ * @param[in] address - the address of the target block. The absolute address is calculated as (address * 512)
+ * @param[out] data - the buffer for the write data. The buffer size must be (data length * 512)
+ * @param[in] dataLength - the number of logical blocks to write. The logical block size equal to 512 bytes
+ */
+SdSpiResult sdSpiWriteAuAligned(SdSpiH *handler, uint32_t address, uint8_t *data, size_t dataLength);
+
+/**
+ * @brief erase the range of the blocks. The erase timeout is calculated from the card erase
+ *        parameters, see SdSpiMetaInformation
+ * @param[in] handler - the handler of the SdCard item
+ * @param[in] startAddress - the address of the first block to erase
+ * @param[in] endAddress - the address of the last block to erase (inclusive)
+ */
+SdSpiResult sdSpiErase(SdSpiH *handler, uint32_t startAddress, uint32_t endAddress);
+
 /**
  * @brief read CSD register content
  * @param[in] handler - the handler of the SdCard item
@@ -138,6 +332,20 @@ SdSpiResult sdSpiReadCsdRegister(SdSpiH *handler, uint8_t csdContent[SD_SPI_CSD_
  */
 SdSpiResult sdSpiReadCidRegister(SdSpiH *handler, uint8_t cidContent[SD_SPI_CID_BYTES]);
 
+/**
+ * @brief read SD Status register content (ACMD13)
+ * @param[in] handler - the handler of the SdCard item
+ * @param[out] sdStatus - the 64 bytes raw register content, the first byte is the bits 511:504
+ */
+SdSpiResult sdSpiReadSdStatusRegister(SdSpiH *handler, uint8_t sdStatus[SD_SPI_SD_STATUS_BYTES]);
+
+/**
+ * @brief read SCR register content (ACMD51)
+ * @param[in] handler - the handler of the SdCard item
+ * @param[out] scr - the 8 bytes raw register content, the first byte is the bits 63:56
+ */
+SdSpiResult sdSpiReadScrRegister(SdSpiH *handler, uint8_t scr[SD_SPI_SCR_BYTES]);
+
 /**
  * @brief Return metainformation about SD card. The SD card must be init before calling this function, see
  *        sdSpiInit
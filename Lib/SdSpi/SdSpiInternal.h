@@ -64,12 +64,19 @@ typedef struct {
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
  * | CMD12  | None(0)                | R1b | No  | STOP_TRANSMISSION        | Stop to read data                                   |
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
+ * | CMD13  | None(0)                | R2  | No  | SEND_STATUS              | Read and clear the card status                      |
+ * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
+ * | ACMD13 | None(0)                | R2  | Yes | SD_STATUS                | For only SDC. Read SD Status register               |
+ * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
  * | CMD16  | Block length[31:0]     | R1  | No  | SET_BLOCKLEN             | Change R/W block size                               |
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
  * | CMD17  | Address[31:0]          | R1  | Yes | READ_SINGLE_BLOCK        | Read a block                                        |
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
  * | CMD18  | Address[31:0]          | R1  | Yes | READ_MULTIPLE_BLOCK      | Read multiple blocks                                |
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
+ * | ACMD22 | None(0)                | R1  | Yes | SEND_NUM_WR_BLOCKS       | For only SDC. Number of the well written blocks     |
+ * |        |                        |     |     |                          | of the last multiple block write                    |
+ * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
  * | CMD23  | Number of blocks[15:0] | R1  | No  | SET_BLOCK_COUNT          | For only MMC. Define number of blocks to transfer   |
  * |        |                        |     |     |                          | with next multi-block read/write command            |
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
@@ -80,8 +87,16 @@ typedef struct {
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
  * | CMD25  | Address[31:0]          | R1  | Yes | WRITE_MULTIPLE_BLOCK     | Write multiple blocks                               |
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
+ * | CMD32  | Address[31:0]          | R1  | No  | ERASE_WR_BLK_START_ADDR  | For only SDC. Set the first block to erase          |
+ * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
+ * | CMD33  | Address[31:0]          | R1  | No  | ERASE_WR_BLK_END_ADDR    | For only SDC. Set the last block to erase           |
+ * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
+ * | CMD38  | None(0)                | R1b | No  | ERASE                    | Erase the selected blocks                           |
+ * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
  * | CMD55  | None(0)                | R1  | No  | APP_CMD                  | Leading command of ACMD<n> command                  |
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
+ * | ACMD51 | None(0)                | R1  | Yes | SEND_SCR                 | For only SDC. Read SCR register                     |
+ * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
  * | CMD58  | None(0)                | R3  | No  | READ_OCR                 | Read OCR                                            |
  * +--------+------------------------+-----+-----+--------------------------+-----------------------------------------------------+
 
@@ -93,14 +108,101 @@ typedef struct {
 #define SD_SPI_INITIAL_FRQ                     100000
 #define SD_SPI_FAST_FRQ                        20000000
 #define SD_EXIT_IDLE_TIMEOUTE                  100
-#define SD_BUSY_TIMEOUTE                       200
+/*
+ * The write busy timeouts of the Physical Layer Simplified Specification 4.6.2.2:
+ * 250 ms for the SDSC and SDHC cards, 500 ms for the SDXC cards
+ */
+#define SD_BUSY_TIMEOUTE                       250
+#define SD_BUSY_TIMEOUTE_SDXC                  500
+/*
+ * The read access timeout of the SDHC and SDXC cards, 4.6.2.1, ms
+ */
+#define SD_READ_ACCESS_TIMEOUTE                100
 #define SD_WAITE_RESPONSE_IN_BYTES             8
 #define SD_WAITE_DATA_TOKEN_BYTES              1000
 
+/*
+ * The number of the repeated transactions without progress after the read/write error
+ */
+#define SD_TRANSFER_RETRIES                    3
+
+/*
+ * The erase timeout per erasable sector if the card don't report the erase timeout
+ * in the SD Status register
+ */
+#define SD_ERASE_SECTOR_TIMEOUTE               250
+
+/*
+ * Calibration settings, see sdSpiCalibrate. The measured timeouts with the margin only
+ * raise the specification timeouts, up to the maximum
+ */
+#define SD_CALIBRATION_MAX_TRANSFER_BLOCKS     32
+#define SD_CALIBRATION_PROBE_BLOCKS            64
+#define SD_CALIBRATION_MARGIN                  4
+#define SD_CALIBRATION_MAX_BUSY_TIMEOUTE       1000
+#define SD_BUSY_HISTOGRAM_SIZE                 64
+
+/*
+ * Collected by the transfer functions while the calibration is running.
+ * The busy histogram has 1 ms resolution, the last cell accumulates all longer busy states
+ */
+struct SdSpiProbeStatistic {
+    uint16_t busyHistogram[SD_BUSY_HISTOGRAM_SIZE];
+    uint32_t busyCnt;
+    uint32_t busyMaxMs;
+    uint32_t dataTokenMaxBytes;
+};
+
 #define SD_R1_MASK                             0x7F
 
+/*
+ * CSD register fields, the bit position in the 128 bits register
+ */
+#define SD_CSD_STRUCTURE_POS                   126
+#define SD_CSD_STRUCTURE_WIDTH                 2
+#define SD_CSD_STRUCTURE_V1                    0
+#define SD_CSD_V1_READ_BL_LEN_POS              80
+#define SD_CSD_V1_READ_BL_LEN_WIDTH            4
+#define SD_CSD_V1_C_SIZE_POS                   62
+#define SD_CSD_V1_C_SIZE_WIDTH                 12
+#define SD_CSD_V1_C_SIZE_MULT_POS              47
+#define SD_CSD_V1_C_SIZE_MULT_WIDTH            3
+#define SD_CSD_V2_C_SIZE_POS                   48
+#define SD_CSD_V2_C_SIZE_WIDTH                 22
+
+/*
+ * SD Status register (ACMD13). The register is transmitted MSB first,
+ * the byte 0 of the raw content holds the bits 511:504
+ */
+#define SD_STATUS_SPEED_CLASS_BYTE             8
+#define SD_STATUS_AU_SIZE_BYTE                 10
+#define SD_STATUS_AU_SIZE_POS                  4
+#define SD_STATUS_AU_SIZE_MASK                 0x0F
+#define SD_STATUS_ERASE_SIZE_BYTE              11
+#define SD_STATUS_ERASE_TIMEOUT_BYTE           13
+#define SD_STATUS_ERASE_TIMEOUT_POS            2
+#define SD_STATUS_ERASE_TIMEOUT_MASK           0x3F
+#define SD_STATUS_ERASE_OFFSET_POS             0
+#define SD_STATUS_ERASE_OFFSET_MASK            0x03
+#define SD_STATUS_UHS_AU_SIZE_BYTE             14
+#define SD_STATUS_UHS_AU_SIZE_POS              0
+#define SD_STATUS_UHS_AU_SIZE_MASK             0x0F
+
+/*
+ * SCR register (ACMD51). The register is transmitted MSB first,
+ * the byte 0 of the raw content holds the bits 63:56
+ */
+#define SD_SCR_DATA_STAT_AFTER_ERASE_BYTE      1
+#define SD_SCR_DATA_STAT_AFTER_ERASE_POS       7
+#define SD_SCR_DATA_STAT_AFTER_ERASE_MASK      1
+
 #define SD_DATA_PACKET_CRC_SIZE                2
 
+/*
+ * ACMD22 data: the number of the well written blocks, MSB first
+ */
+#define SD_NUM_WR_BLOCKS_BYTES                 4
+
 /*
  * Data token
  */
@@ -303,6 +405,7 @@ typedef struct {
 #define SD_R1_RESP_SIZE                        1
 #define SD_R3_RESP_SIZE                        5
 #define SD_R7_RESP_SIZE                        5
+#define SD_R2_RESP_SIZE                        2
 
 #define COMMAND_VAL(COMMAND_ID)                ((01 << 6) |  COMMAND_ID)
 #define COMMAND_VAL(COMMAND_ID)                ((01 << 6) |  COMMAND_ID)
@@ -328,6 +431,7 @@ typedef enum {
     SD_RESPONSE_TYPE_R3,
     SD_RESPONSE_TYPE_R7,
     SD_RESPONSE_TYPE_R1B,
+    SD_RESPONSE_TYPE_R2,
     SD_RESPONSE_TYPE_CNT,
 } SdRespType;
 
@@ -339,12 +443,18 @@ typedef enum {
     SD_CMD9 = 9,
     SD_CMD10 = 10,
     SD_CMD12 = 12,
+    SD_CMD13 = 13,
     SD_CMD16 = 16,
     SD_CMD17 = 17,
     SD_CMD18 = 18,
+    SD_CMD22 = 22,
     SD_CMD23 = 23,
     SD_CMD24 = 24,
     SD_CMD25 = 25,
+    SD_CMD32 = 32,
+    SD_CMD33 = 33,
+    SD_CMD38 = 38,
+    SD_CMD51 = 51,
     SD_CMD55 = 55,
     SD_CMD58 = 58,
 } SdSpiCmd;
@@ -398,6 +508,18 @@ typedef struct {
         struct {
             uint32_t address;
         } cmd25;
+        struct {
+            uint32_t address;
+        } cmd32;
+        struct {
+            uint32_t address;
+        } cmd33;
+        struct {
+            /*
+             * Not a command argument: the timeout of the R1b busy state
+             */
+            uint32_t busyTimeoutMs;
+        } cmd38;
     };
 } SdSpiCmdReq;
 
@@ -1,148 +1,459 @@
 /*-----------------------------------------------------------------------*/
-/* Low level disk I/O module SKELETON for FatFs     (C)ChaN, 2019        */
+/* Low level disk I/O module for FatFs on the SdSpi driver               */
 /*-----------------------------------------------------------------------*/
-/* If a working storage control module is available, it should be        */
-/* attached to the FatFs via a glue function rather than modifying it.   */
-/* This is an example of glue functions to attach various exsisting      */
-/* storage control modules to the FatFs module with a defined API.       */
+/* The SD card is attached to the physical drive by disk_attach_sdspi()  */
+/* before mount. The sector is FF_MAX_SS bytes, the 512 bytes SD blocks  */
+/* or the logical sector of the several consecutive SD blocks. The       */
+/* sectors of the FatFs request are passed to the SdSpi driver as one    */
+/* multiple block SD transaction.                                        */
 /*-----------------------------------------------------------------------*/
 
+#include <string.h>
 #include "ff.h"			/* Obtains integer types */
 #include "diskio.h"		/* Declarations of disk functions */
 #include "SdSpi.h"
 
 /* Definitions of physical drive number for each drive */
-#define DEV_RAM		0	/* Example: Map Ramdisk to physical drive 0 */
-#define DEV_MMC		1	/* Example: Map MMC/SD card to physical drive 1 */
-#define DEV_USB		2	/* Example: Map USB MSD to physical drive 2 */
+#define DEV_MMC		0	/* Map MMC/SD card to physical drive 0 */
 
-SdSpiH sdHandler;
+/* Logical sector on the SD blocks */
+#define SD_BLOCK_SIZE	512
+#define SS_BLOCKS		(FF_MAX_SS / SD_BLOCK_SIZE)	/* Number of the SD blocks in a sector */
+#define BLK(sect)		((uint32_t)(sect) * SS_BLOCKS)	/* First SD block of the sector */
 
-DSTATUS disk_status (
-	BYTE pdrv		/* Physical drive nmuber to identify the drive */
+#if FF_MAX_SS % SD_BLOCK_SIZE
+#error FF_MAX_SS must be a multiple of the SD block size
+#endif
+
+static SdSpiH sdHandler;			/* SdSpi driver instance of the drive */
+static SdSpiCb sdCb;				/* SdSpi callbacks, set by disk_attach_sdspi() */
+static volatile DSTATUS Stat = STA_NOINIT | STA_NODISK;	/* Physical drive status */
+
+/*-----------------------------------------------------------------------*/
+/* Lock the drive state and the SPI bus, see SdSpiCb.sdSpiBusLock        */
+/*-----------------------------------------------------------------------*/
+/* FatFs serializes the access to the volume by itself, the lock guards  */
+/* the read-ahead state and the SD card against the other users of the   */
+/* bus and of the disk functions out of FatFs.                           */
+
+static void disk_lock (
+	int lock		/* 1:Lock, 0:Unlock */
 )
 {
-	DSTATUS stat;
-	int result;
+	if (sdCb.sdSpiBusLock) sdCb.sdSpiBusLock(lock ? true : false);
+}
 
-	return 0;
+
+/* Read-ahead of the sequential sector stream */
+#define RA_SECTORS		(8192 / FF_MAX_SS)	/* Size of the read-ahead buffer in sectors (0:Disable) */
+#define RA_WINDOW_MIN	2	/* Read-ahead window at the start of the sequential stream */
+#define RA_TAKEOVER		3	/* Consecutive reads out of the stream to start the other stream */
+
+#if RA_SECTORS
+static struct {
+	BYTE buf[RA_SECTORS][FF_MAX_SS];	/* Read-ahead sectors */
+	LBA_t start;	/* Sector in the buf[ofs], the next sector of the stream if count is 0 */
+	UINT ofs;		/* Index of the first not consumed sector in the buf[] */
+	UINT count;		/* Number of the not consumed sectors */
+	UINT window;	/* Number of the sectors to read ahead */
+	LBA_t last;		/* Next sector of the stream, after the last read if there are no read-ahead sectors */
+	LBA_t next;		/* Next sector after the last read out of the stream */
+	UINT run;		/* Number of the consecutive reads out of the stream */
+	LBA_t sectors;	/* Number of the sectors on the drive */
+} Ra;
+
+
+/*-----------------------------------------------------------------------*/
+/* Drop the read-ahead sectors overlapped by the sector range            */
+/*-----------------------------------------------------------------------*/
+
+static void ra_invalidate (
+	LBA_t sector,	/* Start sector */
+	LBA_t count		/* Number of sectors */
+)
+{
+	if (Ra.count && sector < Ra.start + Ra.count && Ra.start < sector + count) {
+		Ra.count = 0;
+	}
 }
 
 
+/*-----------------------------------------------------------------------*/
+/* Read sectors through the read-ahead buffer                            */
+/*-----------------------------------------------------------------------*/
+
+static SdSpiResult ra_read (
+	BYTE *buff,		/* Data buffer to store read data */
+	LBA_t sector,	/* Start sector in LBA */
+	UINT count		/* Number of sectors to read */
+)
+{
+	SdSpiResult res = SD_SPI_RESULT_OK;
+	UINT n;
+	int seq;
+
+	/* Serve the head of the request from the read-ahead sectors */
+	if (Ra.count && sector >= Ra.start && sector < Ra.start + Ra.count) {
+		n = (UINT)(Ra.start + Ra.count - sector);
+		if (n > count) n = count;
+		Ra.ofs += (UINT)(sector - Ra.start);
+		Ra.count -= (UINT)(sector - Ra.start);
+		memcpy(buff, Ra.buf[Ra.ofs], (size_t)n * FF_MAX_SS);
+		Ra.ofs += n; Ra.count -= n; Ra.start = sector + n;
+		buff += (size_t)n * FF_MAX_SS; sector += n; count -= n;
+		Ra.window = Ra.window * 2 > RA_SECTORS ? RA_SECTORS : Ra.window * 2;	/* Hit: grow the window */
+		Ra.last = sector;
+	}
+	if (count == 0) return res;
+
+	/* Continuation of the last read or of the read-ahead sectors is a sequential stream */
+	seq = (sector == Ra.last || sector == Ra.start + Ra.count);
+	if (!seq && Ra.count) {	/* Out of the stream: the metadata reads keep the read-ahead sectors */
+		Ra.run = (sector == Ra.next) ? Ra.run + 1 : 1;
+		Ra.next = sector + count;
+		if (Ra.run >= RA_TAKEOVER) {	/* The other stream takes the read-ahead buffer over */
+			Ra.count = 0;
+			Ra.window = RA_WINDOW_MIN;
+			seq = 1;
+		}
+	}
+	if (seq) Ra.run = 0;
+	if (seq && count < RA_SECTORS) {
+		if (Ra.count) {		/* Miss: the read-ahead sectors were not used, shrink the window */
+			Ra.window /= 2;
+		}
+		if (Ra.window < RA_WINDOW_MIN) Ra.window = RA_WINDOW_MIN;
+		n = count + Ra.window;
+		if (n > RA_SECTORS) n = RA_SECTORS;
+		if (Ra.sectors && sector + n > Ra.sectors) n = (UINT)(Ra.sectors - sector);	/* Not beyond the end of the card */
+		Ra.count = 0;
+		if (n > count) {	/* Read the request and the window by one transaction */
+			res = sdSpiRead(&sdHandler, BLK(sector), Ra.buf[0], n * SS_BLOCKS);
+			if (res == SD_SPI_RESULT_OK) {
+				memcpy(buff, Ra.buf[0], (size_t)count * FF_MAX_SS);
+				Ra.ofs = count; Ra.count = n - count; Ra.start = sector + count;
+				Ra.last = sector + count;
+				return res;
+			}
+		}
+	}
+
+	res = sdSpiRead(&sdHandler, BLK(sector), buff, count * SS_BLOCKS);
+	if (seq || !Ra.count) {	/* The reads out of the stream, as the metadata reads, keep the read-ahead sectors */
+		Ra.count = 0;
+		Ra.last = sector + count;
+	}
+
+	return res;
+}
+#endif
+
+
+/* Mount profile: the sectors read after the initialization are saved by CTRL_SAVE_PROFILE
+   and prefetched by the next initialization to the read-ahead buffer. The first read out of
+   the profile returns the buffer to the read-ahead */
+#define PF_SECTORS		RA_SECTORS	/* Number of the profile sectors (0:Disable) */
+#define PF_LBA			1			/* Profile sector in the gap between the MBR and the first partition */
+#define PF_SIGN			0x4650524D	/* Profile sector signature "MRPF" */
+
+#if PF_SECTORS
+#if PF_SECTORS < 2 || PF_SECTORS > (FF_MAX_SS - 12) / 4
+#error Wrong PF_SECTORS setting
+#endif
+#if PF_SECTORS > RA_SECTORS
+#error The profile sectors are prefetched to the read-ahead buffer
+#endif
+
+static struct {
+	LBA_t sect[PF_SECTORS];	/* Sector in each Ra.buf[] (PF_BLANK:blank) */
+	LBA_t rec[PF_SECTORS];	/* Sectors read after the initialization */
+	UINT nrec;		/* Number of the recorded sectors */
+	int live;		/* The prefetched sectors hold the read-ahead buffer */
+} Pf;
+
+#define PF_BLANK		((LBA_t)0 - 1)
+
 
 /*-----------------------------------------------------------------------*/
-/* Inidialize a Drive                                                    */
+/* Drop the prefetched sectors in the sector range                       */
 /*-----------------------------------------------------------------------*/
 
-DSTATUS disk_initialize (
-	BYTE pdrv				/* Physical drive nmuber to identify the drive */
+static void pf_invalidate (
+	LBA_t sector,	/* Start sector */
+	LBA_t count		/* Number of sectors */
 )
 {
-	DSTATUS stat;
-	int result;
-	SdSpiResult sdStatus;
-    
-	//sdStatus = sdSpiInit(&sdHandler, const SdSpiCb *cb);
+	UINT i;
 
-	return 0;
+	for (i = 0; i < PF_SECTORS; i++) {
+		if (Pf.sect[i] != PF_BLANK && Pf.sect[i] - sector < count) Pf.sect[i] = PF_BLANK;
+	}
 }
 
 
+/*-----------------------------------------------------------------------*/
+/* Drop the prefetched sectors, the buffer is used by the read-ahead     */
+/*-----------------------------------------------------------------------*/
+
+static void pf_drop (void)
+{
+	memset(Pf.sect, 0xFF, sizeof Pf.sect);
+	Pf.live = 0;
+	Ra.count = 0;
+}
+
 
 /*-----------------------------------------------------------------------*/
-/* Read Sector(s)                                                        */
+/* Get a prefetched sector or record the sector read after the init      */
 /*-----------------------------------------------------------------------*/
 
-DRESULT disk_read (
-	BYTE pdrv,		/* Physical drive nmuber to identify the drive */
+static int pf_read (	/* 1:The sector is served from the prefetched sectors */
 	BYTE *buff,		/* Data buffer to store read data */
 	LBA_t sector,	/* Start sector in LBA */
 	UINT count		/* Number of sectors to read */
 )
 {
-	DRESULT res;
-	int result;
-
-	switch (pdrv) {
-	case DEV_RAM :
-		// translate the arguments here
+	UINT i;
+
+	if (count == 1) {	/* The metadata is read by the single sectors */
+		for (i = 0; i < Pf.nrec && Pf.rec[i] != sector; i++) ;
+		if (i == Pf.nrec && Pf.nrec < PF_SECTORS && sector != 0) Pf.rec[Pf.nrec++] = sector;	/* The MBR is always loaded */
+		for (i = 0; Pf.live && i < PF_SECTORS; i++) {
+			if (Pf.sect[i] == sector) {
+				memcpy(buff, Ra.buf[i], FF_MAX_SS);
+				return 1;
+			}
+		}
+	}
+	if (Pf.live) pf_drop();		/* The mount is over at the first read out of the profile */
+	return 0;
+}
 
-		result = RAM_disk_read(buff, sector, count);
 
-		// translate the reslut code here
+/*-----------------------------------------------------------------------*/
+/* Check the profile sector is in the gap after the MBR                  */
+/*-----------------------------------------------------------------------*/
 
-		return res;
+static int pf_check_gap (	/* 1:The sector 0 is the MBR and the first partition starts after the profile sector */
+	const BYTE *mbr		/* Sector 0 */
+)
+{
+	DWORD start;
 
-	case DEV_MMC :
-		// translate the arguments here
+	memcpy(&start, &mbr[446 + 8], 4);	/* Start of the first partition */
+	return mbr[510] == 0x55 && mbr[511] == 0xAA && mbr[446 + 4] != 0 && start > PF_LBA
+		&& memcmp(&mbr[54], "FAT", 3) && memcmp(&mbr[82], "FAT32", 5) && memcmp(&mbr[3], "EXFAT", 5);	/* Not a boot sector of SFD volume */
+}
 
-		result = MMC_disk_read(buff, sector, count);
 
-		// translate the reslut code here
+/*-----------------------------------------------------------------------*/
+/* Load the MBR and the profile, prefetch the profile sectors            */
+/*-----------------------------------------------------------------------*/
+/* The sectors are sorted and the consecutive ones are read by one       */
+/* multiple block read. The profile is used only when the sector 0 is    */
+/* the MBR and the first partition starts after the profile sector.      */
 
-		return res;
+static void pf_load (
+	LBA_t sectors	/* Number of the sectors on the drive */
+)
+{
+	DWORD lba[PF_SECTORS], v, sum;
+	UINT i, j, n, cnt;
+
+	memset(&Pf, 0, sizeof Pf);
+	memset(Pf.sect, 0xFF, sizeof Pf.sect);
+	if (sdSpiRead(&sdHandler, BLK(0), Ra.buf[0], (PF_LBA + 1) * SS_BLOCKS) != SD_SPI_RESULT_OK) return;
+	Pf.sect[0] = 0;
+	Pf.live = 1;
+	if (!pf_check_gap(Ra.buf[0])) return;
+
+	/* Check the profile: signature, count, sectors, sum */
+	memcpy(&v, &Ra.buf[PF_LBA][0], 4);
+	memcpy(&cnt, &Ra.buf[PF_LBA][4], 4);
+	if (v != PF_SIGN || cnt > PF_SECTORS) return;
+	for (i = 0, sum = v + cnt; i < cnt; i++) {
+		memcpy(&lba[i], &Ra.buf[PF_LBA][8 + i * 4], 4);
+		sum += lba[i];
+	}
+	memcpy(&v, &Ra.buf[PF_LBA][8 + cnt * 4], 4);
+	if (v != sum) return;
 
-	case DEV_USB :
-		// translate the arguments here
+	for (i = 1; i < cnt; i++) {		/* Sort the sectors */
+		for (v = lba[i], j = i; j > 0 && lba[j - 1] > v; j--) lba[j] = lba[j - 1];
+		lba[j] = v;
+	}
+	for (i = 0, j = 1; i < cnt && j < PF_SECTORS; i += n, j += n) {	/* Read the runs of the consecutive sectors to the slots after the MBR */
+		for (n = 1; i + n < cnt && j + n < PF_SECTORS && lba[i + n] == lba[i] + n; n++) ;
+		if (lba[i] == 0 || (sectors && lba[i] + n > sectors)) {
+			n = 1; j--;		/* Skip the not valid sector */
+			continue;
+		}
+		if (sdSpiRead(&sdHandler, BLK(lba[i]), Ra.buf[j], n * SS_BLOCKS) != SD_SPI_RESULT_OK) break;
+		for (v = 0; v < n; v++) Pf.sect[j + v] = lba[i] + v;
+	}
+}
 
-		result = USB_disk_read(buff, sector, count);
 
-		// translate the reslut code here
+/*-----------------------------------------------------------------------*/
+/* Save the sectors read after the initialization as the profile         */
+/*-----------------------------------------------------------------------*/
 
-		return res;
+static DRESULT pf_save (void)
+{
+	BYTE *buf = Ra.buf[0];		/* The read-ahead buffer is the work buffer */
+	DWORD v, sum;
+	UINT i;
+
+	pf_drop();
+	if (sdSpiRead(&sdHandler, BLK(0), buf, SS_BLOCKS) != SD_SPI_RESULT_OK) return RES_ERROR;
+	if (!pf_check_gap(buf)) return RES_PARERR;	/* The volume may be formatted after the initialization */
+	memset(buf, 0, FF_MAX_SS);
+	v = PF_SIGN; memcpy(&buf[0], &v, 4);
+	memcpy(&buf[4], &Pf.nrec, 4);
+	for (i = 0, sum = PF_SIGN + Pf.nrec; i < Pf.nrec; i++) {
+		v = (DWORD)Pf.rec[i]; memcpy(&buf[8 + i * 4], &v, 4);
+		sum += v;
 	}
-
-	return RES_PARERR;
+	memcpy(&buf[8 + i * 4], &sum, 4);
+	return sdSpiWrite(&sdHandler, BLK(PF_LBA), buf, SS_BLOCKS) == SD_SPI_RESULT_OK ? RES_OK : RES_ERROR;
 }
+#endif
 
 
 
 /*-----------------------------------------------------------------------*/
-/* Write Sector(s)                                                       */
+/* Attach the SD card on the SPI bus to the drive                        */
 /*-----------------------------------------------------------------------*/
 
-#if FF_FS_READONLY == 0
+void disk_attach_sdspi (
+	BYTE pdrv,				/* Physical drive nmuber to identify the drive */
+	const SdSpiCb* cb		/* SPI bus callbacks of the SdSpi driver */
+)
+{
+	if (pdrv != DEV_MMC || cb == NULL) return;
 
-DRESULT disk_write (
-	BYTE pdrv,			/* Physical drive nmuber to identify the drive */
-	const BYTE *buff,	/* Data to be written */
-	LBA_t sector,		/* Start sector in LBA */
-	UINT count			/* Number of sectors to write */
+	sdCb = *cb;
+	Stat = STA_NOINIT;		/* The card is initialized by disk_initialize() */
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Get Drive Status                                                      */
+/*-----------------------------------------------------------------------*/
+
+DSTATUS disk_status (
+	BYTE pdrv		/* Physical drive nmuber to identify the drive */
 )
 {
-	DRESULT res;
-	int result;
+	if (pdrv != DEV_MMC) return STA_NOINIT;
 
-	switch (pdrv) {
-	case DEV_RAM :
-		// translate the arguments here
+	return Stat;
+}
 
-		result = RAM_disk_write(buff, sector, count);
 
-		// translate the reslut code here
 
-		return res;
+/*-----------------------------------------------------------------------*/
+/* Inidialize a Drive                                                    */
+/*-----------------------------------------------------------------------*/
 
-	case DEV_MMC :
-		// translate the arguments here
+DSTATUS disk_initialize (
+	BYTE pdrv				/* Physical drive nmuber to identify the drive */
+)
+{
+	if (pdrv != DEV_MMC) return STA_NOINIT;
+	if (Stat & STA_NODISK) return Stat;	/* The card is not attached */
+
+	disk_lock(1);
+	if (sdSpiInit(&sdHandler, &sdCb) == SD_SPI_RESULT_OK) {
+		Stat &= ~STA_NOINIT;
+		SdSpiMetaInformation meta;
+		LBA_t sectors = 0;
+
+		if (sdSpiGetMetaInformation(&sdHandler, &meta) == SD_SPI_RESULT_OK) sectors = meta.blockCount / SS_BLOCKS;
+#if RA_SECTORS
+		memset(&Ra, 0, sizeof Ra);
+		Ra.sectors = sectors;
+#endif
+#if PF_SECTORS
+		pf_load(sectors);
+#else
+		(void)sectors;
+#endif
+	} else {
+		Stat |= STA_NOINIT;
+	}
+	disk_lock(0);
 
-		result = MMC_disk_write(buff, sector, count);
+	return Stat;
+}
 
-		// translate the reslut code here
 
-		return res;
 
-	case DEV_USB :
-		// translate the arguments here
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s)                                                        */
+/*-----------------------------------------------------------------------*/
 
-		result = USB_disk_write(buff, sector, count);
+DRESULT disk_read (
+	BYTE pdrv,		/* Physical drive nmuber to identify the drive */
+	BYTE *buff,		/* Data buffer to store read data */
+	LBA_t sector,	/* Start sector in LBA */
+	UINT count		/* Number of sectors to read */
+)
+{
+	SdSpiResult res;
 
-		// translate the reslut code here
+	if (pdrv != DEV_MMC || count == 0) return RES_PARERR;
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
 
-		return res;
+	disk_lock(1);
+#if PF_SECTORS
+	if (pf_read(buff, sector, count)) {
+		disk_lock(0);
+		return RES_OK;
 	}
+#endif
+#if RA_SECTORS
+	res = ra_read(buff, sector, count);
+#else
+	res = sdSpiRead(&sdHandler, BLK(sector), buff, count * SS_BLOCKS);
+#endif
+	disk_lock(0);
 
-	return RES_PARERR;
+	return res == SD_SPI_RESULT_OK ? RES_OK : RES_ERROR;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Write Sector(s)                                                       */
+/*-----------------------------------------------------------------------*/
+
+#if FF_FS_READONLY == 0
+
+DRESULT disk_write (
+	BYTE pdrv,			/* Physical drive nmuber to identify the drive */
+	const BYTE *buff,	/* Data to be written */
+	LBA_t sector,		/* Start sector in LBA */
+	UINT count			/* Number of sectors to write */
+)
+{
+	SdSpiResult res;
+
+	if (pdrv != DEV_MMC || count == 0) return RES_PARERR;
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+
+	disk_lock(1);
+#if RA_SECTORS
+	ra_invalidate(sector, count);
+#endif
+#if PF_SECTORS
+	pf_invalidate(sector, count);
+#endif
+	res = sdSpiWrite(&sdHandler, BLK(sector), (uint8_t*)buff, count * SS_BLOCKS);
+	disk_lock(0);
+
+	return res == SD_SPI_RESULT_OK ? RES_OK : RES_ERROR;
 }
 
 #endif
@@ -159,28 +470,105 @@ DRESULT disk_ioctl (
 )
 {
 	DRESULT res;
-	int result;
+	SdSpiMetaInformation meta;
+	LBA_t *range;
+	LBA_t unit, start, end;
+
+	if (pdrv != DEV_MMC) return RES_PARERR;
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+	if (sdSpiGetMetaInformation(&sdHandler, &meta) != SD_SPI_RESULT_OK) return RES_ERROR;
+
+	res = RES_ERROR;
+	disk_lock(1);
+	switch (cmd) {
+	case CTRL_SYNC :		/* Every write waits the end of the card busy state, nothing is pending */
+		res = RES_OK;
+		break;
+
+	case GET_SECTOR_COUNT :	/* Number of the sectors on the 512 bytes blocks by the CSD */
+		*(LBA_t*)buff = meta.blockCount / SS_BLOCKS;
+		res = RES_OK;
+		break;
+
+	case GET_SECTOR_SIZE :
+		*(WORD*)buff = FF_MAX_SS;
+		res = RES_OK;
+		break;
+
+	case GET_BLOCK_SIZE :	/* Erase block size in sectors = AU size, 1 if unknown */
+		*(DWORD*)buff = meta.auBlocks >= SS_BLOCKS ? meta.auBlocks / SS_BLOCKS : 1;
+		res = RES_OK;
+		break;
+
+	case CTRL_TRIM :		/* Erase the sectors no longer used: buff[0] start, buff[1] end (inclusive) */
+		range = (LBA_t*)buff;
+		unit = meta.auBlocks ? meta.auBlocks : meta.eraseSectorBlocks;	/* The card erases by the whole AUs */
+		unit = unit >= SS_BLOCKS ? unit / SS_BLOCKS : 1;
+		start = (range[0] + unit - 1) / unit * unit;	/* Each erase costs the busy time, so the clusters of a */
+		end = (range[1] + 1) / unit * unit;			/* fragmented file and the parts of the AU are not erased */
+		if (start >= end) {
+			res = RES_OK;
+			break;
+		}
+#if RA_SECTORS
+		ra_invalidate(start, end - start);
+#endif
+#if PF_SECTORS
+		pf_invalidate(start, end - start);
+#endif
+		if (sdSpiErase(&sdHandler, BLK(start), BLK(end) - 1) == SD_SPI_RESULT_OK) res = RES_OK;
+		break;
+
+	case CTRL_ZERO :		/* Zero the sectors by erase if the erased blocks read as zeros */
+		range = (LBA_t*)buff;
+		if (!meta.erasedToZero || !meta.eraseSingleBlock) {	/* Erase is not usable for zero fill */
+			res = RES_PARERR;
+			break;
+		}
+#if RA_SECTORS
+		ra_invalidate(range[0], range[1] - range[0] + 1);
+#endif
+#if PF_SECTORS
+		pf_invalidate(range[0], range[1] - range[0] + 1);
+#endif
+		if (sdSpiErase(&sdHandler, BLK(range[0]), BLK(range[1]) + SS_BLOCKS - 1) == SD_SPI_RESULT_OK) res = RES_OK;
+		break;
 
-	switch (pdrv) {
-	case DEV_RAM :
+	case MMC_GET_CSD :		/* Read CSD (16 bytes) */
+		if (sdSpiReadCsdRegister(&sdHandler, (uint8_t*)buff) == SD_SPI_RESULT_OK) res = RES_OK;
+		break;
 
-		// Process of the command for the RAM drive
+	case MMC_GET_CID :		/* Read CID (16 bytes) */
+		if (sdSpiReadCidRegister(&sdHandler, (uint8_t*)buff) == SD_SPI_RESULT_OK) res = RES_OK;
+		break;
 
-		return res;
+	case MMC_GET_SDSTAT :	/* Read SD Status (64 bytes) */
+		if (sdSpiReadSdStatusRegister(&sdHandler, (uint8_t*)buff) == SD_SPI_RESULT_OK) res = RES_OK;
+		break;
 
-	case DEV_MMC :
+#if PF_SECTORS
+	case CTRL_SAVE_PROFILE :	/* Save the mount profile, RES_PARERR if there is no MBR gap for it */
+		res = pf_save();
+		break;
+#endif
 
-		// Process of the command for the MMC/SD card
+	default:
+		res = RES_PARERR;
+	}
+	disk_lock(0);
 
-		return res;
+	return res;
+}
 
-	case DEV_USB :
 
-		// Process of the command the USB drive
 
-		return res;
-	}
+#if !FF_FS_READONLY && !FF_FS_NORTC
+/*-----------------------------------------------------------------------*/
+/* Get current time, the application with a RTC overrides it             */
+/*-----------------------------------------------------------------------*/
 
-	return RES_PARERR;
+__attribute__((weak)) DWORD get_fattime (void)
+{
+	return ((DWORD)(FF_NORTC_YEAR - 1980) << 25 | (DWORD)FF_NORTC_MON << 21 | (DWORD)FF_NORTC_MDAY << 16);
 }
-
+#endif
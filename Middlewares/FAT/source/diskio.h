@@ -9,6 +9,8 @@
 extern "C" {
 #endif
 
+#include "SdSpi.h"
+
 /* Status of Disk Functions */
 typedef BYTE	DSTATUS;
 
@@ -31,6 +33,10 @@ DSTATUS disk_status (BYTE pdrv);
 DRESULT disk_read (BYTE pdrv, BYTE* buff, LBA_t sector, UINT count);
 DRESULT disk_write (BYTE pdrv, const BYTE* buff, LBA_t sector, UINT count);
 DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
+void disk_attach_sdspi (BYTE pdrv, const SdSpiCb* cb);
+#if FF_FS_REENTRANT
+void ff_bus_lock (bool lock);	/* SdSpiCb.sdSpiBusLock on the OS recursive mutex (ffsystem.c) */
+#endif
 
 
 /* Disk Status Bits (DSTATUS) */
@@ -48,6 +54,7 @@ DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
 #define GET_SECTOR_SIZE		2	/* Get sector size (needed at FF_MAX_SS != FF_MIN_SS) */
 #define GET_BLOCK_SIZE		3	/* Get erase block size (needed at FF_USE_MKFS == 1) */
 #define CTRL_TRIM			4	/* Inform device that the data on the block of sectors is no longer used (needed at FF_USE_TRIM == 1) */
+#define CTRL_ZERO			9	/* Fill the block of sectors with zeros without data transfer (needed at FF_USE_ZERO_FILL == 1) */
 
 /* Generic command (Not used by FatFs) */
 #define CTRL_POWER			5	/* Get/Set power status */
@@ -61,6 +68,7 @@ DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
 #define MMC_GET_CID			12	/* Get CID */
 #define MMC_GET_OCR			13	/* Get OCR */
 #define MMC_GET_SDSTAT		14	/* Get SD status */
+#define CTRL_SAVE_PROFILE	15	/* Save the sectors read after the initialization to be prefetched at the next one (clean shutdown) */
 #define ISDIO_READ			55	/* Read data form SD iSDIO register */
 #define ISDIO_WRITE			56	/* Write data to SD iSDIO register */
 #define ISDIO_MRITE			57	/* Masked write data to SD iSDIO register */
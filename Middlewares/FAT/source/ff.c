@@ -278,6 +278,14 @@
 
 
 /* File lock controls */
+#if FF_FAT_CACHE == 1 || FF_FAT_CACHE > 255
+#error Wrong FF_FAT_CACHE setting
+#endif
+
+#if FF_FS_BUFPOOL && FF_FS_TINY
+#error FF_FS_BUFPOOL must be 0 at tiny configuration
+#endif
+
 #if FF_FS_LOCK
 #if FF_FS_READONLY
 #error FF_FS_LOCK must be 0 at read-only configuration
@@ -1100,6 +1108,158 @@ static FRESULT move_window (	/* Returns FR_OK or FR_DISK_ERR */
 
 
 
+/*-----------------------------------------------------------------------*/
+/* FAT access - Get the FAT sector buffer                                */
+/*-----------------------------------------------------------------------*/
+
+#if FF_FAT_CACHE
+#if !FF_FS_READONLY
+static FRESULT flush_fat_run (	/* Returns FR_OK or FR_DISK_ERR */
+	FATFS* fs,		/* Filesystem object */
+	UINT i			/* Dirty slot to write back with the following dirty slots of the adjacent sectors */
+)
+{
+	UINT n;
+
+
+	for (n = 1; i + n < FF_FAT_CACHE && fs->fc_dirty[i + n] && fs->fc_sect[i + n] == fs->fc_sect[i] + n; n++) ;
+	if (disk_write(fs->pdrv, fs->fc_buf[i], fs->fc_sect[i], n) != RES_OK) return FR_DISK_ERR;
+	if (fs->n_fats == 2) disk_write(fs->pdrv, fs->fc_buf[i], fs->fc_sect[i] + fs->fsize, n);	/* Reflect them to 2nd FAT */
+	while (n) fs->fc_dirty[i + --n] = 0;
+	return FR_OK;
+}
+
+
+static FRESULT sync_fat (	/* Returns FR_OK or FR_DISK_ERR */
+	FATFS* fs		/* Filesystem object */
+)
+{
+	FRESULT res = FR_OK;
+	UINT i;
+
+
+	for (i = 0; i < FF_FAT_CACHE && res == FR_OK; i++) {
+		if (fs->fc_dirty[i]) res = flush_fat_run(fs, i);
+	}
+	return res;
+}
+#endif
+
+
+static BYTE* fat_sector (	/* Pointer to the sector buffer, 0:disk error */
+	FATFS* fs,		/* Filesystem object */
+	LBA_t sect,		/* FAT sector LBA */
+	int wr			/* 1:The sector is to be modified */
+)
+{
+	UINT i;
+
+
+	for (i = 0; i < FF_FAT_CACHE && fs->fc_sect[i] != sect; i++) ;	/* Find the sector in the cache */
+	if (i == FF_FAT_CACHE) {	/* Load the sector into the next slot in round-robin, so that the adjacent sectors go to the adjacent slots */
+		i = fs->fc_next;
+#if !FF_FS_READONLY
+		if (fs->fc_dirty[i] && flush_fat_run(fs, i) != FR_OK) return 0;
+#endif
+		fs->fc_next = (BYTE)((i + 1) % FF_FAT_CACHE);
+		if (disk_read(fs->pdrv, fs->fc_buf[i], sect, 1) != RES_OK) {
+			fs->fc_sect[i] = (LBA_t)0 - 1;	/* Invalidate the slot if read data is not valid */
+			return 0;
+		}
+		fs->fc_sect[i] = sect;
+	}
+#if !FF_FS_READONLY
+	if (wr) fs->fc_dirty[i] = 1;
+#endif
+	return fs->fc_buf[i];
+}
+
+#else
+
+static BYTE* fat_sector (	/* Pointer to the sector buffer, 0:disk error */
+	FATFS* fs,		/* Filesystem object */
+	LBA_t sect,		/* FAT sector LBA */
+	int wr			/* 1:The sector is to be modified */
+)
+{
+	if (move_window(fs, sect) != FR_OK) return 0;
+#if !FF_FS_READONLY
+	if (wr) fs->wflag = 1;
+#endif
+	return fs->win;
+}
+#endif	/* FF_FAT_CACHE */
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* File data access - Lease a sector buffer from the pool                */
+/*-----------------------------------------------------------------------*/
+
+#if FF_FS_BUFPOOL
+static FRESULT lease_fbuf (	/* Returns FR_OK or FR_DISK_ERR */
+	FIL* fp,		/* File object to get the sector buffer */
+	int ld			/* 1:Reload fp->sect if the buffer has been reclaimed */
+)
+{
+	FATFS *fs = fp->obj.fs;
+	FIL *own;
+	UINT i, n;
+
+
+	if (fp->buf) {	/* The file holds the buffer */
+		fs->bp_used[(fp->buf - fs->bp_buf[0]) / FF_MAX_SS] = ++fs->bp_stamp;
+		return FR_OK;
+	}
+	for (i = n = 0; i < FF_FS_BUFPOOL; i++) {	/* Find a blank buffer or the least recently used one */
+		if (!fs->bp_owner[i]) {	/* Blank buffer */
+			n = i;
+			break;
+		}
+		if (fs->bp_used[i] < fs->bp_used[n]) n = i;
+	}
+	own = fs->bp_owner[n];
+	if (own) {	/* Reclaim the buffer from the owner, it keeps fp->sect and reloads it on the next access */
+#if !FF_FS_READONLY
+		if (own->flag & FA_DIRTY) {	/* Write-back dirty sector */
+			if (disk_write(fs->pdrv, own->buf, own->sect, 1) != RES_OK) return FR_DISK_ERR;
+			own->flag &= (BYTE)~FA_DIRTY;
+		}
+#endif
+		own->buf = 0;
+	}
+	fs->bp_owner[n] = fp;
+	fs->bp_used[n] = ++fs->bp_stamp;
+	fp->buf = fs->bp_buf[n];
+	if (ld && fp->sect != 0 && disk_read(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) {
+		fs->bp_owner[n] = 0; fp->buf = 0;
+		return FR_DISK_ERR;
+	}
+	return FR_OK;
+}
+
+
+static void release_fbuf (
+	FIL* fp			/* File object to return the sector buffer */
+)
+{
+	FATFS *fs = fp->obj.fs;
+	UINT i;
+
+
+	for (i = 0; i < FF_FS_BUFPOOL; i++) {	/* The closed file is not referred by the pool */
+		if (fs->bp_owner[i] == fp) fs->bp_owner[i] = 0;
+	}
+	fp->buf = 0;
+}
+#else
+#define lease_fbuf(fp, ld) FR_OK
+#endif
+
+
+
+
 #if !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
 /* Synchronize filesystem and data on the storage                        */
@@ -1112,7 +1272,12 @@ static FRESULT sync_fs (	/* Returns FR_OK or FR_DISK_ERR */
 	FRESULT res;
 
 
+#if FF_FAT_CACHE
+	res = sync_fat(fs);
+	if (res == FR_OK) res = sync_window(fs);
+#else
 	res = sync_window(fs);
+#endif
 	if (res == FR_OK) {
 		if (fs->fs_type == FS_FAT32 && fs->fsi_flag == 1) {	/* FAT32: Update FSInfo sector if needed */
 			/* Create FSInfo structure */
@@ -1165,6 +1330,7 @@ static DWORD get_fat (		/* 0xFFFFFFFF:Disk error, 1:Internal error, 2..0x7FFFFFF
 {
 	UINT wc, bc;
 	DWORD val;
+	BYTE *p;
 	FATFS *fs = obj->fs;
 
 
@@ -1177,21 +1343,21 @@ static DWORD get_fat (		/* 0xFFFFFFFF:Disk error, 1:Internal error, 2..0x7FFFFFF
 		switch (fs->fs_type) {
 		case FS_FAT12 :
 			bc = (UINT)clst; bc += bc / 2;
-			if (move_window(fs, fs->fatbase + (bc / SS(fs))) != FR_OK) break;
-			wc = fs->win[bc++ % SS(fs)];		/* Get 1st byte of the entry */
-			if (move_window(fs, fs->fatbase + (bc / SS(fs))) != FR_OK) break;
-			wc |= fs->win[bc % SS(fs)] << 8;	/* Merge 2nd byte of the entry */
+			if ((p = fat_sector(fs, fs->fatbase + (bc / SS(fs)), 0)) == 0) break;
+			wc = p[bc++ % SS(fs)];		/* Get 1st byte of the entry */
+			if ((p = fat_sector(fs, fs->fatbase + (bc / SS(fs)), 0)) == 0) break;
+			wc |= p[bc % SS(fs)] << 8;	/* Merge 2nd byte of the entry */
 			val = (clst & 1) ? (wc >> 4) : (wc & 0xFFF);	/* Adjust bit position */
 			break;
 
 		case FS_FAT16 :
-			if (move_window(fs, fs->fatbase + (clst / (SS(fs) / 2))) != FR_OK) break;
-			val = ld_word(fs->win + clst * 2 % SS(fs));		/* Simple WORD array */
+			if ((p = fat_sector(fs, fs->fatbase + (clst / (SS(fs) / 2)), 0)) == 0) break;
+			val = ld_word(p + clst * 2 % SS(fs));		/* Simple WORD array */
 			break;
 
 		case FS_FAT32 :
-			if (move_window(fs, fs->fatbase + (clst / (SS(fs) / 4))) != FR_OK) break;
-			val = ld_dword(fs->win + clst * 4 % SS(fs)) & 0x0FFFFFFF;	/* Simple DWORD array but mask out upper 4 bits */
+			if ((p = fat_sector(fs, fs->fatbase + (clst / (SS(fs) / 4)), 0)) == 0) break;
+			val = ld_dword(p + clst * 4 % SS(fs)) & 0x0FFFFFFF;	/* Simple DWORD array but mask out upper 4 bits */
 			break;
 #if FF_FS_EXFAT
 		case FS_EXFAT :
@@ -1211,8 +1377,8 @@ static DWORD get_fat (		/* 0xFFFFFFFF:Disk error, 1:Internal error, 2..0x7FFFFFF
 					if (obj->n_frag != 0) {	/* Is it on the growing edge? */
 						val = 0x7FFFFFFF;	/* Generate EOC */
 					} else {
-						if (move_window(fs, fs->fatbase + (clst / (SS(fs) / 4))) != FR_OK) break;
-						val = ld_dword(fs->win + clst * 4 % SS(fs)) & 0x7FFFFFFF;
+						if ((p = fat_sector(fs, fs->fatbase + (clst / (SS(fs) / 4)), 0)) == 0) break;
+						val = ld_dword(p + clst * 4 % SS(fs)) & 0x7FFFFFFF;
 					}
 					break;
 				}
@@ -1251,36 +1417,35 @@ static FRESULT put_fat (	/* FR_OK(0):succeeded, !=0:error */
 		switch (fs->fs_type) {
 		case FS_FAT12:
 			bc = (UINT)clst; bc += bc / 2;	/* bc: byte offset of the entry */
-			res = move_window(fs, fs->fatbase + (bc / SS(fs)));
-			if (res != FR_OK) break;
-			p = fs->win + bc++ % SS(fs);
+			res = FR_DISK_ERR;
+			if ((p = fat_sector(fs, fs->fatbase + (bc / SS(fs)), 1)) == 0) break;
+			p += bc++ % SS(fs);
 			*p = (clst & 1) ? ((*p & 0x0F) | ((BYTE)val << 4)) : (BYTE)val;	/* Update 1st byte */
-			fs->wflag = 1;
-			res = move_window(fs, fs->fatbase + (bc / SS(fs)));
-			if (res != FR_OK) break;
-			p = fs->win + bc % SS(fs);
+			if ((p = fat_sector(fs, fs->fatbase + (bc / SS(fs)), 1)) == 0) break;
+			p += bc % SS(fs);
 			*p = (clst & 1) ? (BYTE)(val >> 4) : ((*p & 0xF0) | ((BYTE)(val >> 8) & 0x0F));	/* Update 2nd byte */
-			fs->wflag = 1;
+			res = FR_OK;
 			break;
 
 		case FS_FAT16:
-			res = move_window(fs, fs->fatbase + (clst / (SS(fs) / 2)));
-			if (res != FR_OK) break;
-			st_word(fs->win + clst * 2 % SS(fs), (WORD)val);	/* Simple WORD array */
-			fs->wflag = 1;
+			res = FR_DISK_ERR;
+			if ((p = fat_sector(fs, fs->fatbase + (clst / (SS(fs) / 2)), 1)) == 0) break;
+			st_word(p + clst * 2 % SS(fs), (WORD)val);	/* Simple WORD array */
+			res = FR_OK;
 			break;
 
 		case FS_FAT32:
 #if FF_FS_EXFAT
 		case FS_EXFAT:
 #endif
-			res = move_window(fs, fs->fatbase + (clst / (SS(fs) / 4)));
-			if (res != FR_OK) break;
+			res = FR_DISK_ERR;
+			if ((p = fat_sector(fs, fs->fatbase + (clst / (SS(fs) / 4)), 1)) == 0) break;
+			p += clst * 4 % SS(fs);
 			if (!FF_FS_EXFAT || fs->fs_type != FS_EXFAT) {
-				val = (val & 0x0FFFFFFF) | (ld_dword(fs->win + clst * 4 % SS(fs)) & 0xF0000000);
+				val = (val & 0x0FFFFFFF) | (ld_dword(p) & 0xF0000000);
 			}
-			st_dword(fs->win + clst * 4 % SS(fs), val);
-			fs->wflag = 1;
+			st_dword(p, val);
+			res = FR_OK;
 			break;
 		}
 	}
@@ -1307,7 +1472,7 @@ static DWORD find_bitmap (	/* 0:Not found, 2..:Cluster block found, 0xFFFFFFFF:D
 	DWORD ncl	/* Number of contiguous clusters to find (1..) */
 )
 {
-	BYTE bm, bv;
+	BYTE bm, bv, *p;
 	UINT i;
 	DWORD val, scl, ctr;
 
@@ -1316,11 +1481,11 @@ static DWORD find_bitmap (	/* 0:Not found, 2..:Cluster block found, 0xFFFFFFFF:D
 	if (clst >= fs->n_fatent - 2) clst = 0;
 	scl = val = clst; ctr = 0;
 	for (;;) {
-		if (move_window(fs, fs->bitbase + val / 8 / SS(fs)) != FR_OK) return 0xFFFFFFFF;
+		if ((p = fat_sector(fs, fs->bitbase + val / 8 / SS(fs), 0)) == 0) return 0xFFFFFFFF;
 		i = val / 8 % SS(fs); bm = 1 << (val % 8);
 		do {
 			do {
-				bv = fs->win[i] & bm; bm <<= 1;		/* Get bit value */
+				bv = p[i] & bm; bm <<= 1;		/* Get bit value */
 				if (++val >= fs->n_fatent - 2) {	/* Next cluster (with wrap-around) */
 					val = 0; bm = 0; i = SS(fs);
 				}
@@ -1348,7 +1513,7 @@ static FRESULT change_bitmap (
 	int bv		/* bit value to be set (0 or 1) */
 )
 {
-	BYTE bm;
+	BYTE bm, *p;
 	UINT i;
 	LBA_t sect;
 
@@ -1358,12 +1523,11 @@ static FRESULT change_bitmap (
 	i = clst / 8 % SS(fs);					/* Byte offset in the sector */
 	bm = 1 << (clst % 8);					/* Bit mask in the byte */
 	for (;;) {
-		if (move_window(fs, sect++) != FR_OK) return FR_DISK_ERR;
+		if ((p = fat_sector(fs, sect++, 1)) == 0) return FR_DISK_ERR;
 		do {
 			do {
-				if (bv == (int)((fs->win[i] & bm) != 0)) return FR_INT_ERR;	/* Is the bit expected value? */
-				fs->win[i] ^= bm;	/* Flip the bit */
-				fs->wflag = 1;
+				if (bv == (int)((p[i] & bm) != 0)) return FR_INT_ERR;	/* Is the bit expected value? */
+				p[i] ^= bm;	/* Flip the bit */
 				if (--ncl == 0) return FR_OK;	/* All bits processed? */
 			} while (bm <<= 1);		/* Next bit */
 			bm = 1;
@@ -1421,6 +1585,141 @@ static FRESULT fill_last_frag (
 
 
 
+#if FF_FS_FREEMAP && !FF_FS_READONLY
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Update the free cluster summary                        */
+/*-----------------------------------------------------------------------*/
+
+static void change_fmap (
+	FATFS* fs,		/* Filesystem object */
+	DWORD clst,		/* Cluster# changed its status */
+	DWORD n			/* 1:Cluster got free, (DWORD)-1:Cluster got in use */
+)
+{
+	if (fs->fm_ncl != 0) fs->fmap[clst / fs->fm_ncl] += n;	/* Is the summary valid? */
+}
+
+#endif	/* FF_FS_FREEMAP && !FF_FS_READONLY */
+
+
+
+#if !FF_FS_READONLY
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Count the free clusters by the full FAT scan           */
+/*-----------------------------------------------------------------------*/
+/* The free_clst gets the count and the free cluster summary is built on */
+/* the FAT/FAT32 volume.                                                 */
+
+static FRESULT scan_fat (	/* FR_OK(0):succeeded, !=0:error */
+	FATFS* fs,		/* Filesystem object */
+	DWORD* nclst	/* Pointer to a variable to return number of free clusters */
+)
+{
+	FRESULT res = FR_OK;
+	DWORD nfree, clst, stat;
+	LBA_t sect;
+	UINT i;
+	BYTE *p = 0;
+	FFOBJID obj;
+#if FF_FS_FREEMAP
+	DWORD fm_ncl = 0;
+#endif
+
+
+	nfree = 0;
+#if FF_FS_FREEMAP
+	if (fs->fs_type != FS_EXFAT) {	/* Build the free cluster summary on the FAT scan */
+		fm_ncl = (fs->n_fatent + FF_FS_FREEMAP - 1) / FF_FS_FREEMAP;
+		i = (fs->fs_type == FS_FAT32) ? SS(fs) / 4 : SS(fs) / 2;	/* Align the blocks to the FAT sector */
+		fm_ncl = (fm_ncl + i - 1) / i * i;
+		memset(fs->fmap, 0, sizeof fs->fmap);
+	}
+#endif
+	if (fs->fs_type == FS_FAT12) {	/* FAT12: Scan bit field FAT entries */
+		clst = 2; obj.fs = fs;
+		do {
+			stat = get_fat(&obj, clst);
+			if (stat == 0xFFFFFFFF) {
+				res = FR_DISK_ERR; break;
+			}
+			if (stat == 1) {
+				res = FR_INT_ERR; break;
+			}
+			if (stat == 0) {
+				nfree++;
+#if FF_FS_FREEMAP
+				fs->fmap[clst / fm_ncl]++;
+#endif
+			}
+		} while (++clst < fs->n_fatent);
+	} else {
+#if FF_FS_EXFAT
+		if (fs->fs_type == FS_EXFAT) {	/* exFAT: Scan allocation bitmap */
+			BYTE bm;
+			UINT b;
+
+			clst = fs->n_fatent - 2;	/* Number of clusters */
+			sect = fs->bitbase;			/* Bitmap sector */
+			i = 0;						/* Offset in the sector */
+			do {	/* Counts numbuer of bits with zero in the bitmap */
+				if (i == 0) {	/* New sector? */
+					p = fat_sector(fs, sect++, 0);
+					if (!p) {
+						res = FR_DISK_ERR; break;
+					}
+				}
+				for (b = 8, bm = ~p[i]; b && clst; b--, clst--) {
+					nfree += bm & 1;
+					bm >>= 1;
+				}
+				i = (i + 1) % SS(fs);
+			} while (clst);
+		} else
+#endif
+		{	/* FAT16/32: Scan WORD/DWORD FAT entries */
+			clst = fs->n_fatent;	/* Number of entries */
+			sect = fs->fatbase;		/* Top of the FAT */
+			i = 0;					/* Offset in the sector */
+			do {	/* Counts numbuer of entries with zero in the FAT */
+				if (i == 0) {	/* New sector? */
+					p = fat_sector(fs, sect++, 0);
+					if (!p) {
+						res = FR_DISK_ERR; break;
+					}
+				}
+				if (fs->fs_type == FS_FAT16) {
+					stat = ld_word(p + i);
+					i += 2;
+				} else {
+					stat = ld_dword(p + i) & 0x0FFFFFFF;
+					i += 4;
+				}
+				if (stat == 0) {
+					nfree++;
+#if FF_FS_FREEMAP
+					fs->fmap[(fs->n_fatent - clst) / fm_ncl]++;
+#endif
+				}
+				i %= SS(fs);
+			} while (--clst);
+		}
+	}
+	if (res == FR_OK) {		/* Update parameters if succeeded */
+		*nclst = nfree;			/* Return the free clusters */
+		fs->free_clst = nfree;	/* Now free_clst is valid */
+		fs->fsi_flag |= 1;		/* FAT32: FSInfo is to be updated */
+#if FF_FS_FREEMAP
+		fs->fm_ncl = fm_ncl;	/* Now the free cluster summary is valid */
+#endif
+	}
+
+	return res;
+}
+
+#endif	/* !FF_FS_READONLY */
+
+
+
 #if !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
 /* FAT handling - Remove a cluster chain                                 */
@@ -1459,6 +1758,9 @@ static FRESULT remove_chain (	/* FR_OK(0):succeeded, !=0:error */
 		if (!FF_FS_EXFAT || fs->fs_type != FS_EXFAT) {
 			res = put_fat(fs, clst, 0);		/* Mark the cluster 'free' on the FAT */
 			if (res != FR_OK) return res;
+#if FF_FS_FREEMAP
+			change_fmap(fs, clst, 1);
+#endif
 		}
 		if (fs->free_clst < fs->n_fatent - 2) {	/* Update FSINFO */
 			fs->free_clst++;
@@ -1584,6 +1886,12 @@ static DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:D
 			}
 		}
 		if (ncl == 0) {	/* The new cluster cannot be contiguous and find another fragment */
+#if FF_FS_FREEMAP
+			if (fs->fm_ncl == 0) {	/* Build the free cluster summary at the first cluster search */
+				res = scan_fat(fs, &cs);
+				if (res != FR_OK) return (res == FR_DISK_ERR) ? 0xFFFFFFFF : 1;
+			}
+#endif
 			ncl = scl;	/* Start cluster */
 			for (;;) {
 				ncl++;							/* Next cluster */
@@ -1591,6 +1899,13 @@ static DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:D
 					ncl = 2;
 					if (ncl > scl) return 0;	/* No free cluster found? */
 				}
+#if FF_FS_FREEMAP
+				if (fs->fm_ncl != 0 && fs->fmap[ncl / fs->fm_ncl] == 0) {	/* No free cluster in this block? */
+					if (ncl / fs->fm_ncl == scl / fs->fm_ncl && ncl <= scl) return 0;	/* No free cluster found? */
+					ncl = (ncl / fs->fm_ncl + 1) * fs->fm_ncl - 1;	/* Skip to the last cluster of the block */
+					continue;
+				}
+#endif
 				cs = get_fat(obj, ncl);			/* Get the cluster status */
 				if (cs == 0) break;				/* Found a free cluster? */
 				if (cs == 1 || cs == 0xFFFFFFFF) return cs;	/* Test for error */
@@ -1598,6 +1913,9 @@ static DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:D
 			}
 		}
 		res = put_fat(fs, ncl, 0xFFFFFFFF);		/* Mark the new cluster 'EOC' */
+#if FF_FS_FREEMAP
+		if (res == FR_OK) change_fmap(fs, ncl, (DWORD)-1);
+#endif
 		if (res == FR_OK && clst != 0) {
 			res = put_fat(fs, clst, ncl);		/* Link it from the previous one if needed */
 		}
@@ -1669,6 +1987,14 @@ static FRESULT dir_clear (	/* Returns FR_OK or FR_DISK_ERR */
 	sect = clst2sect(fs, clst);		/* Top of the cluster */
 	fs->winsect = sect;				/* Set window to top of the cluster */
 	memset(fs->win, 0, sizeof fs->win);	/* Clear window buffer */
+#if FF_USE_ZERO_FILL	/* Quick table clear by the device (e.g. erase) */
+	{
+		LBA_t rt[2];
+
+		rt[0] = sect; rt[1] = sect + fs->csize - 1;	/* Sector range of the cluster */
+		if (disk_ioctl(fs->pdrv, CTRL_ZERO, rt) == RES_OK) return FR_OK;
+	}
+#endif
 #if FF_USE_LFN == 3		/* Quick table clear by using multi-secter write */
 	/* Allocate a temporary buffer */
 	for (szb = ((DWORD)fs->csize * SS(fs) >= MAX_MALLOC) ? MAX_MALLOC : fs->csize * SS(fs), ibuf = 0; szb > SS(fs) && (ibuf = ff_memalloc(szb)) == 0; szb /= 2) ;
@@ -2378,11 +2704,12 @@ static FRESULT dir_read (
 
 
 /*-----------------------------------------------------------------------*/
-/* Directory handling - Find an object in the directory                  */
+/* Directory handling - Match the entries with the object name           */
 /*-----------------------------------------------------------------------*/
 
-static FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
-	DIR* dp					/* Pointer to the directory object with the file name */
+static FRESULT dir_match (	/* FR_OK(0):matched, FR_NO_FILE:not matched, !=0:error */
+	DIR* dp,				/* Pointer to the directory object with the file name at the entry to start */
+	int one					/* 0:Match to the end of table, 1:Match the entry block at the current entry only */
 )
 {
 	FRESULT res;
@@ -2390,32 +2717,7 @@ static FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 	BYTE c;
 #if FF_USE_LFN
 	BYTE a, ord, sum;
-#endif
 
-	res = dir_sdi(dp, 0);			/* Rewind directory object */
-	if (res != FR_OK) return res;
-#if FF_FS_EXFAT
-	if (fs->fs_type == FS_EXFAT) {	/* On the exFAT volume */
-		BYTE nc;
-		UINT di, ni;
-		WORD hash = xname_sum(fs->lfnbuf);		/* Hash value of the name to find */
-
-		while ((res = DIR_READ_FILE(dp)) == FR_OK) {	/* Read an item */
-#if FF_MAX_LFN < 255
-			if (fs->dirbuf[XDIR_NumName] > FF_MAX_LFN) continue;		/* Skip comparison if inaccessible object name */
-#endif
-			if (ld_word(fs->dirbuf + XDIR_NameHash) != hash) continue;	/* Skip comparison if hash mismatched */
-			for (nc = fs->dirbuf[XDIR_NumName], di = SZDIRE * 2, ni = 0; nc; nc--, di += 2, ni++) {	/* Compare the name */
-				if ((di % SZDIRE) == 0) di += 2;
-				if (ff_wtoupper(ld_word(fs->dirbuf + di)) != ff_wtoupper(fs->lfnbuf[ni])) break;
-			}
-			if (nc == 0 && !fs->lfnbuf[ni]) break;	/* Name matched? */
-		}
-		return res;
-	}
-#endif
-	/* On the FAT/FAT32 volume */
-#if FF_USE_LFN
 	ord = sum = 0xFF; dp->blk_ofs = 0xFFFFFFFF;	/* Reset LFN sequence */
 #endif
 	do {
@@ -2427,6 +2729,7 @@ static FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 		dp->obj.attr = a = dp->dir[DIR_Attr] & AM_MASK;
 		if (c == DDEM || ((a & AM_VOL) && a != AM_LFN)) {	/* An entry without valid data */
 			ord = 0xFF; dp->blk_ofs = 0xFFFFFFFF;	/* Reset LFN sequence */
+			if (one) { res = FR_NO_FILE; break; }
 		} else {
 			if (a == AM_LFN) {			/* An LFN entry is found */
 				if (!(dp->fn[NSFLAG] & NS_NOLFN)) {
@@ -2442,11 +2745,13 @@ static FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 				if (ord == 0 && sum == sum_sfn(dp->dir)) break;	/* LFN matched? */
 				if (!(dp->fn[NSFLAG] & NS_LOSS) && !memcmp(dp->dir, dp->fn, 11)) break;	/* SFN matched? */
 				ord = 0xFF; dp->blk_ofs = 0xFFFFFFFF;	/* Reset LFN sequence */
+				if (one) { res = FR_NO_FILE; break; }
 			}
 		}
 #else		/* Non LFN configuration */
 		dp->obj.attr = dp->dir[DIR_Attr] & AM_MASK;
 		if (!(dp->dir[DIR_Attr] & AM_VOL) && !memcmp(dp->dir, dp->fn, 11)) break;	/* Is it a valid entry? */
+		if (one) { res = FR_NO_FILE; break; }
 #endif
 		res = dir_next(dp, 0);	/* Next entry */
 	} while (res == FR_OK);
@@ -2456,6 +2761,382 @@ static FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 
 
 
+#if FF_FS_EXFAT
+static int xdir_match (	/* 1:matched, 0:not matched */
+	FATFS* fs			/* Filesystem object with the entry block in the dirbuf and the name in the lfnbuf */
+)
+{
+	BYTE nc;
+	UINT di, ni;
+
+
+#if FF_MAX_LFN < 255
+	if (fs->dirbuf[XDIR_NumName] > FF_MAX_LFN) return 0;	/* Skip comparison if inaccessible object name */
+#endif
+	for (nc = fs->dirbuf[XDIR_NumName], di = SZDIRE * 2, ni = 0; nc; nc--, di += 2, ni++) {	/* Compare the name */
+		if ((di % SZDIRE) == 0) di += 2;
+		if (ff_wtoupper(ld_word(fs->dirbuf + di)) != ff_wtoupper(fs->lfnbuf[ni])) break;
+	}
+	return nc == 0 && !fs->lfnbuf[ni];
+}
+#endif
+
+
+
+#if FF_DIR_INDEX
+/*-----------------------------------------------------------------------*/
+/* Directory handling - Directory index                                  */
+/*-----------------------------------------------------------------------*/
+
+static WORD sfn_hash (	/* Hash of the SFN */
+	const BYTE* sfn		/* SFN in the directory entry format */
+)
+{
+	WORD h = 0;
+	UINT i;
+
+	for (i = 0; i < 11; i++) h = (WORD)(h * 31 + sfn[i]);
+	return h;
+}
+
+
+#if FF_USE_LFN
+static WORD lfn_chr_hash (	/* Hash of an LFN character, the LFN hash is the sum of them to not depend on the order of the LFN entries */
+	WCHAR wc,			/* Character */
+	UINT i				/* Index of the character in the LFN */
+)
+{
+	DWORD h = (DWORD)ff_wtoupper(wc) << 16 | i;
+
+	h ^= h >> 16; h *= 0x7FEB352D;	/* Mix the bits, the sum of the linear terms would collide for the permuted names */
+	h ^= h >> 15; h *= 0x846CA68B;
+	return (WORD)(h ^ h >> 16);
+}
+
+
+static WORD lfn_hash (	/* Hash of the LFN (1..0xFFFF) */
+	const WCHAR* lfn	/* LFN */
+)
+{
+	WORD h = 0;
+	UINT i;
+
+	for (i = 0; lfn[i]; i++) h += lfn_chr_hash(lfn[i], i);
+	return h ? h : 1;	/* 0 is reserved for no LFN */
+}
+#endif
+
+
+static DIRIDX* dir_index_get (	/* Pointer to the index of the directory, 0:not indexed */
+	FATFS* fs,			/* Filesystem object */
+	DWORD sclust		/* Directory start cluster */
+)
+{
+	UINT i;
+
+	for (i = 0; i < FF_DIR_INDEX_DIRS; i++) {
+		if (fs->didx[i].stat != 0 && fs->didx[i].sclust == sclust) return &fs->didx[i];
+	}
+	return 0;
+}
+
+
+static void dir_index_drop (	/* Discard the directory index and compact the item pool */
+	FATFS* fs,			/* Filesystem object */
+	DIRIDX* di			/* Index to be discarded */
+)
+{
+	UINT i;
+
+	if (di->stat == 1) {
+		memmove(fs->ditem + di->top, fs->ditem + di->top + di->size, (fs->di_used - di->top - di->size) * sizeof (DIRIDXITEM));
+		fs->di_used -= di->size;
+		for (i = 0; i < FF_DIR_INDEX_DIRS; i++) {
+			if (fs->didx[i].stat == 1 && fs->didx[i].top > di->top) fs->didx[i].top -= di->size;
+		}
+	}
+	di->stat = 0;
+}
+
+
+static DIRIDX* dir_index_lru (	/* Least recently searched index except the one to keep, 0:no index */
+	FATFS* fs,			/* Filesystem object */
+	DIRIDX* keep		/* Index to keep */
+)
+{
+	DIRIDX *di = 0;
+	UINT i;
+
+	for (i = 0; i < FF_DIR_INDEX_DIRS; i++) {
+		if (fs->didx[i].stat != 0 && &fs->didx[i] != keep && (!di || fs->didx[i].stamp < di->stamp)) di = &fs->didx[i];
+	}
+	return di;
+}
+
+
+static FRESULT dir_index_build (	/* FR_OK:built, FR_NOT_ENOUGH_CORE:no room in the item pool, !=0:error */
+	DIR* dp,			/* Directory object */
+	DIRIDX* di			/* Index to be built at the top of free items */
+)
+{
+	FRESULT res;
+	FATFS *fs = dp->obj.fs;
+	DIRIDXITEM *item;
+	BYTE c, a;
+#if FF_USE_LFN
+	BYTE ord = 0xFF, sum = 0xFF;
+	DWORD ofs = 0;
+	WORD lh = 0;
+	WCHAR wc;
+	UINT i;
+#endif
+
+	di->top = fs->di_used; di->nitem = 0;
+	res = dir_sdi(dp, 0);
+#if FF_FS_EXFAT
+	if (fs->fs_type == FS_EXFAT) {	/* On the exFAT volume, the entry block has the name hash */
+		while (res == FR_OK && (res = DIR_READ_FILE(dp)) == FR_OK) {
+			if (di->top + di->nitem >= FF_DIR_INDEX) {
+				res = FR_NOT_ENOUGH_CORE; break;
+			}
+			item = &fs->ditem[di->top + di->nitem++];
+			item->sh = ld_word(fs->dirbuf + XDIR_NameHash);
+			item->ofs = dp->blk_ofs; item->lh = 0;
+		}
+	} else
+#endif
+	while (res == FR_OK) {
+		res = move_window(fs, dp->sect);
+		if (res != FR_OK) break;
+		c = dp->dir[DIR_Name];
+		if (c == 0) break;	/* Reached to end of table */
+		a = dp->dir[DIR_Attr] & AM_MASK;
+#if FF_USE_LFN		/* LFN configuration */
+		if (c == DDEM || ((a & AM_VOL) && a != AM_LFN)) {	/* An entry without valid data */
+			ord = 0xFF;
+		} else if (a == AM_LFN) {	/* An LFN entry, sum the hash of its characters */
+			if (c & LLEF) {		/* Is it start of LFN sequence? */
+				sum = dp->dir[LDIR_Chksum];
+				c &= (BYTE)~LLEF; ord = c;
+				ofs = dp->dptr; lh = 0;
+			}
+			if (c == ord && c != 0 && sum == dp->dir[LDIR_Chksum]) {
+				for (i = 0; i < 13 && (wc = ld_word(dp->dir + LfnOfs[i])) != 0; i++) {
+					lh += lfn_chr_hash(wc, (c - 1) * 13 + i);
+				}
+				ord--;
+			} else {
+				ord = 0xFF;
+			}
+		} else
+#else
+		if (c != DDEM && !(a & AM_VOL))
+#endif
+		{	/* An SFN entry */
+			if (di->top + di->nitem >= FF_DIR_INDEX) {
+				res = FR_NOT_ENOUGH_CORE; break;
+			}
+			item = &fs->ditem[di->top + di->nitem++];
+			item->sh = sfn_hash(dp->dir);
+			item->ofs = dp->dptr; item->lh = 0;
+#if FF_USE_LFN
+			if (ord == 0 && sum == sum_sfn(dp->dir)) {	/* The SFN has an LFN */
+				item->ofs = ofs; item->lh = lh ? lh : 1;
+			}
+			ord = 0xFF;
+#endif
+		}
+		res = dir_next(dp, 0);	/* Next entry */
+	}
+	if (res == FR_NO_FILE) res = FR_OK;	/* Reached to end of the directory */
+	if (res == FR_OK) {		/* Reserve the items for the new entries */
+		di->size = di->nitem + di->nitem / 8 + 8;
+		if (di->top + di->size > FF_DIR_INDEX) di->size = FF_DIR_INDEX - di->top;
+		fs->di_used = di->top + di->size;
+	}
+	return res;
+}
+
+
+static int dir_index_find (	/* 0:The directory is not indexed, 1:Searched by the index with the result in *rp */
+	DIR* dp,			/* Pointer to the directory object with the file name */
+	FRESULT* rp			/* Pointer to return the result, FR_OK:found, FR_NO_FILE:not found, others:error */
+)
+{
+	FRESULT res;
+	FATFS *fs = dp->obj.fs;
+	DIRIDX *di, *lru;
+	DIRIDXITEM *item;
+	WORD sh;
+#if FF_USE_LFN
+	WORD lh = 0;
+#endif
+	UINT i;
+
+	di = dir_index_get(fs, dp->obj.sclust);
+	if (!di) {		/* Index the directory */
+		for (i = 0; i < FF_DIR_INDEX_DIRS && fs->didx[i].stat != 0; i++) ;	/* Find a free index */
+		if (i < FF_DIR_INDEX_DIRS) {
+			di = &fs->didx[i];
+		} else {
+			di = dir_index_lru(fs, 0);
+			dir_index_drop(fs, di);
+		}
+		di->sclust = dp->obj.sclust;
+		for (;;) {
+			res = dir_index_build(dp, di);
+			if (res != FR_NOT_ENOUGH_CORE) break;
+			lru = dir_index_lru(fs, di);	/* Discard the other index and try again */
+			if (!lru) break;
+			dir_index_drop(fs, lru);
+		}
+		if (res != FR_OK && res != FR_NOT_ENOUGH_CORE) {	/* Hard error? */
+			*rp = res;
+			return 1;
+		}
+		di->stat = (res == FR_OK) ? 1 : 2;
+	}
+	di->stamp = ++fs->di_stamp;
+	if (di->stat != 1) return 0;
+
+#if FF_FS_EXFAT
+	if (fs->fs_type == FS_EXFAT) {	/* On the exFAT volume, match the name hash of the entry block */
+		sh = xname_sum(fs->lfnbuf);
+		for (i = 0; i < di->nitem; i++) {
+			item = &fs->ditem[di->top + i];
+			if (item->sh != sh) continue;
+			res = dir_sdi(dp, item->ofs);
+			if (res == FR_OK) res = DIR_READ_FILE(dp);
+			if (res == FR_NO_FILE) continue;
+			if (res != FR_OK || xdir_match(fs)) {
+				*rp = res;
+				return 1;
+			}
+		}
+		*rp = FR_NO_FILE;
+		return 1;
+	}
+#endif
+	sh = sfn_hash(dp->fn);
+#if FF_USE_LFN
+	if (!(dp->fn[NSFLAG] & NS_NOLFN)) lh = lfn_hash(fs->lfnbuf);
+#endif
+	for (i = 0; i < di->nitem; i++) {	/* Match the entries of the hash */
+		item = &fs->ditem[di->top + i];
+#if FF_USE_LFN
+		if (!((!(dp->fn[NSFLAG] & NS_LOSS) && item->sh == sh) || (lh && item->lh == lh))) continue;
+#else
+		if (item->sh != sh) continue;
+#endif
+		res = dir_sdi(dp, item->ofs);
+		if (res == FR_OK) res = dir_match(dp, 1);
+		if (res != FR_NO_FILE) {
+			*rp = res;
+			return 1;
+		}
+	}
+	*rp = FR_NO_FILE;
+	return 1;
+}
+
+
+#if !FF_FS_READONLY
+static void dir_index_add (	/* Add the registered object to the directory index */
+	DIR* dp				/* Directory object at the SFN entry of the object */
+)
+{
+	FATFS *fs = dp->obj.fs;
+	DIRIDX *di;
+	DIRIDXITEM *item;
+
+	di = dir_index_get(fs, dp->obj.sclust);
+	if (!di || di->stat != 1) return;
+	if (di->nitem == di->size) {	/* No reserved item, the index is built again at the next search */
+		dir_index_drop(fs, di);
+		return;
+	}
+	item = &fs->ditem[di->top + di->nitem++];
+#if FF_FS_EXFAT
+	if (fs->fs_type == FS_EXFAT) {	/* The name hash is in the created entry block */
+		item->sh = ld_word(fs->dirbuf + XDIR_NameHash);
+		item->ofs = dp->blk_ofs; item->lh = 0;
+		return;
+	}
+#endif
+	item->sh = sfn_hash(dp->fn);
+	item->ofs = dp->dptr; item->lh = 0;
+#if FF_USE_LFN
+	if (dp->blk_ofs != 0xFFFFFFFF) {
+		item->ofs = dp->blk_ofs; item->lh = lfn_hash(fs->lfnbuf);
+	}
+#endif
+}
+
+
+static void dir_index_remove (	/* Remove the object from the directory index */
+	DIR* dp				/* Directory object pointing the entry to be removed */
+)
+{
+	FATFS *fs = dp->obj.fs;
+	DIRIDX *di;
+	DWORD ofs = dp->dptr;
+	UINT i;
+
+	di = dir_index_get(fs, dp->obj.sclust);
+	if (!di || di->stat != 1) return;
+#if FF_USE_LFN
+	if (dp->blk_ofs != 0xFFFFFFFF) ofs = dp->blk_ofs;
+#endif
+	for (i = 0; i < di->nitem; i++) {
+		if (fs->ditem[di->top + i].ofs == ofs) {
+			fs->ditem[di->top + i] = fs->ditem[di->top + --di->nitem];
+			break;
+		}
+	}
+}
+#endif	/* !FF_FS_READONLY */
+
+#endif	/* FF_DIR_INDEX */
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Directory handling - Find an object in the directory                  */
+/*-----------------------------------------------------------------------*/
+
+static FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
+	DIR* dp					/* Pointer to the directory object with the file name */
+)
+{
+	FRESULT res;
+#if FF_FS_EXFAT
+	FATFS *fs = dp->obj.fs;
+#endif
+
+	res = dir_sdi(dp, 0);			/* Rewind directory object */
+	if (res != FR_OK) return res;
+#if FF_DIR_INDEX
+	if (dir_index_find(dp, &res)) return res;	/* Search by the directory index if available */
+	res = dir_sdi(dp, 0);			/* Rewind directory object for the full scan */
+	if (res != FR_OK) return res;
+#endif
+#if FF_FS_EXFAT
+	if (fs->fs_type == FS_EXFAT) {	/* On the exFAT volume */
+		WORD hash = xname_sum(fs->lfnbuf);		/* Hash value of the name to find */
+
+		while ((res = DIR_READ_FILE(dp)) == FR_OK) {	/* Read an item */
+			if (ld_word(fs->dirbuf + XDIR_NameHash) != hash) continue;	/* Skip comparison if hash mismatched */
+			if (xdir_match(fs)) break;	/* Name matched? */
+		}
+		return res;
+	}
+#endif
+	/* On the FAT/FAT32 volume */
+	return dir_match(dp, 0);
+}
+
+
+
 
 #if !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
@@ -2504,6 +3185,9 @@ static FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too
 		}
 
 		create_xdir(fs->dirbuf, fs->lfnbuf);	/* Create on-memory directory block to be written later */
+#if FF_DIR_INDEX
+		dir_index_add(dp);
+#endif
 		return FR_OK;
 	}
 #endif
@@ -2524,6 +3208,9 @@ static FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too
 	/* Create an SFN with/without LFNs. */
 	n_ent = (sn[NSFLAG] & NS_LFN) ? (len + 12) / 13 + 1 : 1;	/* Number of entries to allocate */
 	res = dir_alloc(dp, n_ent);		/* Allocate entries */
+#if FF_DIR_INDEX
+	if (res == FR_OK) dp->blk_ofs = (n_ent > 1) ? dp->dptr - (n_ent - 1) * SZDIRE : 0xFFFFFFFF;	/* Entry block offset for the directory index */
+#endif
 	if (res == FR_OK && --n_ent) {	/* Set LFN entry if needed */
 		res = dir_sdi(dp, dp->dptr - n_ent * SZDIRE);
 		if (res == FR_OK) {
@@ -2553,6 +3240,9 @@ static FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too
 			dp->dir[DIR_NTres] = dp->fn[NSFLAG] & (NS_BODY | NS_EXT);	/* Put NT flag */
 #endif
 			fs->wflag = 1;
+#if FF_DIR_INDEX
+			dir_index_add(dp);
+#endif
 		}
 	}
 
@@ -2576,6 +3266,12 @@ static FRESULT dir_remove (	/* FR_OK:Succeeded, FR_DISK_ERR:A disk error */
 	FATFS *fs = dp->obj.fs;
 #if FF_USE_LFN		/* LFN configuration */
 	DWORD last = dp->dptr;
+#endif
+
+#if FF_DIR_INDEX
+	dir_index_remove(dp);
+#endif
+#if FF_USE_LFN		/* LFN configuration */
 
 	res = (dp->blk_ofs == 0xFFFFFFFF) ? FR_OK : dir_sdi(dp, dp->blk_ofs);	/* Goto top of the entry block if LFN is exist */
 	if (res == FR_OK) {
@@ -3588,6 +4284,21 @@ static FRESULT mount_volume (	/* FR_OK(0): successful, !=0: an error occurred */
 
 	fs->fs_type = (BYTE)fmt;/* FAT sub-type (the filesystem object gets valid) */
 	fs->id = ++Fsid;		/* Volume mount ID */
+#if FF_FS_FREEMAP && !FF_FS_READONLY
+	fs->fm_ncl = 0;			/* Free cluster summary is not valid */
+#endif
+#if FF_FAT_CACHE
+	memset(fs->fc_sect, 0xFF, sizeof fs->fc_sect);	/* Invalidate the FAT cache */
+	memset(fs->fc_dirty, 0, sizeof fs->fc_dirty);
+	fs->fc_next = 0;
+#endif
+#if FF_DIR_INDEX
+	memset(fs->didx, 0, sizeof fs->didx);	/* No directory is indexed */
+	fs->di_used = 0;
+#endif
+#if FF_FS_BUFPOOL
+	memset(fs->bp_owner, 0, sizeof fs->bp_owner);	/* All pool buffers are blank */
+#endif
 #if FF_USE_LFN == 1
 	fs->lfnbuf = LfnBuf;	/* Static LFN working buffer */
 #if FF_FS_EXFAT
@@ -3865,7 +4576,9 @@ FRESULT f_open (
 			fp->sect = 0;		/* Invalidate current data sector */
 			fp->fptr = 0;		/* Set file pointer top of the file */
 #if !FF_FS_READONLY
-#if !FF_FS_TINY
+#if FF_FS_BUFPOOL
+			release_fbuf(fp);	/* No sector buffer is leased, also by the file object opened again without close */
+#elif !FF_FS_TINY
 			memset(fp->buf, 0, sizeof fp->buf);	/* Clear sector buffer */
 #endif
 			if ((mode & FA_SEEKEND) && fp->obj.objsize > 0) {	/* Seek to end of file if FA_OPEN_APPEND is specified */
@@ -3885,12 +4598,16 @@ FRESULT f_open (
 					} else {
 						fp->sect = sc + (DWORD)(ofs / SS(fs));
 #if !FF_FS_TINY
-						if (disk_read(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) res = FR_DISK_ERR;
+						res = lease_fbuf(fp, 0);
+						if (res == FR_OK && disk_read(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) res = FR_DISK_ERR;
 #endif
 					}
 				}
 #if FF_FS_LOCK
 				if (res != FR_OK) dec_share(fp->obj.lockid); /* Decrement file open counter if seek failed */
+#endif
+#if FF_FS_BUFPOOL
+				if (res != FR_OK) release_fbuf(fp);
 #endif
 			}
 #endif
@@ -3979,6 +4696,7 @@ FRESULT f_read (
 			}
 #if !FF_FS_TINY
 			if (fp->sect != sect) {			/* Load data sector if not in cache */
+				if (lease_fbuf(fp, 0) != FR_OK) ABORT(fs, FR_DISK_ERR);
 #if !FF_FS_READONLY
 				if (fp->flag & FA_DIRTY) {		/* Write-back dirty sector cache */
 					if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) ABORT(fs, FR_DISK_ERR);
@@ -3996,6 +4714,7 @@ FRESULT f_read (
 		if (move_window(fs, fp->sect) != FR_OK) ABORT(fs, FR_DISK_ERR);	/* Move sector window */
 		memcpy(rbuff, fs->win + fp->fptr % SS(fs), rcnt);	/* Extract partial sector */
 #else
+		if (lease_fbuf(fp, 1) != FR_OK) ABORT(fs, FR_DISK_ERR);
 		memcpy(rbuff, fp->buf + fp->fptr % SS(fs), rcnt);	/* Extract partial sector */
 #endif
 	}
@@ -4086,6 +4805,7 @@ FRESULT f_write (
 				}
 #else
 				if (fp->sect - sect < cc) { /* Refill sector cache if it gets invalidated by the direct write */
+					if (lease_fbuf(fp, 0) != FR_OK) ABORT(fs, FR_DISK_ERR);
 					memcpy(fp->buf, wbuff + ((fp->sect - sect) * SS(fs)), SS(fs));
 					fp->flag &= (BYTE)~FA_DIRTY;
 				}
@@ -4100,6 +4820,7 @@ FRESULT f_write (
 				fs->winsect = sect;
 			}
 #else
+			if (fp->sect != sect && lease_fbuf(fp, 0) != FR_OK) ABORT(fs, FR_DISK_ERR);
 			if (fp->sect != sect && 		/* Fill sector cache with file data */
 				fp->fptr < fp->obj.objsize &&
 				disk_read(fs->pdrv, fp->buf, sect, 1) != RES_OK) {
@@ -4115,6 +4836,7 @@ FRESULT f_write (
 		memcpy(fs->win + fp->fptr % SS(fs), wbuff, wcnt);	/* Fit data to the sector */
 		fs->wflag = 1;
 #else
+		if (lease_fbuf(fp, 1) != FR_OK) ABORT(fs, FR_DISK_ERR);
 		memcpy(fp->buf + fp->fptr % SS(fs), wbuff, wcnt);	/* Fit data to the sector */
 		fp->flag |= FA_DIRTY;
 #endif
@@ -4227,6 +4949,9 @@ FRESULT f_close (
 	{
 		res = validate(&fp->obj, &fs);	/* Lock volume */
 		if (res == FR_OK) {
+#if FF_FS_BUFPOOL
+			release_fbuf(fp);	/* Return the sector buffer to the pool */
+#endif
 #if FF_FS_LOCK
 			res = dec_share(fp->obj.lockid);		/* Decrement file open counter */
 			if (res == FR_OK) fp->obj.fs = 0;	/* Invalidate file object */
@@ -4492,6 +5217,7 @@ FRESULT f_lseek (
 				dsc += (DWORD)((ofs - 1) / SS(fs)) & (fs->csize - 1);
 				if (fp->fptr % SS(fs) && dsc != fp->sect) {	/* Refill sector cache if needed */
 #if !FF_FS_TINY
+					if (lease_fbuf(fp, 0) != FR_OK) ABORT(fs, FR_DISK_ERR);
 #if !FF_FS_READONLY
 					if (fp->flag & FA_DIRTY) {		/* Write-back dirty sector cache */
 						if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) ABORT(fs, FR_DISK_ERR);
@@ -4572,6 +5298,7 @@ FRESULT f_lseek (
 		}
 		if (fp->fptr % SS(fs) && nsect != fp->sect) {	/* Fill sector cache if needed */
 #if !FF_FS_TINY
+			if (lease_fbuf(fp, 0) != FR_OK) ABORT(fs, FR_DISK_ERR);
 #if !FF_FS_READONLY
 			if (fp->flag & FA_DIRTY) {			/* Write-back dirty sector cache */
 				if (disk_write(fs->pdrv, fp->buf, fp->sect, 1) != RES_OK) ABORT(fs, FR_DISK_ERR);
@@ -4821,10 +5548,6 @@ FRESULT f_getfree (
 {
 	FRESULT res;
 	FATFS *fs;
-	DWORD nfree, clst, stat;
-	LBA_t sect;
-	UINT i;
-	FFOBJID obj;
 
 
 	/* Get logical drive */
@@ -4836,66 +5559,7 @@ FRESULT f_getfree (
 			*nclst = fs->free_clst;
 		} else {
 			/* Scan FAT to obtain number of free clusters */
-			nfree = 0;
-			if (fs->fs_type == FS_FAT12) {	/* FAT12: Scan bit field FAT entries */
-				clst = 2; obj.fs = fs;
-				do {
-					stat = get_fat(&obj, clst);
-					if (stat == 0xFFFFFFFF) {
-						res = FR_DISK_ERR; break;
-					}
-					if (stat == 1) {
-						res = FR_INT_ERR; break;
-					}
-					if (stat == 0) nfree++;
-				} while (++clst < fs->n_fatent);
-			} else {
-#if FF_FS_EXFAT
-				if (fs->fs_type == FS_EXFAT) {	/* exFAT: Scan allocation bitmap */
-					BYTE bm;
-					UINT b;
-
-					clst = fs->n_fatent - 2;	/* Number of clusters */
-					sect = fs->bitbase;			/* Bitmap sector */
-					i = 0;						/* Offset in the sector */
-					do {	/* Counts numbuer of bits with zero in the bitmap */
-						if (i == 0) {	/* New sector? */
-							res = move_window(fs, sect++);
-							if (res != FR_OK) break;
-						}
-						for (b = 8, bm = ~fs->win[i]; b && clst; b--, clst--) {
-							nfree += bm & 1;
-							bm >>= 1;
-						}
-						i = (i + 1) % SS(fs);
-					} while (clst);
-				} else
-#endif
-				{	/* FAT16/32: Scan WORD/DWORD FAT entries */
-					clst = fs->n_fatent;	/* Number of entries */
-					sect = fs->fatbase;		/* Top of the FAT */
-					i = 0;					/* Offset in the sector */
-					do {	/* Counts numbuer of entries with zero in the FAT */
-						if (i == 0) {	/* New sector? */
-							res = move_window(fs, sect++);
-							if (res != FR_OK) break;
-						}
-						if (fs->fs_type == FS_FAT16) {
-							if (ld_word(fs->win + i) == 0) nfree++;
-							i += 2;
-						} else {
-							if ((ld_dword(fs->win + i) & 0x0FFFFFFF) == 0) nfree++;
-							i += 4;
-						}
-						i %= SS(fs);
-					} while (--clst);
-				}
-			}
-			if (res == FR_OK) {		/* Update parameters if succeeded */
-				*nclst = nfree;			/* Return the free clusters */
-				fs->free_clst = nfree;	/* Now free_clst is valid */
-				fs->fsi_flag |= 1;		/* FAT32: FSInfo is to be updated */
-			}
+			res = scan_fat(fs, nclst);
 		}
 	}
 
@@ -5031,6 +5695,11 @@ FRESULT f_unlink (
 			if (res == FR_OK) {
 				res = dir_remove(&dj);			/* Remove the directory entry */
 				if (res == FR_OK && dclst != 0) {	/* Remove the cluster chain if exist */
+#if FF_DIR_INDEX
+					DIRIDX *di = dir_index_get(fs, dclst);	/* Discard the index of the removed directory */
+
+					if (di) dir_index_drop(fs, di);
+#endif
 #if FF_FS_EXFAT
 					res = remove_chain(&obj, dclst, 0);
 #else
@@ -5600,8 +6269,28 @@ FRESULT f_expand (
 	} else
 #endif
 	{
+#if FF_FS_FREEMAP
+		if (fs->fm_ncl == 0) {	/* Build the free cluster summary at the first cluster search */
+			res = scan_fat(fs, &n);
+			if (res != FR_OK) LEAVE_FF(fs, res);
+		}
+#endif
 		scl = clst = stcl; ncl = 0;
 		for (;;) {	/* Find a contiguous cluster block */
+#if FF_FS_FREEMAP
+			if (fs->fm_ncl != 0 && fs->fmap[clst / fs->fm_ncl] == 0) {	/* No free cluster in this block? */
+				n = (clst / fs->fm_ncl + 1) * fs->fm_ncl;	/* Top of the next block */
+				if (stcl > clst && stcl < n) {	/* No contiguous cluster? */
+					res = FR_DENIED; break;
+				}
+				clst = (n >= fs->n_fatent) ? 2 : n;
+				scl = clst; ncl = 0;
+				if (clst == stcl) {		/* No contiguous cluster? */
+					res = FR_DENIED; break;
+				}
+				continue;
+			}
+#endif
 			n = get_fat(&fp->obj, clst);
 			if (++clst >= fs->n_fatent) clst = 2;
 			if (n == 1) {
@@ -5624,6 +6313,9 @@ FRESULT f_expand (
 				for (clst = scl, n = tcl; n; clst++, n--) {	/* Create a cluster chain on the FAT */
 					res = put_fat(fs, clst, (n == 1) ? 0xFFFFFFFF : clst + 1);
 					if (res != FR_OK) break;
+#if FF_FS_FREEMAP
+					change_fmap(fs, clst, (DWORD)-1);
+#endif
 					lclst = clst;
 				}
 			} else {		/* Set it as suggested point for next allocation */
@@ -5649,6 +6341,35 @@ FRESULT f_expand (
 	LEAVE_FF(fs, res);
 }
 
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Set the File Size without Touching the Allocation                     */
+/*-----------------------------------------------------------------------*/
+/* The size is written to the directory entry by the next f_sync/f_close */
+/* and is not checked against the cluster chain of the file.             */
+
+FRESULT f_setsize (
+	FIL* fp,		/* Pointer to the file object */
+	FSIZE_t fsz		/* New file size */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+
+
+	res = validate(&fp->obj, &fs);	/* Check validity of the file object */
+	if (res == FR_OK) res = (FRESULT)fp->err;
+	if (res == FR_OK && !(fp->flag & FA_WRITE)) res = FR_DENIED;	/* Check access mode */
+	if (res == FR_OK) {
+		fp->obj.objsize = fsz;
+		fp->flag |= FA_MODIFIED;
+	}
+
+	LEAVE_FF(fs, res);
+}
+
 #endif /* FF_USE_EXPAND && !FF_FS_READONLY */
 
 
@@ -5700,6 +6421,7 @@ FRESULT f_forward (
 		if (move_window(fs, sect) != FR_OK) ABORT(fs, FR_DISK_ERR);	/* Move sector window to the file data */
 		dbuf = fs->win;
 #else
+		if (lease_fbuf(fp, fp->sect == sect) != FR_OK) ABORT(fs, FR_DISK_ERR);	/* Reload the sector if the buffer has been reclaimed */
 		if (fp->sect != sect) {		/* Fill sector cache with file data */
 #if !FF_FS_READONLY
 			if (fp->flag & FA_DIRTY) {		/* Write-back dirty sector cache */
@@ -5740,7 +6462,8 @@ static FRESULT create_partition (
 	BYTE drv,			/* Physical drive number */
 	const LBA_t plst[],	/* Partition list */
 	BYTE sys,			/* System ID for each partition (for only MBR) */
-	BYTE *buf			/* Working buffer for a sector */
+	BYTE *buf,			/* Working buffer for a sector */
+	DWORD align			/* Alignment of the first partition in MBR [sector] (1:Track boundary) */
 )
 {
 	UINT i, cy;
@@ -5843,7 +6566,7 @@ static FRESULT create_partition (
 
 		memset(buf, 0, FF_MAX_SS);		/* Clear MBR */
 		pte = buf + MBR_Table;	/* Partition table in the MBR */
-		for (i = 0, nxt_alloc32 = n_sc; i < 4 && nxt_alloc32 != 0 && nxt_alloc32 < sz_drv32; i++, nxt_alloc32 += sz_part32) {
+		for (i = 0, nxt_alloc32 = (n_sc + align - 1) / align * align; i < 4 && nxt_alloc32 != 0 && nxt_alloc32 < sz_drv32; i++, nxt_alloc32 += sz_part32) {
 			sz_part32 = (DWORD)plst[i];	/* Get partition size */
 			if (sz_part32 <= 100) sz_part32 = (sz_part32 == 100) ? sz_drv32 : sz_drv32 / 100 * sz_part32;	/* Size in percentage? */
 			if (nxt_alloc32 + sz_part32 > sz_drv32 || nxt_alloc32 + sz_part32 < nxt_alloc32) sz_part32 = sz_drv32 - nxt_alloc32;	/* Clip at drive size */
@@ -5990,8 +6713,8 @@ FRESULT f_mkfs (
 			} else
 #endif
 			{	/* Partitioning is in MBR */
-				if (sz_vol > N_SEC_TRACK) {
-					b_vol = N_SEC_TRACK; sz_vol -= b_vol;	/* Estimated partition offset and size */
+				if (sz_vol > (N_SEC_TRACK + sz_blk - 1) / sz_blk * sz_blk) {
+					b_vol = (N_SEC_TRACK + sz_blk - 1) / sz_blk * sz_blk; sz_vol -= b_vol;	/* Partition offset (aligned to the erase block) and size */
 				}
 			}
 		}
@@ -6038,7 +6761,7 @@ FRESULT f_mkfs (
 			if (sz_vol >= 0x80000) sz_au = 64;		/* >= 512Ks */
 			if (sz_vol >= 0x4000000) sz_au = 256;	/* >= 64Ms */
 		}
-		b_fat = b_vol + 32;										/* FAT start at offset 32 */
+		b_fat = (b_vol + 32 + sz_blk - 1) & ~((LBA_t)sz_blk - 1);	/* FAT start at offset 32 or at the next erase block boundary */
 		sz_fat = (DWORD)((sz_vol / sz_au + 2) * 4 + ss - 1) / ss;	/* Number of FAT sectors */
 		b_data = (b_fat + sz_fat + sz_blk - 1) & ~((LBA_t)sz_blk - 1);	/* Align data area to the erase block boundary */
 		if (b_data - b_vol >= sz_vol / 2) LEAVE_MKFS(FR_MKFS_ABORTED);	/* Too small volume? */
@@ -6213,18 +6936,16 @@ FRESULT f_mkfs (
 				sz_dir = (DWORD)n_root * SZDIRE / ss;	/* Root dir size [sector] */
 			}
 			b_fat = b_vol + sz_rsv;						/* FAT base */
-			b_data = b_fat + sz_fat * n_fat + sz_dir;	/* Data base */
 
-			/* Align data area to erase block boundary (for flash memory media) */
+			/* Align FAT and data area to erase block boundary (for flash memory media) */
+			n = (DWORD)(((b_fat + sz_blk - 1) & ~(sz_blk - 1)) - b_fat);	/* Sectors to next nearest from current FAT base */
+			sz_rsv += n; b_fat += n;	/* Move FAT */
+			b_data = b_fat + sz_fat * n_fat + sz_dir;	/* Data base */
 			n = (DWORD)(((b_data + sz_blk - 1) & ~(sz_blk - 1)) - b_data);	/* Sectors to next nearest from current data base */
-			if (fsty == FS_FAT32) {		/* FAT32: Move FAT */
-				sz_rsv += n; b_fat += n;
-			} else {					/* FAT: Expand FAT */
-				if (n % n_fat) {	/* Adjust fractional error if needed */
-					n--; sz_rsv++; b_fat++;
-				}
-				sz_fat += n / n_fat;
+			if (n % n_fat) {	/* Adjust fractional error if needed */
+				n--; sz_rsv++; b_fat++;
 			}
+			sz_fat += n / n_fat;	/* Expand FAT */
 
 			/* Determine number of clusters and final check of validity of the FAT sub-type */
 			if (sz_vol < b_data + pau * 16 - b_vol) LEAVE_MKFS(FR_MKFS_ABORTED);	/* Too small volume? */
@@ -6365,7 +7086,7 @@ FRESULT f_mkfs (
 	} else {								/* Volume as a new single partition */
 		if (!(fsopt & FM_SFD)) {			/* Create partition table if not in SFD format */
 			lba[0] = sz_vol; lba[1] = 0;
-			res = create_partition(pdrv, lba, sys, buf);
+			res = create_partition(pdrv, lba, sys, buf, sz_blk);
 			if (res != FR_OK) LEAVE_MKFS(res);
 		}
 	}
@@ -6404,7 +7125,7 @@ FRESULT f_fdisk (
 #endif
 	if (!buf) return FR_NOT_ENOUGH_CORE;
 
-	res = create_partition(pdrv, ptbl, 0x07, buf);	/* Create partitions (system ID is temporary setting and determined by f_mkfs) */
+	res = create_partition(pdrv, ptbl, 0x07, buf, 1);	/* Create partitions (system ID is temporary setting and determined by f_mkfs) */
 
 	LEAVE_MKFS(res);
 }
@@ -127,6 +127,27 @@ extern const char* VolumeStr[FF_VOLUMES];	/* User defied volume ID */
 
 
 
+#if FF_DIR_INDEX
+/* Directory index item (DIRIDXITEM) and indexed directory (DIRIDX) */
+
+typedef struct {
+	DWORD	ofs;			/* Offset of the entry block in the directory */
+	WORD	sh;				/* Hash of the SFN */
+	WORD	lh;				/* Hash of the LFN (0:no LFN) */
+} DIRIDXITEM;
+
+typedef struct {
+	BYTE	stat;			/* Index status (0:not used, 1:valid, 2:too many entries to index) */
+	DWORD	sclust;			/* Directory start cluster (0:root directory of FAT12/16) */
+	DWORD	top;			/* First item of the index in the item pool */
+	DWORD	nitem;			/* Number of items in use */
+	DWORD	size;			/* Number of items reserved */
+	DWORD	stamp;			/* Last search stamp */
+} DIRIDX;
+#endif
+
+
+
 /* Filesystem object structure (FATFS) */
 
 typedef struct {
@@ -151,6 +172,10 @@ typedef struct {
 #if !FF_FS_READONLY
 	DWORD	last_clst;		/* Last allocated cluster */
 	DWORD	free_clst;		/* Number of free clusters */
+#if FF_FS_FREEMAP
+	DWORD	fm_ncl;			/* Clusters per free summary item (0:summary is not valid) */
+	DWORD	fmap[FF_FS_FREEMAP];	/* Number of free clusters in each cluster block */
+#endif
 #endif
 #if FF_FS_RPATH
 	DWORD	cdir;			/* Current directory start cluster (0:root) */
@@ -168,6 +193,24 @@ typedef struct {
 	LBA_t	database;		/* Data base sector */
 #if FF_FS_EXFAT
 	LBA_t	bitbase;		/* Allocation bitmap base sector */
+#endif
+#if FF_FAT_CACHE
+	BYTE	fc_next;		/* FAT cache slot to be loaded next */
+	BYTE	fc_dirty[FF_FAT_CACHE];	/* FAT cache slot status (1:dirty) */
+	LBA_t	fc_sect[FF_FAT_CACHE];	/* FAT sector in each FAT cache slot */
+	BYTE	fc_buf[FF_FAT_CACHE][FF_MAX_SS];	/* FAT sector cache */
+#endif
+#if FF_DIR_INDEX
+	DWORD	di_used;		/* Number of items in use in the item pool */
+	DWORD	di_stamp;		/* Search stamp counter */
+	DIRIDX	didx[FF_DIR_INDEX_DIRS];	/* Indexed directories */
+	DIRIDXITEM	ditem[FF_DIR_INDEX];	/* Directory index item pool */
+#endif
+#if FF_FS_BUFPOOL
+	DWORD	bp_stamp;		/* Buffer pool use stamp counter */
+	DWORD	bp_used[FF_FS_BUFPOOL];	/* Last use stamp of each pool buffer */
+	struct FIL_*	bp_owner[FF_FS_BUFPOOL];	/* File holding each pool buffer (0:blank) */
+	BYTE	bp_buf[FF_FS_BUFPOOL][FF_MAX_SS];	/* File data sector buffer pool */
 #endif
 	LBA_t	winsect;		/* Current sector appearing in the win[] */
 	BYTE	win[FF_MAX_SS];	/* Disk access window for Directory, FAT (and file data at tiny cfg) */
@@ -200,7 +243,7 @@ typedef struct {
 
 /* File object structure (FIL) */
 
-typedef struct {
+typedef struct FIL_ {
 	FFOBJID	obj;			/* Object identifier (must be the 1st member to detect invalid object pointer) */
 	BYTE	flag;			/* File status flags */
 	BYTE	err;			/* Abort flag (error code) */
@@ -214,7 +257,9 @@ typedef struct {
 #if FF_USE_FASTSEEK
 	DWORD*	cltbl;			/* Pointer to the cluster link map table (nulled on open, set by application) */
 #endif
-#if !FF_FS_TINY
+#if FF_FS_BUFPOOL
+	BYTE*	buf;			/* File data read/write window leased from the volume buffer pool (0:not leased) */
+#elif !FF_FS_TINY
 	BYTE	buf[FF_MAX_SS];	/* File private data read/write window */
 #endif
 } FIL;
@@ -262,7 +307,7 @@ typedef struct {
 typedef struct {
 	BYTE fmt;			/* Format option (FM_FAT, FM_FAT32, FM_EXFAT and FM_SFD) */
 	BYTE n_fat;			/* Number of FATs */
-	UINT align;			/* Data area alignment (sector) */
+	UINT align;			/* Partition, FAT and data area alignment (sector) */
 	UINT n_root;		/* Number of root directory entries */
 	DWORD au_size;		/* Cluster size (byte) */
 } MKFS_PARM;
@@ -327,6 +372,7 @@ FRESULT f_getlabel (const TCHAR* path, TCHAR* label, DWORD* vsn);	/* Get volume
 FRESULT f_setlabel (const TCHAR* label);							/* Set volume label */
 FRESULT f_forward (FIL* fp, UINT(*func)(const BYTE*,UINT), UINT btf, UINT* bf);	/* Forward data to the stream */
 FRESULT f_expand (FIL* fp, FSIZE_t fsz, BYTE opt);					/* Allocate a contiguous block to the file */
+FRESULT f_setsize (FIL* fp, FSIZE_t fsz);							/* Set the file size without the allocation */
 FRESULT f_mount (FATFS* fs, const TCHAR* path, BYTE opt);			/* Mount/Unmount a logical drive */
 FRESULT f_mkfs (const TCHAR* path, const MKFS_PARM* opt, void* work, UINT len);	/* Create a FAT volume */
 FRESULT f_fdisk (BYTE pdrv, const LBA_t ptbl[], void* work);		/* Divide a physical drive into some partitions */
@@ -30,16 +30,16 @@
 /  f_findnext(). (0:Disable, 1:Enable 2:Enable with matching altname[] too) */
 
 
-#define FF_USE_MKFS		0
+#define FF_USE_MKFS		1
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
-#define FF_USE_FASTSEEK	0
+#define FF_USE_FASTSEEK	1
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
-#define FF_USE_EXPAND	0
-/* This option switches f_expand function. (0:Disable or 1:Enable) */
+#define FF_USE_EXPAND	1
+/* This option switches f_expand and f_setsize functions. (0:Disable or 1:Enable) */
 
 
 #define FF_USE_CHMOD	0
@@ -113,7 +113,7 @@
 */
 
 
-#define FF_USE_LFN		0
+#define FF_USE_LFN		2
 #define FF_MAX_LFN		255
 /* The FF_USE_LFN switches the support for LFN (long file name).
 /
@@ -200,7 +200,11 @@
 /  harddisk, but a larger value may be required for on-board flash memory and some
 /  type of optical media. When FF_MAX_SS is larger than FF_MIN_SS, FatFs is configured
 /  for variable sector size mode and disk_ioctl() function needs to implement
-/  GET_SECTOR_SIZE command. */
+/  GET_SECTOR_SIZE command.
+/  The SD card driver uses FF_MAX_SS as the sector size and maps each sector onto
+/  FF_MAX_SS / 512 consecutive SD blocks. The 4096 bytes sectors reduce the FAT and
+/  window operations per data size, but the volume formatted with them can only be
+/  mounted by a host which uses the same logical sector size. */
 
 
 #define FF_LBA64		0
@@ -213,12 +217,19 @@
 /  f_fdisk function. 0x100000000 max. This option has no effect when FF_LBA64 == 0. */
 
 
-#define FF_USE_TRIM		0
+#define FF_USE_TRIM		1
 /* This option switches support for ATA-TRIM. (0:Disable or 1:Enable)
 /  To enable Trim function, also CTRL_TRIM command should be implemented to the
 /  disk_ioctl() function. */
 
 
+#define FF_USE_ZERO_FILL	1
+/* This option switches zero-filling of the directory cluster by the device.
+/  (0:Disable or 1:Enable) When enabled, FatFs tries CTRL_ZERO command of the
+/  disk_ioctl() function before writing the cluster with zeros, and writes it
+/  only when the command fails. */
+
+
 
 /*---------------------------------------------------------------------------/
 / System Configurations
@@ -231,7 +242,7 @@
 /  buffer in the filesystem object (FATFS) is used for the file data transfer. */
 
 
-#define FF_FS_EXFAT		0
+#define FF_FS_EXFAT		1
 /* This option switches support for exFAT filesystem. (0:Disable or 1:Enable)
 /  To enable exFAT, also LFN needs to be enabled. (FF_USE_LFN >= 1)
 /  Note that enabling exFAT discards ANSI C (C89) compatibility. */
@@ -263,7 +274,54 @@
 */
 
 
-#define FF_FS_LOCK		0
+#define FF_FAT_CACHE	2
+/* This option defines the number of FAT sectors cached in the filesystem object
+/  (0:Disable). When enabled, the FAT entries and the exFAT allocation bitmap are
+/  accessed through this cache instead of the sector window shared with the
+/  directory, so that the cluster chain handling does not evict the directory
+/  sector and vice versa. The dirty
+/  sectors are written back at the sync or at the eviction, and the adjacent ones
+/  with a multiple sector write to each FAT. Each sector takes FF_MAX_SS bytes in
+/  the filesystem object. It must be 0 or 2 to 255. */
+
+
+#define FF_FS_FREEMAP	256
+/* This option defines the number of items in the free cluster summary of the
+/  FAT/FAT32 volume (0:Disable). Each item holds the number of free clusters in a
+/  block of the FAT and takes 4 bytes in the filesystem object. The summary is
+/  built by the full FAT scan at the first cluster search after the volume mount,
+/  or by f_getfree() function if the FSINFO free cluster count is not valid. Once
+/  built, the summary is kept in sync with the allocations and the cluster search
+/  skips the full blocks. */
+
+
+#define FF_DIR_INDEX		256
+#define FF_DIR_INDEX_DIRS	4
+/* FF_DIR_INDEX defines the number of items in the directory index (0:Disable).
+/  Each item takes 8 bytes in the filesystem object and holds the name hash and
+/  the offset of a directory entry, the name hash of the entry block on the exFAT. The index of a directory is
+/  built at the first search in it and kept in sync with the object creation,
+/  rename and removal, so that the search reads only the matched entries.
+/  FF_DIR_INDEX_DIRS defines the number of the directories indexed at a time, the
+/  least recently searched index is discarded when a new directory is indexed or
+/  the items run out. A directory with more entries than FF_DIR_INDEX is searched
+/  by the full scan. The defaults of the caches in the filesystem object are sized
+/  for the 128 KB RAM of the STM32F411, it takes about 7 KB at FF_MAX_SS = 512. */
+
+
+#define FF_FS_BUFPOOL	4
+/* This option defines the number of sector buffers in the file data buffer pool
+/  of the filesystem object (0:Disable). When enabled, the file object (FIL) has no
+/  private sector buffer, it leases a pool buffer on the partial sector access and
+/  holds it until another file reclaims the least recently used one. The reclaimed
+/  buffer is written back if dirty and reloaded by the owner at the next access, so
+/  that the number of open files is not limited by the RAM of the sector buffers.
+/  The file object must be closed by f_close() before it is discarded. The data
+/  passed to the f_forward() callback is valid only within the call. This option
+/  must be 0 at the tiny configuration (FF_FS_TINY = 1). */
+
+
+#define FF_FS_LOCK		16
 /* The option FF_FS_LOCK switches file lock function to control duplicated file open
 /  and illegal operation to open objects. This option must be 0 when FF_FS_READONLY
 /  is 1.
@@ -275,7 +333,9 @@
 /      lock control is independent of re-entrancy. */
 
 
+#ifndef FF_FS_REENTRANT
 #define FF_FS_REENTRANT	0
+#endif
 #define FF_FS_TIMEOUT	1000
 /* The option FF_FS_REENTRANT switches the re-entrancy (thread safe) of the FatFs
 /  module itself. Note that regardless of this option, file access to different
@@ -289,6 +349,9 @@
 /      function, must be added to the project. Samples are available in ffsystem.c.
 /
 /  The FF_FS_TIMEOUT defines timeout period in unit of O/S time tick.
+/
+/  The build enables the re-entrancy together with the OS_TYPE of ffsystem.c and
+/  the include path of the O/S, e.g. -DFF_FS_REENTRANT=1 -DOS_TYPE=3 for FreeRTOS.
 */
 
 
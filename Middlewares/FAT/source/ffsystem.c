@@ -3,6 +3,7 @@
 /*------------------------------------------------------------------------*/
 
 #include "ff.h"
+#include "diskio.h"
 
 
 #if FF_USE_LFN == 3	/* Use dynamic memory allocation */
@@ -39,7 +40,10 @@ void ff_memfree (
 /* Definitions of Mutex                                                   */
 /*------------------------------------------------------------------------*/
 
-#define OS_TYPE	0	/* 0:Win32, 1:uITRON4.0, 2:uC/OS-II, 3:FreeRTOS, 4:CMSIS-RTOS */
+/* OS_TYPE is defined by the build: 0:Win32, 1:uITRON4.0, 2:uC/OS-II, 3:FreeRTOS, 4:CMSIS-RTOS, 5:POSIX threads (host build) */
+#ifndef OS_TYPE
+#error "FF_FS_REENTRANT requires the OS_TYPE of the build"
+#endif
 
 
 #if   OS_TYPE == 0	/* Win32 */
@@ -59,11 +63,29 @@ static OS_EVENT *Mutex[FF_VOLUMES + 1];	/* Table of mutex pinter */
 #include "FreeRTOS.h"
 #include "semphr.h"
 static SemaphoreHandle_t Mutex[FF_VOLUMES + 1];	/* Table of mutex handle */
+static SemaphoreHandle_t BusMutex;				/* Recursive mutex of the SD card bus */
 
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 #include "cmsis_os.h"
 static osMutexId Mutex[FF_VOLUMES + 1];	/* Table of mutex ID */
 
+#elif OS_TYPE == 5	/* POSIX threads */
+#include <pthread.h>
+#include <time.h>
+static pthread_mutex_t Mutex[FF_VOLUMES + 1];	/* Table of mutex */
+static pthread_mutex_t BusMutex;				/* Recursive mutex of the SD card bus */
+static pthread_once_t BusMutexOnce = PTHREAD_ONCE_INIT;
+
+static void bus_mutex_init (void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&BusMutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
 #endif
 
 
@@ -106,6 +128,9 @@ int ff_mutex_create (	/* Returns 1:Function succeeded or 0:Could not create the
 	Mutex[vol] = osMutexCreate(osMutex(cmsis_os_mutex));
 	return (int)(Mutex[vol] != NULL);
 
+#elif OS_TYPE == 5	/* POSIX threads */
+	return (int)(pthread_mutex_init(&Mutex[vol], NULL) == 0);
+
 #endif
 }
 
@@ -138,6 +163,9 @@ void ff_mutex_delete (	/* Returns 1:Function succeeded or 0:Could not delete due
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 	osMutexDelete(Mutex[vol]);
 
+#elif OS_TYPE == 5	/* POSIX threads */
+	pthread_mutex_destroy(&Mutex[vol]);
+
 #endif
 }
 
@@ -171,6 +199,18 @@ int ff_mutex_take (	/* Returns 1:Succeeded or 0:Timeout */
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 	return (int)(osMutexWait(Mutex[vol], FF_FS_TIMEOUT) == osOK);
 
+#elif OS_TYPE == 5	/* POSIX threads, the time tick is 1 ms */
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += FF_FS_TIMEOUT / 1000;
+	ts.tv_nsec += (FF_FS_TIMEOUT % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	return (int)(pthread_mutex_timedlock(&Mutex[vol], &ts) == 0);
+
 #endif
 }
 
@@ -201,8 +241,59 @@ void ff_mutex_give (
 #elif OS_TYPE == 4	/* CMSIS-RTOS */
 	osMutexRelease(Mutex[vol]);
 
+#elif OS_TYPE == 5	/* POSIX threads */
+	pthread_mutex_unlock(&Mutex[vol]);
+
+#endif
+}
+
+
+
+#if OS_TYPE == 3 || OS_TYPE == 5
+/*------------------------------------------------------------------------*/
+/* Lock/Unlock the SD Card Bus                                            */
+/*------------------------------------------------------------------------*/
+/* This function is the SdSpiCb.sdSpiBusLock callback of the drive. It
+/  guards the SdSpi handler, the diskio state and the SPI bus shared with
+/  the other devices. The SdSpi calls are nested, so the mutex is recursive.
+*/
+
+void ff_bus_lock (
+	bool lock		/* true:Lock, false:Unlock */
+)
+{
+#if OS_TYPE == 3	/* FreeRTOS */
+	SemaphoreHandle_t mutex;
+
+	if (lock && BusMutex == NULL) {	/* The first lock creates the mutex, so every unlock has its lock */
+		mutex = xSemaphoreCreateRecursiveMutex();
+		configASSERT(mutex != NULL);
+		taskENTER_CRITICAL();
+		if (BusMutex == NULL) {
+			BusMutex = mutex;
+			mutex = NULL;
+		}
+		taskEXIT_CRITICAL();
+		if (mutex != NULL) vSemaphoreDelete(mutex);	/* Created by the other task at the same time */
+	}
+	configASSERT(BusMutex != NULL);
+	if (lock) {
+		xSemaphoreTakeRecursive(BusMutex, portMAX_DELAY);
+	} else {
+		xSemaphoreGiveRecursive(BusMutex);
+	}
+
+#elif OS_TYPE == 5	/* POSIX threads */
+	pthread_once(&BusMutexOnce, bus_mutex_init);
+	if (lock) {
+		pthread_mutex_lock(&BusMutex);
+	} else {
+		pthread_mutex_unlock(&BusMutex);
+	}
+
 #endif
 }
+#endif
 
 #endif	/* FF_FS_REENTRANT */
 
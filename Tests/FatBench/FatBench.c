@@ -0,0 +1,1553 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "SdSpi.h"
+#include "SdCardSim.h"
+#include "FastSeek.h"
+#include "FileStream.h"
+#include "RawLog.h"
+#include "LazySync.h"
+#include "SdFormat.h"
+#include "SdLogger.h"
+#include "LogCompress.h"
+
+/*
+ * FatFs throughput on the simulated SD card. The image is formated, the file is
+ * written and read back by the different chunk sizes. The throughput is by the
+ * simulated bus time, so it is the throughput of the target at the same SCK
+ * without the CPU time of the FatFs.
+ */
+
+#define FAT_BENCH_IMAGE           "FatBench.img"
+#define FAT_BENCH_SD_BLOCK        512
+#define FAT_BENCH_BLOCK_COUNT     (64 * 2048) // 64 MB
+#define FAT_BENCH_FILE_SIZE       (1024 * 1024)
+#define FAT_BENCH_MAX_CHUNK       (32 * 1024)
+#define FAT_BENCH_TASKS           4
+#define FAT_BENCH_TASK_FILE_SIZE  (64 * 1024)
+#define FAT_BENCH_TASK_CHUNK      1000
+#define FAT_BENCH_FRAG_FILE_SIZE  (4 * 1024 * 1024)
+#define FAT_BENCH_SEEKS           200
+#define FAT_BENCH_SEEK_READ       512
+#define FAT_BENCH_ARENA_SIZE      4096 // DWORD items
+#define FAT_BENCH_LOG_SIZE        (2 * 1024 * 1024)
+#define FAT_BENCH_LOG_CAPACITY    (4 * 1024 * 1024)
+#define FAT_BENCH_LOG_CHUNK       1000
+#define FAT_BENCH_SYNC_CHUNK      4096
+#define FAT_BENCH_SYNC_BYTES      (64 * 1024)
+#define FAT_BENCH_SYNC_EXTENT     16 // clusters
+#define FAT_BENCH_DIR_FILES       200
+#define FAT_BENCH_DIR_LOOKUPS     200
+#define FAT_BENCH_RESYNC_FRAMES   8
+#define FAT_BENCH_SINK_BYTE_NS    3334 // the USART at 3 Mbit/s
+#define FAT_BENCH_STREAM_OFFSET   100
+#define FAT_BENCH_SIDE_FILES      5    // more than the FF_FS_BUFPOOL, the side reads reclaim the pool buffers
+#define FAT_BENCH_POOL_FILES      16
+#define FAT_BENCH_POOL_FILE_SIZE  (16 * 1024)
+#define FAT_BENCH_POOL_CHUNK      100
+#define FAT_BENCH_SENSOR_PERIOD   320000 // ns, 3125 records/s
+#define FAT_BENCH_SENSOR_DATA     56 // 64 bytes with the record header, 200000 B/s
+#define FAT_BENCH_SENSOR_RECORDS  50000
+#define FAT_BENCH_SENSOR_LOG_SIZE (FAT_BENCH_SENSOR_RECORDS * (FAT_BENCH_SENSOR_DATA + sizeof(SdLoggerRecord)))
+#define FAT_BENCH_LOGGER_RING     (32 * 1024)
+#define FAT_BENCH_LOGGER_SMALL    (8 * 1024)
+#define FAT_BENCH_STALLS          4
+#define FAT_BENCH_STALL_MS        120
+#define FAT_BENCH_SCRATCH_BLOCK   8192 // the calibration scratch area before the format
+#define FAT_BENCH_CALIBRATION_STALL_MS 100
+
+#define PRINT_LOG(FORMAT, ...)    printf(FORMAT, __VA_ARGS__)
+
+static uint8_t benchBuff[FAT_BENCH_MAX_CHUNK];
+static FATFS fatFs;
+static FIL file;
+static const SdSpiCb *benchSdSpiCb;
+
+static uint8_t *sdSpiMallocCb(uint32_t size)
+{
+    static uint8_t memBuff[1024];
+
+    return memBuff;
+}
+
+// The simulated interrupt on the bus activity, it runs while the driver waits for the card
+static void (*benchBusIsr)(void);
+
+static bool benchBusSend(uint8_t *data, size_t dataLength)
+{
+    bool result = sdCardSimSend(data, dataLength);
+
+    if (benchBusIsr != NULL) {
+        benchBusIsr();
+    }
+
+    return result;
+}
+
+static bool benchBusReceive(uint8_t *data, size_t dataLength)
+{
+    bool result = sdCardSimReceive(data, dataLength);
+
+    if (benchBusIsr != NULL) {
+        benchBusIsr();
+    }
+
+    return result;
+}
+
+static uint8_t benchPattern(uint32_t pos)
+{
+    return (uint8_t)((pos >> 9) ^ pos);
+}
+
+static void benchPrint(const char *operation, uint32_t chunk, uint64_t timeNs)
+{
+    SdCardSimStatistic statistic;
+
+    sdCardSimGetStatistic(&statistic);
+    PRINT_LOG("%-5s chunk %6u: %8.1f KB/s, cmd %5u, blocks %5u, blocks/cmd %6.1f, busy %5.1f%%\n",
+              operation, (unsigned int)chunk,
+              FAT_BENCH_FILE_SIZE / 1024.0 / (timeNs / 1e9),
+              (unsigned int)(statistic.readCommands + statistic.writeCommands),
+              (unsigned int)(statistic.blocksRead + statistic.blocksWritten),
+              (double)(statistic.blocksRead + statistic.blocksWritten)
+              / (statistic.readCommands + statistic.writeCommands + (statistic.readCommands + statistic.writeCommands == 0)),
+              100.0 * statistic.busyNs / timeNs);
+}
+
+static bool benchWrite(uint32_t chunk)
+{
+    UINT bw;
+    uint64_t startNs;
+
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    if (f_open(&file, "bench.bin", FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
+        return false;
+    }
+    for (uint32_t pos = 0; pos < FAT_BENCH_FILE_SIZE; pos += chunk) {
+        for (uint32_t k = 0; k < chunk; k++) {
+            benchBuff[k] = benchPattern(pos + k);
+        }
+        if (f_write(&file, benchBuff, chunk, &bw) != FR_OK || bw != chunk) {
+            f_close(&file);
+            return false;
+        }
+    }
+    if (f_close(&file) != FR_OK) {
+        return false;
+    }
+    benchPrint("write", chunk, sdCardSimGetTimeNs() - startNs);
+
+    return true;
+}
+
+static bool benchRead(uint32_t chunk)
+{
+    UINT br;
+    uint64_t startNs;
+    bool result = true;
+
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    if (f_open(&file, "bench.bin", FA_READ) != FR_OK) {
+        return false;
+    }
+    for (uint32_t pos = 0; pos < FAT_BENCH_FILE_SIZE && result; pos += chunk) {
+        if (f_read(&file, benchBuff, chunk, &br) != FR_OK || br != chunk) {
+            result = false;
+            break;
+        }
+        for (uint32_t k = 0; k < chunk; k++) {
+            if (benchBuff[k] != benchPattern(pos + k)) {
+                result = false;
+                break;
+            }
+        }
+    }
+    f_close(&file);
+    if (result) {
+        benchPrint("read", chunk, sdCardSimGetTimeNs() - startNs);
+    }
+
+    return result;
+}
+
+/*
+ * The sequential read with two consecutive sectors out of the file read after each 4 KB, as the
+ * FAT and the directory reads of the other task. The read-ahead of the file is kept over them
+ */
+static bool benchReadMeta(uint32_t chunk)
+{
+    static BYTE meta[FF_MAX_SS];
+    LBA_t metaSector = fatFs.database + (LBA_t)(fatFs.n_fatent - 2) * fatFs.csize - 2;
+    UINT br;
+    uint64_t startNs;
+    bool result = true;
+
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    if (f_open(&file, "bench.bin", FA_READ) != FR_OK) {
+        return false;
+    }
+    for (uint32_t pos = 0; pos < FAT_BENCH_FILE_SIZE && result; pos += chunk) {
+        result = f_read(&file, benchBuff, chunk, &br) == FR_OK && br == chunk;
+        if (result && (pos + chunk) % 4096 == 0) {
+            result = disk_read(0, meta, metaSector, 1) == RES_OK && disk_read(0, meta, metaSector + 1, 1) == RES_OK;
+        }
+        for (uint32_t k = 0; k < chunk && result; k++) {
+            result = benchBuff[k] == benchPattern(pos + k);
+        }
+    }
+    f_close(&file);
+    if (result) {
+        benchPrint("meta", chunk, sdCardSimGetTimeNs() - startNs);
+    }
+
+    return result;
+}
+
+/*
+ * The tasks write and read back the own files on the same volume concurrently
+ */
+static void *benchTask(void *arg)
+{
+    uint32_t task = (uint32_t)(uintptr_t)arg;
+    uint8_t buff[FAT_BENCH_TASK_CHUNK];
+    char name[16];
+    FIL taskFile;
+    UINT bw;
+    uint32_t chunk;
+    bool result = true;
+
+    snprintf(name, sizeof(name), "task%u.bin", (unsigned int)task);
+    if (f_open(&taskFile, name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
+        return (void *)false;
+    }
+    for (uint32_t pos = 0; pos < FAT_BENCH_TASK_FILE_SIZE && result; pos += chunk) {
+        chunk = FAT_BENCH_TASK_FILE_SIZE - pos < sizeof(buff) ? FAT_BENCH_TASK_FILE_SIZE - pos : sizeof(buff);
+        for (uint32_t k = 0; k < chunk; k++) {
+            buff[k] = benchPattern(pos + k) ^ task;
+        }
+        result = f_write(&taskFile, buff, chunk, &bw) == FR_OK && bw == chunk;
+    }
+    result = f_close(&taskFile) == FR_OK && result;
+
+    if (result && f_open(&taskFile, name, FA_READ) != FR_OK) {
+        return (void *)false;
+    }
+    for (uint32_t pos = 0; pos < FAT_BENCH_TASK_FILE_SIZE && result; pos += chunk) {
+        chunk = FAT_BENCH_TASK_FILE_SIZE - pos < sizeof(buff) ? FAT_BENCH_TASK_FILE_SIZE - pos : sizeof(buff);
+        result = f_read(&taskFile, buff, chunk, &bw) == FR_OK && bw == chunk;
+        for (uint32_t k = 0; k < chunk && result; k++) {
+            result = buff[k] == (uint8_t)(benchPattern(pos + k) ^ task);
+        }
+    }
+    f_close(&taskFile);
+
+    return (void *)result;
+}
+
+static bool benchTasks(void)
+{
+    pthread_t threads[FAT_BENCH_TASKS];
+    void *taskResult;
+    bool result = true;
+
+    for (uint32_t k = 0; k < FAT_BENCH_TASKS; k++) {
+        pthread_create(&threads[k], NULL, benchTask, (void *)(uintptr_t)k);
+    }
+    for (uint32_t k = 0; k < FAT_BENCH_TASKS; k++) {
+        pthread_join(threads[k], &taskResult);
+        result = result && taskResult != NULL;
+    }
+    PRINT_LOG("%u concurrent tasks write/read: %s\n", FAT_BENCH_TASKS, result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+/*
+ * The two files are written by the cluster size chunks by turns, so the clusters
+ * of the each file are not contiguous and the every cluster is the own fragment
+ */
+static bool benchFragmented(void)
+{
+    static FIL fragFile[2];
+    static const char *names[] = {"frag0.bin", "frag1.bin"};
+    uint32_t clusterSize = fatFs.csize * FF_MAX_SS;
+    UINT bw;
+    bool result = true;
+
+    for (uint32_t k = 0; k < 2; k++) {
+        if (f_open(&fragFile[k], names[k], FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
+            return false;
+        }
+    }
+    for (uint32_t pos = 0; pos < FAT_BENCH_FRAG_FILE_SIZE && result; pos += clusterSize) {
+        for (uint32_t k = 0; k < 2 && result; k++) {
+            for (uint32_t i = 0; i < clusterSize; i++) {
+                benchBuff[i] = benchPattern(pos + i) ^ k;
+            }
+            result = f_write(&fragFile[k], benchBuff, clusterSize, &bw) == FR_OK && bw == clusterSize;
+        }
+    }
+    for (uint32_t k = 0; k < 2; k++) {
+        result = f_close(&fragFile[k]) == FR_OK && result;
+    }
+
+    return result;
+}
+
+/*
+ * The random seek and read of the fragmented file in the normal and in the fast seek mode
+ */
+static bool benchSeek(bool fastSeek)
+{
+    static DWORD arena[FAT_BENCH_ARENA_SIZE];
+    FastSeekH fastSeekH;
+    SdCardSimStatistic statistic;
+    uint64_t startNs;
+    uint32_t lcg = 12345;
+    UINT br;
+    bool result = true;
+
+    if (f_open(&file, "frag0.bin", FA_READ) != FR_OK) {
+        return false;
+    }
+    fastSeekInit(&fastSeekH, arena, FAT_BENCH_ARENA_SIZE);
+    if (fastSeek && fastSeekAttach(&fastSeekH, &file) != FR_OK) {
+        f_close(&file);
+        return false;
+    }
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    for (uint32_t k = 0; k < FAT_BENCH_SEEKS && result; k++) {
+        lcg = lcg * 1103515245 + 12345;
+        uint32_t pos = (lcg >> 8) % (FAT_BENCH_FRAG_FILE_SIZE - FAT_BENCH_SEEK_READ);
+        result = fastSeekLseek(&fastSeekH, &file, pos) == FR_OK
+                 && f_read(&file, benchBuff, FAT_BENCH_SEEK_READ, &br) == FR_OK
+                 && br == FAT_BENCH_SEEK_READ;
+        for (uint32_t i = 0; i < FAT_BENCH_SEEK_READ && result; i++) {
+            result = benchBuff[i] == benchPattern(pos + i);
+        }
+    }
+    uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+    sdCardSimGetStatistic(&statistic);
+    if (result) {
+        PRINT_LOG("seek %-4s: %8.1f us/seek, cmd %5u, blocks %5u, map %u items\n",
+                  fastSeek ? "fast" : "fat", timeNs / 1e3 / FAT_BENCH_SEEKS,
+                  (unsigned int)(statistic.readCommands + statistic.writeCommands),
+                  (unsigned int)(statistic.blocksRead + statistic.blocksWritten),
+                  (unsigned int)fastSeekH.used);
+    }
+    fastSeekDetach(&fastSeekH, &file);
+    f_close(&file);
+
+    return result;
+}
+
+/*
+ * The append to the file in the fast seek mode, the map is rebuilt for the new clusters
+ */
+static bool benchSeekGrow(void)
+{
+    static DWORD arena[FAT_BENCH_ARENA_SIZE];
+    FastSeekH fastSeekH;
+    FSIZE_t mapSize;
+    UINT bw;
+    bool result;
+
+    if (f_open(&file, "frag1.bin", FA_READ | FA_WRITE | FA_OPEN_APPEND) != FR_OK) {
+        return false;
+    }
+    fastSeekInit(&fastSeekH, arena, FAT_BENCH_ARENA_SIZE);
+    result = fastSeekAttach(&fastSeekH, &file) == FR_OK;
+    mapSize = fastSeekH.entries[0].mapSize;
+    memset(benchBuff, 0x5A, FAT_BENCH_MAX_CHUNK);
+    result = result && fastSeekWrite(&fastSeekH, &file, benchBuff, FAT_BENCH_MAX_CHUNK, &bw) == FR_OK
+             && bw == FAT_BENCH_MAX_CHUNK && fastSeekH.entries[0].mapSize == mapSize + FAT_BENCH_MAX_CHUNK
+             && fastSeekLseek(&fastSeekH, &file, FAT_BENCH_FRAG_FILE_SIZE) == FR_OK
+             && f_read(&file, benchBuff, FAT_BENCH_MAX_CHUNK, &bw) == FR_OK && bw == FAT_BENCH_MAX_CHUNK;
+    for (uint32_t k = 0; k < FAT_BENCH_MAX_CHUNK && result; k++) {
+        result = benchBuff[k] == 0x5A;
+    }
+    PRINT_LOG("seek map rebuild on append: %s\n", result ? "Ok" : "ERROR");
+    fastSeekDetach(&fastSeekH, &file);
+    f_close(&file);
+
+    return result;
+}
+
+/*
+ * The log appends by the f_write and by the raw log on the preallocated file, then
+ * the raw log file is read back by the FatFs
+ */
+static bool benchRawLog(void)
+{
+    static RawLogH rawLog;
+    SdCardSimStatistic statistic;
+    uint64_t startNs;
+    uint32_t chunk;
+    UINT bw;
+    bool result = true;
+
+    for (uint32_t raw = 0; raw < 2 && result; raw++) {
+        sdCardSimResetStatistic();
+        startNs = sdCardSimGetTimeNs();
+        result = raw ? rawLogOpen(&rawLog, "raw.log", FAT_BENCH_LOG_CAPACITY) == FR_OK
+                     : f_open(&file, "fat.log", FA_WRITE | FA_CREATE_ALWAYS) == FR_OK;
+        for (uint32_t pos = 0; pos < FAT_BENCH_LOG_SIZE && result; pos += chunk) {
+            chunk = FAT_BENCH_LOG_SIZE - pos < FAT_BENCH_LOG_CHUNK ? FAT_BENCH_LOG_SIZE - pos : FAT_BENCH_LOG_CHUNK;
+            for (uint32_t k = 0; k < chunk; k++) {
+                benchBuff[k] = benchPattern(pos + k);
+            }
+            result = raw ? rawLogWrite(&rawLog, benchBuff, chunk) == FR_OK
+                         : f_write(&file, benchBuff, chunk, &bw) == FR_OK && bw == chunk;
+        }
+        result = (raw ? rawLogClose(&rawLog) : f_close(&file)) == FR_OK && result;
+        uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+        sdCardSimGetStatistic(&statistic);
+        if (result) {
+            PRINT_LOG("log %-3s chunk %4u: %8.1f KB/s, cmd %5u, blocks %5u\n",
+                      raw ? "raw" : "fat", FAT_BENCH_LOG_CHUNK,
+                      FAT_BENCH_LOG_SIZE / 1024.0 / (timeNs / 1e9),
+                      (unsigned int)(statistic.readCommands + statistic.writeCommands),
+                      (unsigned int)(statistic.blocksRead + statistic.blocksWritten));
+        }
+    }
+
+    if (result && f_open(&file, "raw.log", FA_READ) != FR_OK) {
+        return false;
+    }
+    result = result && f_size(&file) == FAT_BENCH_LOG_SIZE;
+    for (uint32_t pos = 0; pos < FAT_BENCH_LOG_SIZE && result; pos += FAT_BENCH_MAX_CHUNK) {
+        result = f_read(&file, benchBuff, FAT_BENCH_MAX_CHUNK, &bw) == FR_OK && bw == FAT_BENCH_MAX_CHUNK;
+        for (uint32_t k = 0; k < FAT_BENCH_MAX_CHUNK && result; k++) {
+            result = benchBuff[k] == benchPattern(pos + k);
+        }
+    }
+    f_close(&file);
+    PRINT_LOG("raw log read back: %s\n", result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+/*
+ * The appends with the f_sync after the every chunk and with the lazy sync by the
+ * bytes threshold. The metadata blocks are all the blocks except the file data
+ */
+static bool benchLazySync(void)
+{
+    static LazySyncH lazySync;
+    LazySyncConfig lazyConfig = {
+        .extentClusters = FAT_BENCH_SYNC_EXTENT,
+        .syncBytes = FAT_BENCH_SYNC_BYTES,
+    };
+    SdCardSimStatistic statistic;
+    FATFS *fs;
+    DWORD freeBefore = 0;
+    DWORD freeAfter = 0;
+    uint64_t startNs;
+    UINT bw;
+    bool result = true;
+
+    for (uint32_t lazy = 0; lazy < 2 && result; lazy++) {
+        sdCardSimResetStatistic();
+        startNs = sdCardSimGetTimeNs();
+        result = f_open(&file, "sync.log", FA_WRITE | FA_CREATE_ALWAYS) == FR_OK
+                 && (!lazy || lazySyncInit(&lazySync, &file, &lazyConfig) == FR_OK);
+        for (uint32_t pos = 0; pos < FAT_BENCH_FILE_SIZE && result; pos += FAT_BENCH_SYNC_CHUNK) {
+            for (uint32_t k = 0; k < FAT_BENCH_SYNC_CHUNK; k++) {
+                benchBuff[k] = benchPattern(pos + k);
+            }
+            result = lazy ? lazySyncWrite(&lazySync, benchBuff, FAT_BENCH_SYNC_CHUNK, &bw) == FR_OK
+                          : f_write(&file, benchBuff, FAT_BENCH_SYNC_CHUNK, &bw) == FR_OK
+                            && f_sync(&file) == FR_OK;
+            result = result && bw == FAT_BENCH_SYNC_CHUNK;
+        }
+        result = (lazy ? lazySyncClose(&lazySync) : f_close(&file)) == FR_OK && result;
+        uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+        sdCardSimGetStatistic(&statistic);
+        // The same file size is rewritten, the not used extent clusters are freed on the close
+        result = f_getfree("", lazy ? &freeAfter : &freeBefore, &fs) == FR_OK && result
+                 && (!lazy || freeAfter == freeBefore);
+        if (result) {
+            PRINT_LOG("sync %-4s chunk %4u: %8.1f KB/s, metadata blocks/MB: write %4u, read %4u\n",
+                      lazy ? "lazy" : "fat", FAT_BENCH_SYNC_CHUNK,
+                      FAT_BENCH_FILE_SIZE / 1024.0 / (timeNs / 1e9),
+                      (unsigned int)(statistic.blocksWritten - FAT_BENCH_FILE_SIZE / FAT_BENCH_SD_BLOCK),
+                      (unsigned int)statistic.blocksRead);
+        }
+    }
+
+    if (result && f_open(&file, "sync.log", FA_READ) != FR_OK) {
+        return false;
+    }
+    result = result && f_size(&file) == FAT_BENCH_FILE_SIZE;
+    for (uint32_t pos = 0; pos < FAT_BENCH_FILE_SIZE && result; pos += FAT_BENCH_MAX_CHUNK) {
+        result = f_read(&file, benchBuff, FAT_BENCH_MAX_CHUNK, &bw) == FR_OK && bw == FAT_BENCH_MAX_CHUNK;
+        for (uint32_t k = 0; k < FAT_BENCH_MAX_CHUNK && result; k++) {
+            result = benchBuff[k] == benchPattern(pos + k);
+        }
+    }
+    f_close(&file);
+    PRINT_LOG("lazy sync read back: %s\n", result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+/*
+ * The sensor interrupt of the fixed record rate by the simulated time. The time of
+ * the writer task sleep is added to the simulated time of the SD card
+ */
+static struct {
+    SdLoggerH *logger;
+    uint64_t nextNs;
+    uint64_t sleepNs;
+    uint32_t seq;
+    uint32_t throttled;
+    bool telemetry;
+} benchSensor;
+
+static uint64_t benchSensorTimeNs(void)
+{
+    return sdCardSimGetTimeNs() + benchSensor.sleepNs;
+}
+
+static uint32_t benchSensorTimeUs(void)
+{
+    return (uint32_t)(benchSensorTimeNs() / 1000);
+}
+
+/*
+ * The sample of the sequence number: the counters or the telemetry of the 3-axis
+ * sensors with the slow drift and the noise of 2 bits, the temperature and the
+ * status channels
+ */
+static void benchSensorSample(uint32_t seq, uint32_t sample[])
+{
+    static const int16_t base[] = {12, -980, 105, 3, -2, 1, 220, -310, 415};
+    int16_t *channel = (int16_t *)&sample[1];
+
+    sample[0] = seq;
+    for (uint32_t k = 1; k < FAT_BENCH_SENSOR_DATA / sizeof(uint32_t) && !benchSensor.telemetry; k++) {
+        sample[k] = seq + k;
+    }
+    for (uint32_t k = 0; k < (FAT_BENCH_SENSOR_DATA - sizeof(uint32_t)) / sizeof(int16_t) && benchSensor.telemetry; k++) {
+        if (k < sizeof(base) / sizeof(base[0])) {
+            channel[k] = base[k] + ((seq >> 8) & 0x1F) + (((seq * 2654435761u) >> (k + 20)) & 3);
+        } else {
+            channel[k] = k < 12 ? 2500 + (seq >> 14) : 0x0001;
+        }
+    }
+}
+
+static void benchSensorIsr(void)
+{
+    uint32_t sample[FAT_BENCH_SENSOR_DATA / sizeof(uint32_t)];
+
+    while (benchSensor.seq < FAT_BENCH_SENSOR_RECORDS && benchSensorTimeNs() >= benchSensor.nextNs) {
+        benchSensorSample(benchSensor.seq, sample);
+        if (sdLoggerPush(benchSensor.logger, 1, sample, sizeof(sample)) == SD_LOGGER_RESULT_THROTTLED) {
+            benchSensor.throttled++;
+        }
+        benchSensor.seq++;
+        benchSensor.nextNs += FAT_BENCH_SENSOR_PERIOD;
+    }
+}
+
+// The writer task sleeps up to the next record
+static void benchWriterSleep(void)
+{
+    uint64_t nowNs = benchSensorTimeNs();
+
+    if (benchSensor.nextNs > nowNs) {
+        benchSensor.sleepNs += benchSensor.nextNs - nowNs;
+    }
+    benchSensorIsr();
+}
+
+/*
+ * The log data of the file, the compressed log is read and decompressed by the frames.
+ * The decompressed data is kept for the compression benchmark
+ */
+static struct {
+    bool compressed;
+    uint32_t frames;
+    uint32_t rawPos;
+    uint32_t rawSize;
+    uint32_t dataSize;
+    uint8_t frame[LOG_COMPRESS_FRAME_BOUND];
+    uint8_t data[FAT_BENCH_SENSOR_LOG_SIZE + LOG_COMPRESS_FRAME_SIZE];
+} benchLogReader;
+
+static bool benchLogRead(void *data, UINT size)
+{
+    uint8_t *raw = &benchLogReader.data[benchLogReader.dataSize];
+    uint32_t frameSize;
+    int32_t rawSize;
+    UINT br;
+
+    if (!benchLogReader.compressed) {
+        return f_read(&file, data, size, &br) == FR_OK && br == size;
+    }
+    for (uint32_t chunk; size != 0; size -= chunk) {
+        if (benchLogReader.rawPos == benchLogReader.rawSize) {
+            if (f_read(&file, benchLogReader.frame, LOG_COMPRESS_HEADER, &br) != FR_OK || br != LOG_COMPRESS_HEADER) {
+                return false;
+            }
+            frameSize = logCompressGetFrameSize(benchLogReader.frame);
+            if (frameSize == 0
+                || f_read(&file, &benchLogReader.frame[LOG_COMPRESS_HEADER], frameSize - LOG_COMPRESS_HEADER, &br) != FR_OK
+                || br != frameSize - LOG_COMPRESS_HEADER) {
+                return false;
+            }
+            benchLogReader.dataSize += benchLogReader.rawSize;
+            raw = &benchLogReader.data[benchLogReader.dataSize];
+            rawSize = logDecompressFrame(benchLogReader.frame, frameSize, raw);
+            if (rawSize <= 0 || benchLogReader.dataSize + rawSize > sizeof(benchLogReader.data)) {
+                return false;
+            }
+            benchLogReader.rawPos = 0;
+            benchLogReader.rawSize = rawSize;
+            benchLogReader.frames++;
+        }
+        chunk = benchLogReader.rawSize - benchLogReader.rawPos;
+        chunk = size < chunk ? size : chunk;
+        memcpy(data, &raw[benchLogReader.rawPos], chunk);
+        benchLogReader.rawPos += chunk;
+        data = (uint8_t *)data + chunk;
+    }
+
+    return true;
+}
+
+static bool benchLogEof(void)
+{
+    return f_eof(&file) && benchLogReader.rawPos == benchLogReader.rawSize;
+}
+
+/*
+ * The records of the log are in the push order, the sequence gaps are the records
+ * counted by the drop records. The frame of the compressed log starts on the record
+ */
+static bool benchLoggerReadBack(uint32_t dropped, bool compressed)
+{
+    SdLoggerRecord record;
+    uint32_t sample[FAT_BENCH_SENSOR_DATA / sizeof(uint32_t)];
+    uint32_t expected[FAT_BENCH_SENSOR_DATA / sizeof(uint32_t)];
+    uint32_t seq = 0;
+    uint32_t gaps = 0;
+    uint32_t drops = 0;
+    uint32_t timeUs = 0;
+    uint32_t frames;
+    bool frameStart;
+    bool result;
+
+    benchLogReader.compressed = compressed;
+    benchLogReader.frames = 0;
+    benchLogReader.rawPos = 0;
+    benchLogReader.rawSize = 0;
+    benchLogReader.dataSize = 0;
+    result = f_open(&file, "sensor.log", FA_READ) == FR_OK;
+    while (result && !benchLogEof()) {
+        frames = benchLogReader.frames;
+        frameStart = benchLogReader.rawPos == benchLogReader.rawSize;
+        result = benchLogRead(&record, sizeof(record)) && record.size <= sizeof(sample)
+                 && benchLogRead(sample, record.size) && record.timeUs >= timeUs
+                 && (!compressed || benchLogReader.frames == frames + frameStart);
+        timeUs = record.timeUs;
+        if (result && record.id == SD_LOGGER_ID_DROP) {
+            drops += sample[0];
+            continue;
+        }
+        result = result && record.size == sizeof(sample) && sample[0] >= seq;
+        if (result) {
+            benchSensorSample(sample[0], expected);
+            result = memcmp(sample, expected, sizeof(sample)) == 0;
+            gaps += sample[0] - seq;
+            seq = sample[0] + 1;
+        }
+    }
+    f_close(&file);
+    benchLogReader.dataSize += benchLogReader.rawSize;
+
+    return result && drops == dropped && gaps + (FAT_BENCH_SENSOR_RECORDS - seq) == dropped;
+}
+
+/*
+ * The fixed rate sensor log through the ring of the size, the card stalls the write
+ * for the garbage collection several times. The ring of the size above the record
+ * rate by the stall time keeps all the records. The compressed log is of the
+ * telemetry samples
+ */
+static bool benchLoggerPass(uint32_t ringSize, LogCompressH *compress, uint32_t *dropped)
+{
+    static SdLoggerH logger;
+    static uint32_t ring[FAT_BENCH_LOGGER_RING / sizeof(uint32_t)];
+    SdLoggerConfig config = {
+        .ringBuff = (uint8_t *)ring,
+        .ringSize = ringSize,
+        .highWatermark = ringSize / 4 * 3,
+        .lowWatermark = ringSize / 4,
+        .syncIntervalMs = 1000,
+        .getTimeUs = benchSensorTimeUs,
+        .compress = compress,
+    };
+    SdLoggerStatistic statistic;
+    SdCardSimStatistic simStatistic;
+    uint64_t startNs;
+    bool result;
+
+    memset(&benchSensor, 0, sizeof(benchSensor));
+    benchSensor.logger = &logger;
+    benchSensor.telemetry = compress != NULL;
+    result = sdLoggerOpen(&logger, "sensor.log", FAT_BENCH_LOG_CAPACITY, &config) == FR_OK;
+    for (uint32_t k = 1; k <= FAT_BENCH_STALLS && result; k++) {
+        // The compressed log is shorter, the stalls are on its start
+        result = sdCardSimInjectFault(SD_CARD_SIM_FAULT_WRITE_STALL, logger.log.startSector
+                                      + k * (FAT_BENCH_SENSOR_LOG_SIZE / (FAT_BENCH_STALLS + 1) / FAT_BENCH_SD_BLOCK)
+                                        / (compress != NULL ? FAT_BENCH_STALLS : 1),
+                                      FAT_BENCH_STALL_MS);
+    }
+    sdCardSimResetStatistic();
+    startNs = benchSensorTimeNs();
+    benchSensor.nextNs = startNs;
+    benchBusIsr = benchSensorIsr;
+    while (result && benchSensor.seq < FAT_BENCH_SENSOR_RECORDS) {
+        result = sdLoggerProcess(&logger) == FR_OK;
+        if (ringBuffMpscGetUsed(&logger.ring) == 0) {
+            benchWriterSleep();
+        }
+    }
+    benchBusIsr = NULL;
+    result = sdLoggerClose(&logger) == FR_OK && result;
+    uint64_t timeNs = benchSensorTimeNs() - startNs;
+    sdLoggerGetStatistic(&logger, &statistic);
+    sdCardSimGetStatistic(&simStatistic);
+    if (result) {
+        PRINT_LOG("logger ring %3u KB%s: %8.1f KB/s, records %5u, dropped %4u, throttled %5u, "
+                  "ring max %5.1f KB, writer max %6.1f ms, blocks written %5u\n",
+                  (unsigned int)(ringSize / 1024), compress != NULL ? " lz4" : "    ",
+                  statistic.bytes / 1024.0 / (timeNs / 1e9),
+                  (unsigned int)statistic.records, (unsigned int)statistic.droppedRecords,
+                  (unsigned int)benchSensor.throttled, statistic.maxRingUsed / 1024.0,
+                  statistic.maxProcessUs / 1000.0, (unsigned int)simStatistic.blocksWritten);
+    }
+    *dropped = statistic.droppedRecords;
+
+    return result && benchLoggerReadBack(statistic.droppedRecords, compress != NULL);
+}
+
+/*
+ * The sensor log without the drops on the ring of the stall time and with the drops
+ * counted on the small ring
+ */
+static bool benchLogger(void)
+{
+    uint32_t dropped;
+    uint32_t smallDropped;
+    bool result;
+
+    result = benchLoggerPass(FAT_BENCH_LOGGER_RING, NULL, &dropped) && dropped == 0
+             && benchLoggerPass(FAT_BENCH_LOGGER_SMALL, NULL, &smallDropped) && smallDropped != 0;
+    PRINT_LOG("sensor logger read back: %s\n", result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+static uint64_t benchCpuTimeNs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/*
+ * The frames of the logged telemetry are found from the every aligned offset in the
+ * frame before them and after the damage of the frame header, as the reader of the
+ * log does after the seek or the torn write
+ */
+static bool benchLogResync(LogCompressH *compress)
+{
+    static uint8_t stream[FAT_BENCH_RESYNC_FRAMES * LOG_COMPRESS_FRAME_BOUND];
+    static uint8_t raw[LOG_COMPRESS_FRAME_SIZE];
+    uint32_t offsets[FAT_BENCH_RESYNC_FRAMES + 1];
+    const uint8_t *frame;
+    uint32_t size;
+    uint32_t found;
+    bool result = benchLogReader.dataSize >= FAT_BENCH_RESYNC_FRAMES * LOG_COMPRESS_FRAME_SIZE;
+
+    logCompressInit(compress);
+    offsets[0] = 0;
+    for (uint32_t k = 0; k < FAT_BENCH_RESYNC_FRAMES && result; k++) {
+        logCompressAppend(compress, &benchLogReader.data[k * LOG_COMPRESS_FRAME_SIZE], LOG_COMPRESS_FRAME_SIZE);
+        size = logCompressFrame(compress, &frame);
+        memcpy(&stream[offsets[k]], frame, size);
+        offsets[k + 1] = offsets[k] + size;
+        result = size % LOG_COMPRESS_ALIGN == 0;
+    }
+    for (uint32_t k = 1; k < FAT_BENCH_RESYNC_FRAMES && result; k++) {
+        for (uint32_t pos = offsets[k - 1] + LOG_COMPRESS_ALIGN; pos <= offsets[k] && result; pos += LOG_COMPRESS_ALIGN) {
+            result = pos + logCompressFindFrame(&stream[pos], offsets[FAT_BENCH_RESYNC_FRAMES] - pos) == offsets[k];
+        }
+    }
+    // The damaged header is skipped to the next frame, it is decompressed
+    stream[offsets[1] + 1] ^= 0x10;
+    found = result ? offsets[1] + logCompressFindFrame(&stream[offsets[1]], offsets[FAT_BENCH_RESYNC_FRAMES] - offsets[1])
+                   : 0;
+    result = result && found == offsets[2]
+             && logDecompressFrame(&stream[found], offsets[3] - found, raw) == LOG_COMPRESS_FRAME_SIZE
+             && memcmp(raw, &benchLogReader.data[2 * LOG_COMPRESS_FRAME_SIZE], LOG_COMPRESS_FRAME_SIZE) == 0;
+    PRINT_LOG("lz4 frame resync: %s\n", result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+/*
+ * The telemetry log compressed by the frames, then the compression and the decompression
+ * of the logged telemetry by the host CPU. The ratio is of the log data to the frames.
+ * The speed is of the host, the cycles per byte on the Cortex-M4 are not simulated
+ */
+static bool benchLogCompress(void)
+{
+    static LogCompressH compress;
+    static uint16_t hash[LOG_COMPRESS_HASH_SIZE];
+    static uint8_t block[LOG_COMPRESS_FRAME_BOUND];
+    static uint8_t raw[LOG_COMPRESS_FRAME_SIZE];
+    uint64_t compressNs = 0;
+    uint64_t decompressNs = 0;
+    uint64_t packed = 0;
+    uint64_t startNs;
+    uint32_t dropped;
+    uint32_t size;
+    uint32_t blockSize;
+    bool result;
+
+    result = benchLoggerPass(FAT_BENCH_LOGGER_RING, &compress, &dropped) && dropped == 0;
+    PRINT_LOG("compressed sensor log read back: %s, frames %u\n", result ? "Ok" : "ERROR",
+              (unsigned int)benchLogReader.frames);
+    result = result && benchLogResync(&compress);
+    for (uint32_t pos = 0; pos < benchLogReader.dataSize && result; pos += size) {
+        size = benchLogReader.dataSize - pos < LOG_COMPRESS_FRAME_SIZE ? benchLogReader.dataSize - pos
+                                                                        : LOG_COMPRESS_FRAME_SIZE;
+        startNs = benchCpuTimeNs();
+        blockSize = logCompressBlock(hash, &benchLogReader.data[pos], size, block, sizeof(block));
+        compressNs += benchCpuTimeNs() - startNs;
+        startNs = benchCpuTimeNs();
+        result = logDecompressBlock(block, blockSize, raw, sizeof(raw)) == (int32_t)size;
+        decompressNs += benchCpuTimeNs() - startNs;
+        result = result && blockSize != 0 && memcmp(raw, &benchLogReader.data[pos], size) == 0;
+        packed += blockSize;
+    }
+    if (result) {
+        PRINT_LOG("lz4 telemetry %u KB: ratio %4.2f, host compress %7.1f MB/s, decompress %7.1f MB/s\n",
+                  (unsigned int)(benchLogReader.dataSize / 1024), (double)benchLogReader.dataSize / packed,
+                  benchLogReader.dataSize / 1e6 / (compressNs / 1e9),
+                  benchLogReader.dataSize / 1e6 / (decompressNs / 1e9));
+    }
+
+    return result;
+}
+
+/*
+ * The first cluster allocation after the mount scans the FAT from the volume top.
+ * The free cluster summary is built by the f_getfree, then the allocation skips
+ * the full FAT blocks. The summary kept by the allocations is compared with the
+ * summary built by the FAT scan after the remount
+ */
+static bool benchAllocate(const char *name, const char *operation)
+{
+    SdCardSimStatistic statistic;
+    uint64_t startNs;
+    UINT bw;
+    bool result;
+
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    memset(benchBuff, 0, FF_MAX_SS);
+    result = f_open(&file, name, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK
+             && f_write(&file, benchBuff, FF_MAX_SS, &bw) == FR_OK && bw == FF_MAX_SS
+             && f_sync(&file) == FR_OK;
+    uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+    sdCardSimGetStatistic(&statistic);
+    result = f_close(&file) == FR_OK && result;
+    if (result) {
+        PRINT_LOG("%-28s: %8.1f us, read cmd %4u, blocks %5u\n", operation, timeNs / 1e3,
+                  (unsigned int)statistic.readCommands, (unsigned int)statistic.blocksRead);
+    }
+
+    return result;
+}
+
+static bool benchFreeMap(void)
+{
+    static DWORD fmap[FF_FS_FREEMAP];
+    SdCardSimStatistic statistic;
+    uint64_t startNs;
+    DWORD fmNcl = fatFs.fm_ncl;
+    DWORD total = 0;
+    DWORD nclst;
+    FATFS *fs;
+    bool result;
+
+    memcpy(fmap, fatFs.fmap, sizeof(fmap));
+    f_mount(NULL, "", 0);
+    result = f_mount(&fatFs, "", 1) == FR_OK;
+    for (uint32_t k = 0; k < 2 && result; k++) {
+        sdCardSimResetStatistic();
+        startNs = sdCardSimGetTimeNs();
+        result = f_getfree("", &nclst, &fs) == FR_OK;
+        uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+        sdCardSimGetStatistic(&statistic);
+        PRINT_LOG("f_getfree %u: %8.1f us, read cmd %4u, blocks %5u, free clusters %u\n", (unsigned int)k,
+                  timeNs / 1e3, (unsigned int)statistic.readCommands, (unsigned int)statistic.blocksRead,
+                  (unsigned int)nclst);
+    }
+    // The valid FSINFO count is returned without the scan, else the FAT scan builds the summary. The
+    // summary of the allocations and frees before the remount is the same as the FAT scan result
+    result = result && fmNcl != 0
+             && (fatFs.fm_ncl == 0 || (fmNcl == fatFs.fm_ncl && memcmp(fmap, fatFs.fmap, sizeof(fmap)) == 0));
+
+    // The first allocation after the mount builds the summary, the allocation is from the volume top
+    f_mount(NULL, "", 0);
+    result = result && f_mount(&fatFs, "", 1) == FR_OK && fatFs.fm_ncl == 0;
+    fatFs.last_clst = 0xFFFFFFFF;
+    result = result && benchAllocate("alloc0.bin", "first allocation, FAT scan");
+    for (uint32_t k = 0; k < FF_FS_FREEMAP; k++) {
+        total += fatFs.fmap[k];
+    }
+    result = result && fatFs.fm_ncl == fmNcl && total == fatFs.free_clst;
+    fatFs.last_clst = 0xFFFFFFFF;
+    result = result && benchAllocate("alloc1.bin", "next allocation, summary");
+    PRINT_LOG("free cluster summary: %s\n", result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+/*
+ * The file lookup in the big directory. The first lookup after the mount scans the
+ * directory and builds the index, the next lookups read the matched entries only
+ */
+static bool benchDirLookup(const char *operation, uint32_t count, uint32_t *lcg)
+{
+    SdCardSimStatistic statistic;
+    FILINFO info;
+    uint64_t startNs;
+    char name[24];
+    bool result = true;
+
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    for (uint32_t k = 0; k < count && result; k++) {
+        *lcg = *lcg * 1103515245 + 12345;
+        snprintf(name, sizeof(name), "logs/L%04u.TXT", (unsigned int)((*lcg >> 8) % FAT_BENCH_DIR_FILES));
+        result = f_stat(name, &info) == FR_OK;
+    }
+    uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+    sdCardSimGetStatistic(&statistic);
+    if (result) {
+        PRINT_LOG("%-26s: %8.1f us/lookup, read cmd %4u, blocks %5u\n", operation, timeNs / 1e3 / count,
+                  (unsigned int)statistic.readCommands, (unsigned int)statistic.blocksRead);
+    }
+
+    return result;
+}
+
+static bool benchDirIndex(void)
+{
+    FILINFO info;
+    char name[24];
+    uint32_t lcg = 1;
+    bool result;
+
+    result = f_mkdir("logs") == FR_OK;
+    for (uint32_t k = 0; k < FAT_BENCH_DIR_FILES && result; k++) {
+        snprintf(name, sizeof(name), "logs/L%04u.TXT", (unsigned int)k);
+        result = f_open(&file, name, FA_WRITE | FA_CREATE_NEW) == FR_OK && f_close(&file) == FR_OK;
+    }
+    f_mount(NULL, "", 0);
+    result = result && f_mount(&fatFs, "", 1) == FR_OK
+             && benchDirLookup("first lookup, index build", 1, &lcg)
+             && benchDirLookup("indexed lookup", FAT_BENCH_DIR_LOOKUPS, &lcg);
+
+    // The index follows the removal, the creation and the rename of the files
+    result = result && f_unlink("logs/L0001.TXT") == FR_OK && f_stat("logs/L0001.TXT", &info) == FR_NO_FILE
+             && f_rename("logs/L0002.TXT", "logs/R0002.TXT") == FR_OK
+             && f_stat("logs/L0002.TXT", &info) == FR_NO_FILE && f_stat("logs/R0002.TXT", &info) == FR_OK
+             && f_open(&file, "logs/L0001.TXT", FA_WRITE | FA_CREATE_NEW) == FR_OK && f_close(&file) == FR_OK
+             && f_stat("logs/L0001.TXT", &info) == FR_OK && f_rename("logs/R0002.TXT", "logs/L0002.TXT") == FR_OK;
+    for (uint32_t k = 0; k < FAT_BENCH_DIR_FILES && result; k++) {
+        snprintf(name, sizeof(name), "logs/L%04u.TXT", (unsigned int)k);
+        result = f_stat(name, &info) == FR_OK;
+    }
+    PRINT_LOG("directory index: %s\n", result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+/*
+ * The removal of the fragmented file walks the chain of the every second cluster
+ * and frees them, the FAT sectors are written back on the sync. Then the both FATs
+ * are compared and the free clusters counted after the remount are compared
+ */
+static bool benchFatCache(void)
+{
+    static BYTE fat[2][FF_MAX_SS];
+    SdCardSimStatistic statistic;
+    uint64_t startNs;
+    DWORD nclst;
+    DWORD nclstMount;
+    FATFS *fs;
+    bool result;
+
+    f_mount(NULL, "", 0);
+    result = f_mount(&fatFs, "", 1) == FR_OK;
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    result = result && f_unlink("frag0.bin") == FR_OK;
+    uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+    sdCardSimGetStatistic(&statistic);
+    if (result) {
+        PRINT_LOG("unlink fragmented file: %8.1f us, read cmd %4u, write cmd %4u, erase cmd %4u, blocks %5u\n",
+                  timeNs / 1e3, (unsigned int)statistic.readCommands, (unsigned int)statistic.writeCommands,
+                  (unsigned int)statistic.eraseCommands, (unsigned int)(statistic.blocksRead + statistic.blocksWritten));
+    }
+    result = result && f_getfree("", &nclst, &fs) == FR_OK;
+    for (LBA_t sect = 0; sect < fatFs.fsize && result && fatFs.n_fats == 2; sect++) {
+        result = disk_read(0, fat[0], fatFs.fatbase + sect, 1) == RES_OK
+                 && disk_read(0, fat[1], fatFs.fatbase + fatFs.fsize + sect, 1) == RES_OK
+                 && memcmp(fat[0], fat[1], FF_MAX_SS) == 0;
+    }
+    f_mount(NULL, "", 0);
+    result = result && f_mount(&fatFs, "", 1) == FR_OK && f_getfree("", &nclstMount, &fs) == FR_OK
+             && nclst == nclstMount;
+    PRINT_LOG("FAT cache write back: %s\n", result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+/*
+ * The simulated DMA sink, the transmit time is added to the simulated time of the
+ * SD card while the stream waits for the transmit end. The data is checked on the
+ * transmit end, so the buffer changed while it is transmitted is the error. The side
+ * files are read while the transmit is in progress, as the other task does
+ */
+static struct {
+    FileStreamH *stream;
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t pos;
+    uint64_t doneNs;
+    uint64_t waitNs;
+    FIL *sideFiles;
+    uint32_t sideReads;
+    bool error;
+} benchSink;
+
+// The not aligned reads of all side files, each one leases the file sector buffer of the pool
+static void benchSideRead(void)
+{
+    uint8_t buff[FAT_BENCH_POOL_CHUNK];
+    FSIZE_t pos;
+    UINT br;
+
+    for (uint32_t n = 0; n < FAT_BENCH_SIDE_FILES && !benchSink.error; n++) {
+        FIL *fp = &benchSink.sideFiles[n];
+
+        if (f_size(fp) - f_tell(fp) < sizeof(buff) && f_lseek(fp, 0) != FR_OK) {
+            benchSink.error = true;
+            break;
+        }
+        pos = f_tell(fp);
+        if (f_read(fp, buff, sizeof(buff), &br) != FR_OK || br != sizeof(buff)) {
+            benchSink.error = true;
+            break;
+        }
+        for (uint32_t k = 0; k < br; k++) {
+            benchSink.error |= buff[k] != benchPattern(pos + k);
+        }
+        benchSink.sideReads++;
+    }
+}
+
+static uint64_t benchSinkTimeNs(void)
+{
+    return sdCardSimGetTimeNs() + benchSink.waitNs;
+}
+
+static bool benchSinkStart(const uint8_t *data, uint32_t size)
+{
+    benchSink.data = data;
+    benchSink.size = size;
+    benchSink.doneNs = benchSinkTimeNs() + (uint64_t)size * FAT_BENCH_SINK_BYTE_NS;
+
+    return true;
+}
+
+static void benchSinkWait(void)
+{
+    uint64_t nowNs = benchSinkTimeNs();
+
+    if (benchSink.doneNs > nowNs) {
+        benchSink.waitNs += benchSink.doneNs - nowNs;
+    }
+    if (benchSink.sideFiles != NULL && benchSink.size != 0) {
+        benchSideRead();
+    }
+    for (uint32_t k = 0; k < benchSink.size; k++) {
+        benchSink.error |= benchSink.data[k] != benchPattern(benchSink.pos + k);
+    }
+    benchSink.pos += benchSink.size;
+    benchSink.size = 0;
+    if (benchSink.stream != NULL) {
+        fileStreamSinkDone(benchSink.stream);
+    }
+}
+
+/*
+ * The file transmit by the f_read to the buffer and the copy to the transmit buffer
+ * against the double buffered stream without the copy. The last stream is sent while
+ * the side files are read, the sink data is not in the file sector buffer of the pool
+ */
+static bool benchStream(void)
+{
+    static FileStreamH stream;
+    static uint8_t txBuff[4096];
+    static FIL sideFiles[FAT_BENCH_SIDE_FILES];
+    FileStreamSink sink = {
+        .sinkStart = benchSinkStart,
+        .sinkWait = benchSinkWait,
+    };
+    uint64_t startNs;
+    uint64_t copyNs;
+    FSIZE_t sent = 0;
+    UINT br;
+    bool result;
+
+    memset(&benchSink, 0, sizeof(benchSink));
+    benchSink.pos = FAT_BENCH_STREAM_OFFSET;
+    startNs = benchSinkTimeNs();
+    result = f_open(&file, "bench.bin", FA_READ) == FR_OK && f_lseek(&file, FAT_BENCH_STREAM_OFFSET) == FR_OK;
+    while (result && !f_eof(&file)) {
+        result = f_read(&file, benchBuff, sizeof(txBuff), &br) == FR_OK;
+        memcpy(txBuff, benchBuff, br);
+        result = result && benchSinkStart(txBuff, br);
+        benchSinkWait();
+        sent += br;
+    }
+    result = f_close(&file) == FR_OK && result && !benchSink.error;
+    copyNs = benchSinkTimeNs() - startNs;
+
+    memset(&benchSink, 0, sizeof(benchSink));
+    benchSink.stream = &stream;
+    benchSink.pos = FAT_BENCH_STREAM_OFFSET;
+    startNs = benchSinkTimeNs();
+    result = result && fileStreamInit(&stream, &sink) == FR_OK && f_open(&file, "bench.bin", FA_READ) == FR_OK
+             && f_lseek(&file, FAT_BENCH_STREAM_OFFSET) == FR_OK
+             && fileStreamSend(&stream, &file, FAT_BENCH_FILE_SIZE, &sent) == FR_OK;
+    result = f_close(&file) == FR_OK && result && !benchSink.error
+             && sent == FAT_BENCH_FILE_SIZE - FAT_BENCH_STREAM_OFFSET && benchSink.pos == FAT_BENCH_FILE_SIZE;
+    if (result) {
+        PRINT_LOG("stream to sink: read and copy %8.1f KB/s, double buffered %8.1f KB/s, sink %8.1f KB/s\n",
+                  sent / 1024.0 / (copyNs / 1e9),
+                  sent / 1024.0 / ((benchSinkTimeNs() - startNs) / 1e9),
+                  1e9 / FAT_BENCH_SINK_BYTE_NS / 1024.0);
+    } else {
+        PRINT_LOG("%s\n", "Stream to sink ERROR");
+    }
+
+    memset(&benchSink, 0, sizeof(benchSink));
+    benchSink.stream = &stream;
+    benchSink.pos = FAT_BENCH_STREAM_OFFSET;
+    benchSink.sideFiles = sideFiles;
+    for (uint32_t k = 0; k < FAT_BENCH_SIDE_FILES && result; k++) {
+        result = f_open(&sideFiles[k], "bench.bin", FA_READ) == FR_OK
+                 && f_lseek(&sideFiles[k], k * FAT_BENCH_FILE_SIZE / FAT_BENCH_SIDE_FILES + 1) == FR_OK;
+    }
+    result = result && f_open(&file, "bench.bin", FA_READ) == FR_OK
+             && f_lseek(&file, FAT_BENCH_STREAM_OFFSET) == FR_OK
+             && fileStreamSend(&stream, &file, FAT_BENCH_FILE_SIZE, &sent) == FR_OK;
+    result = f_close(&file) == FR_OK && result && !benchSink.error && benchSink.pos == FAT_BENCH_FILE_SIZE;
+    for (uint32_t k = 0; k < FAT_BENCH_SIDE_FILES; k++) {
+        f_close(&sideFiles[k]);
+    }
+    PRINT_LOG("stream with %u side file reads: %s\n", (unsigned)benchSink.sideReads, result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+/*
+ * The random seek and read of the contiguous file created by the f_expand. On the
+ * exFAT the file has no FAT chain, the cluster of the file offset is computed
+ * without the FAT reads
+ */
+static bool benchContiguous(void)
+{
+    SdCardSimStatistic statistic;
+    uint64_t startNs;
+    uint32_t lcg = 12345;
+    UINT bw;
+    bool result;
+
+    result = f_open(&file, "video.bin", FA_READ | FA_WRITE | FA_CREATE_ALWAYS) == FR_OK
+             && f_expand(&file, FAT_BENCH_FRAG_FILE_SIZE, 1) == FR_OK;
+    for (uint32_t pos = 0; pos < FAT_BENCH_FRAG_FILE_SIZE && result; pos += FAT_BENCH_MAX_CHUNK) {
+        for (uint32_t k = 0; k < FAT_BENCH_MAX_CHUNK; k++) {
+            benchBuff[k] = benchPattern(pos + k);
+        }
+        result = f_write(&file, benchBuff, FAT_BENCH_MAX_CHUNK, &bw) == FR_OK && bw == FAT_BENCH_MAX_CHUNK;
+    }
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    for (uint32_t k = 0; k < FAT_BENCH_SEEKS && result; k++) {
+        lcg = lcg * 1103515245 + 12345;
+        uint32_t pos = (lcg >> 8) % (FAT_BENCH_FRAG_FILE_SIZE - FAT_BENCH_SEEK_READ);
+        result = f_lseek(&file, pos) == FR_OK && f_read(&file, benchBuff, FAT_BENCH_SEEK_READ, &bw) == FR_OK
+                 && bw == FAT_BENCH_SEEK_READ;
+        for (uint32_t i = 0; i < FAT_BENCH_SEEK_READ && result; i++) {
+            result = benchBuff[i] == benchPattern(pos + i);
+        }
+    }
+    uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+    sdCardSimGetStatistic(&statistic);
+    result = f_close(&file) == FR_OK && result;
+    if (result) {
+        PRINT_LOG("seek contiguous: %8.1f us/seek, cmd %5u, blocks %5u\n", timeNs / 1e3 / FAT_BENCH_SEEKS,
+                  (unsigned int)(statistic.readCommands + statistic.writeCommands),
+                  (unsigned int)(statistic.blocksRead + statistic.blocksWritten));
+    }
+
+    return result;
+}
+
+static bool benchPoolPass(FIL *files, bool write, uint32_t active)
+{
+    SdCardSimStatistic statistic;
+    uint8_t buff[FAT_BENCH_POOL_CHUNK];
+    char name[16];
+    uint64_t startNs;
+    UINT bx;
+    bool result = true;
+
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    for (uint32_t k = 0; k < FAT_BENCH_POOL_FILES && result; k++) {
+        snprintf(name, sizeof(name), "pool%u.bin", (unsigned int)k);
+        result = f_open(&files[k], name, write ? FA_WRITE | FA_CREATE_ALWAYS : FA_READ) == FR_OK;
+    }
+    // All the files are open, the records of the active files are interleaved, every access is the partial
+    // sector of the other file
+    for (uint32_t first = 0; first < FAT_BENCH_POOL_FILES && result; first += active) {
+        for (uint32_t pos = 0; pos < FAT_BENCH_POOL_FILE_SIZE && result; pos += FAT_BENCH_POOL_CHUNK) {
+            uint32_t chunk = FAT_BENCH_POOL_FILE_SIZE - pos < FAT_BENCH_POOL_CHUNK
+                             ? FAT_BENCH_POOL_FILE_SIZE - pos : FAT_BENCH_POOL_CHUNK;
+            for (uint32_t k = first; k < first + active && result; k++) {
+                if (write) {
+                    for (uint32_t i = 0; i < chunk; i++) {
+                        buff[i] = benchPattern(pos + i + k * 7919);
+                    }
+                    result = f_write(&files[k], buff, chunk, &bx) == FR_OK && bx == chunk;
+                } else {
+                    result = f_read(&files[k], buff, chunk, &bx) == FR_OK && bx == chunk;
+                    for (uint32_t i = 0; i < chunk && result; i++) {
+                        result = buff[i] == benchPattern(pos + i + k * 7919);
+                    }
+                }
+            }
+        }
+    }
+    for (uint32_t k = 0; k < FAT_BENCH_POOL_FILES; k++) {
+        result = f_close(&files[k]) == FR_OK && result;
+    }
+    uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+    sdCardSimGetStatistic(&statistic);
+    if (result) {
+        PRINT_LOG("%-5s %2u of %u files interleaved: %8.1f KB/s, read blocks %5u, write blocks %5u\n",
+                  write ? "write" : "read", (unsigned int)active, FAT_BENCH_POOL_FILES,
+                  FAT_BENCH_POOL_FILES * FAT_BENCH_POOL_FILE_SIZE / 1024.0 / (timeNs / 1e9),
+                  (unsigned int)statistic.blocksRead, (unsigned int)statistic.blocksWritten);
+    }
+
+    return result;
+}
+
+/*
+ * The open files share the sector buffer pool of the volume, the buffers are
+ * reclaimed by the least recently used file
+ */
+static bool benchBufPool(void)
+{
+    static FIL files[FAT_BENCH_POOL_FILES];
+    bool result;
+
+#if FF_FS_BUFPOOL
+    PRINT_LOG("buffer pool: FIL %u bytes, %u open files with the pool of %u sectors %u bytes\n",
+              (unsigned int)sizeof(FIL), FAT_BENCH_POOL_FILES, FF_FS_BUFPOOL,
+              (unsigned int)(FAT_BENCH_POOL_FILES * sizeof(FIL) + FF_FS_BUFPOOL * FF_MAX_SS));
+#endif
+    result = benchPoolPass(files, true, 4) && benchPoolPass(files, false, 4)
+             && benchPoolPass(files, true, FAT_BENCH_POOL_FILES) && benchPoolPass(files, false, FAT_BENCH_POOL_FILES);
+#if FF_FS_BUFPOOL
+    // The closed files return the buffers, the pool does not refer to them
+    for (uint32_t k = 0; k < FF_FS_BUFPOOL && result; k++) {
+        result = fatFs.bp_owner[k] == NULL;
+    }
+#endif
+    if (!result) {
+        PRINT_LOG("%s\n", "Buffer pool ERROR");
+    }
+
+    return result;
+}
+
+/*
+ * The mount and the first file opens after the card attach, as after the power on
+ */
+static bool benchBoot(const char *name)
+{
+    SdCardSimStatistic statistic;
+    uint64_t startNs;
+    UINT br;
+    bool result;
+
+    f_mount(NULL, "", 0);
+    disk_attach_sdspi(0, benchSdSpiCb);
+    sdCardSimResetStatistic();
+    startNs = sdCardSimGetTimeNs();
+    result = f_mount(&fatFs, "", 1) == FR_OK
+             && f_open(&file, "logs/L0005.TXT", FA_READ) == FR_OK && f_close(&file) == FR_OK
+             && f_open(&file, "bench.bin", FA_READ) == FR_OK
+             && f_read(&file, benchBuff, FAT_BENCH_SEEK_READ, &br) == FR_OK && br == FAT_BENCH_SEEK_READ;
+    result = f_close(&file) == FR_OK && result;
+    for (uint32_t k = 0; k < FAT_BENCH_SEEK_READ && result; k++) {
+        result = benchBuff[k] == benchPattern(k);
+    }
+    uint64_t timeNs = sdCardSimGetTimeNs() - startNs;
+    sdCardSimGetStatistic(&statistic);
+    if (result) {
+        PRINT_LOG("boot %-8s: %8.1f us to the first file read, read cmd %3u, blocks %3u\n", name, timeNs / 1e3,
+                  (unsigned int)statistic.readCommands, (unsigned int)statistic.blocksRead);
+    }
+
+    return result;
+}
+
+/*
+ * The sectors read after the mount are saved as the profile on the shutdown and
+ * prefetched by the sorted multiple block reads on the next boot
+ */
+static bool benchMountProfile(void)
+{
+    static BYTE zero[FF_MAX_SS];
+    bool result;
+
+    // Clear the profile sector of the diskio.c left by the previous volume
+    result = disk_write(0, zero, 1, 1) == RES_OK && benchBoot("cold") && disk_ioctl(0, CTRL_SAVE_PROFILE, NULL) == RES_OK
+             && benchBoot("profiled");
+    if (!result) {
+        PRINT_LOG("%s\n", "Mount profile ERROR");
+    }
+
+    return result;
+}
+
+/*
+ * The format by the SD card geometry. The partition, the FAT and the data area
+ * start on the boundary of the SD Association parameters, the file is written
+ * and read back on the formated volume
+ */
+static bool benchSdFormat(void)
+{
+    static BYTE work[FF_MAX_SS];
+    SdFormatParam param;
+    FRESULT fatResult;
+    bool result;
+
+    fatResult = sdFormat("", 0, work, sizeof(work));
+    if (fatResult == FR_OK) {
+        fatResult = sdFormatGetParam(0, &param);
+    }
+    if (fatResult == FR_OK) {
+        fatResult = f_mount(&fatFs, "", 1);
+    }
+    PRINT_LOG("SD format result: %u\n", fatResult);
+    if (fatResult != FR_OK) {
+        return false;
+    }
+    result = fatFs.volbase % param.boundary == 0 && fatFs.fatbase % param.boundary == 0
+             && fatFs.database % param.boundary == 0;
+    PRINT_LOG("SD format: type %u, cluster %u bytes, boundary %u sectors, partition %u, FAT %u, data %u, %s\n",
+              fatFs.fs_type, (unsigned int)(fatFs.csize * FF_MAX_SS), (unsigned int)param.boundary,
+              (unsigned int)fatFs.volbase, (unsigned int)fatFs.fatbase, (unsigned int)fatFs.database,
+              result ? "aligned" : "NOT aligned");
+    result = result && benchWrite(FAT_BENCH_MAX_CHUNK) && benchRead(FAT_BENCH_MAX_CHUNK);
+    f_mount(NULL, "", 0);
+
+    return result;
+}
+
+/*
+ * The calibration of the SdSpi handler on the simulated card. The short busy of the
+ * simulated card keeps the specification timeouts, the stalled write raises them
+ */
+static bool benchCalibrate(void)
+{
+    static SdSpiH handler;
+    SdSpiCalibration calibration = {
+        .scratchAddress = FAT_BENCH_SCRATCH_BLOCK,
+        .scratchBlocks = FAT_BENCH_MAX_CHUNK / 512,
+        .buff = benchBuff,
+        .sckFrq = {1000000, 10000000, 25000000},
+        .sckFrqNumber = 3,
+    };
+    SdSpiTiming spec;
+    SdSpiTiming timing;
+    bool result;
+
+    result = sdSpiInit(&handler, benchSdSpiCb) == SD_SPI_RESULT_OK && sdSpiGetTiming(&handler, &spec) == SD_SPI_RESULT_OK
+             && spec.busyTimeoutMs >= 250 && spec.dataTokenBytes >= spec.sckFrq / 8 / 10
+             && sdSpiCalibrate(&handler, &calibration) == SD_SPI_RESULT_OK
+             && sdSpiGetTiming(&handler, &timing) == SD_SPI_RESULT_OK
+             && timing.sckFrq == 25000000 && timing.busyTimeoutMs >= 250
+             && timing.dataTokenBytes >= timing.sckFrq / 8 / 10 && spec.transferBlocks == 1
+             && timing.transferBlocks > 1 && timing.transferBlocks <= calibration.scratchBlocks;
+    if (result) {
+        PRINT_LOG("calibration: sck %u Hz, chunk %u blocks, %u B/s, busy max %u ms, timeout %u ms, "
+                  "data token %u bytes\n", (unsigned int)timing.sckFrq, (unsigned int)timing.transferBlocks,
+                  (unsigned int)timing.throughput, (unsigned int)timing.busyMaxMs, (unsigned int)timing.busyTimeoutMs,
+                  (unsigned int)timing.dataTokenBytes);
+    }
+    calibration.sckFrq[0] = 25000000;
+    calibration.sckFrqNumber = 1;
+    result = result
+             && sdCardSimInjectFault(SD_CARD_SIM_FAULT_WRITE_STALL, FAT_BENCH_SCRATCH_BLOCK,
+                                     FAT_BENCH_CALIBRATION_STALL_MS)
+             && sdSpiCalibrate(&handler, &calibration) == SD_SPI_RESULT_OK
+             && sdSpiGetTiming(&handler, &timing) == SD_SPI_RESULT_OK
+             && timing.busyMaxMs >= FAT_BENCH_CALIBRATION_STALL_MS && timing.busyTimeoutMs >= timing.busyMaxMs * 4;
+    PRINT_LOG("calibration with the %u ms stall: busy max %u ms, timeout %u ms, %s\n",
+              FAT_BENCH_CALIBRATION_STALL_MS, (unsigned int)timing.busyMaxMs, (unsigned int)timing.busyTimeoutMs,
+              result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+/*
+ * All the benchmarks on the volume of the format
+ */
+static FRESULT benchVolume(const char *name, BYTE fmt)
+{
+    static const uint32_t chunks[] = {512, 4096, FAT_BENCH_MAX_CHUNK};
+    static BYTE work[FF_MAX_SS];
+    MKFS_PARM format = {.fmt = fmt};
+    FRESULT fatResult;
+
+    fatResult = f_mkfs("", &format, work, sizeof(work));
+    PRINT_LOG("%s format result: %u\n", name, fatResult);
+    if (fatResult == FR_OK) {
+        fatResult = f_mount(&fatFs, "", 1);
+        PRINT_LOG("Mount result: %u, cluster %u bytes, FATFS %u bytes\n", fatResult,
+                  (unsigned int)(fatFs.csize * FF_MAX_SS), (unsigned int)sizeof(FATFS));
+    }
+
+    for (uint32_t k = 0; k < sizeof(chunks) / sizeof(chunks[0]) && fatResult == FR_OK; k++) {
+        if (!benchWrite(chunks[k]) || !benchRead(chunks[k])) {
+            PRINT_LOG("Chunk %u: write/read ERROR\n", (unsigned int)chunks[k]);
+            fatResult = FR_DISK_ERR;
+        }
+    }
+
+    if (fatResult == FR_OK && !benchReadMeta(512)) {
+        PRINT_LOG("%s\n", "Read with the metadata ERROR");
+        fatResult = FR_DISK_ERR;
+    }
+
+    if (fatResult == FR_OK && !benchStream()) {
+        fatResult = FR_DISK_ERR;
+    }
+
+    if (fatResult == FR_OK && !benchTasks()) {
+        fatResult = FR_DISK_ERR;
+    }
+
+    if (fatResult == FR_OK && (!benchFragmented() || !benchSeek(false) || !benchSeek(true)
+                               || !benchSeekGrow() || !benchContiguous())) {
+        PRINT_LOG("%s\n", "Fragmented file seek ERROR");
+        fatResult = FR_DISK_ERR;
+    }
+
+    // The free cluster summary is of the FAT, the exFAT allocation uses the bitmap
+    if (fatResult == FR_OK && (!benchRawLog() || !benchLazySync()
+                               || !benchLogger() || !benchLogCompress() || (fatFs.fs_type != FS_EXFAT && !benchFreeMap())
+                               || !benchDirIndex() || !benchFatCache() || !benchBufPool() || !benchMountProfile())) {
+        fatResult = FR_DISK_ERR;
+    }
+
+    f_mount(NULL, "", 0);
+
+    return fatResult;
+}
+
+int main(void)
+{
+    SdCardSimConfig config = {
+        .blockCount = FAT_BENCH_BLOCK_COUNT,
+        .maxSckFrq = 25000000,
+        .callOverheadNs = 2000,
+        .readLatencyUs = 100,
+        .writeBusyUs = 250,
+        .stopBusyUs = 500,
+        .eraseBusyUs = 2000,
+        .erasedToZero = true,
+        .auSize = 9,
+    };
+    SdSpiCb sdSpiCb = {
+        .sdSpiSend = benchBusSend,
+        .sdSpiReceive = benchBusReceive,
+        .sdSpiSetCsState = sdCardSimSetCsState,
+        .sdSpiSetSckFrq = sdCardSimSetSckFrq,
+        .sdSpiGetTimeMs = sdCardSimGetTimeMs,
+        .sdSpiMalloc = sdSpiMallocCb,
+        .sdSpiBusLock = ff_bus_lock,
+    };
+    FRESULT fatResult;
+
+    if (!sdCardSimInit(FAT_BENCH_IMAGE, &config)) {
+        PRINT_LOG("Image %s open error\n", FAT_BENCH_IMAGE);
+        return 1;
+    }
+    disk_attach_sdspi(0, &sdSpiCb);
+    benchSdSpiCb = &sdSpiCb;
+
+    fatResult = benchCalibrate() ? FR_OK : FR_DISK_ERR;
+    if (fatResult == FR_OK) {
+        fatResult = benchVolume("FAT", FM_ANY);
+    }
+#if FF_FS_EXFAT
+    if (fatResult == FR_OK) {
+        fatResult = benchVolume("exFAT", FM_EXFAT);
+    }
+#endif
+    if (fatResult == FR_OK && !benchSdFormat()) {
+        fatResult = FR_DISK_ERR;
+    }
+    // The 12 MB AU, the format is aligned by its 4 MB divisor
+    if (fatResult == FR_OK) {
+        sdCardSimDeinit();
+        config.auSize = 11;
+        fatResult = sdCardSimInit(FAT_BENCH_IMAGE, &config) && benchSdFormat() ? FR_OK : FR_DISK_ERR;
+    }
+
+    sdCardSimDeinit();
+
+    return fatResult == FR_OK ? 0 : 1;
+}
@@ -0,0 +1,316 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "RingBuff.h"
+
+/*
+ * The stress test of the lock-free rings on the POSIX threads. The producer and the
+ * consumer threads run concurrently on the several host cores, or are preempted at any
+ * point on the single core. The data is the position pattern, so the lost, repeated or
+ * overwritten byte is found by the consumer.
+ */
+
+#define RING_BUFF_TEST_SIZE          4096
+#define RING_BUFF_TEST_SPSC_BYTES    (16u * 1024 * 1024)
+#define RING_BUFF_TEST_SPSC_CHUNK    700
+#define RING_BUFF_TEST_SPSC_READ     333
+#define RING_BUFF_TEST_PRODUCERS     3
+#define RING_BUFF_TEST_RECORDS       200000 // per producer
+#define RING_BUFF_TEST_RECORD_MIN    5      // the producer and the sequence number
+#define RING_BUFF_TEST_RECORD_MAX    64
+#define RING_BUFF_TEST_BIP_BYTES     (16u * 1024 * 1024)
+#define RING_BUFF_TEST_BIP_RESERVE   700
+#define RING_BUFF_TEST_UNIT          512
+
+#define PRINT_LOG(FORMAT, ...)    printf(FORMAT, __VA_ARGS__)
+
+static uint8_t ringBuffTestPattern(uint32_t pos)
+{
+    return (uint8_t)(pos * 7 + (pos >> 11));
+}
+
+static RingBuffSpscH spsc;
+static uint8_t spscBuff[RING_BUFF_TEST_SIZE];
+
+// The producer writes in place by the chunks up to the free space
+static void *ringBuffTestSpscProducer(void *arg)
+{
+    uint32_t pos = 0;
+    uint32_t size;
+    uint8_t *data;
+
+    (void)arg;
+    while (pos < RING_BUFF_TEST_SPSC_BYTES) {
+        size = ringBuffSpscReserve(&spsc, &data);
+        size = size < RING_BUFF_TEST_SPSC_BYTES - pos ? size : RING_BUFF_TEST_SPSC_BYTES - pos;
+        size = size < RING_BUFF_TEST_SPSC_CHUNK ? size : RING_BUFF_TEST_SPSC_CHUNK;
+        if (size == 0) {
+            sched_yield();
+            continue;
+        }
+        for (uint32_t k = 0; k < size; k++) {
+            data[k] = ringBuffTestPattern(pos + k);
+        }
+        ringBuffSpscCommit(&spsc, size);
+        pos += size;
+    }
+
+    return NULL;
+}
+
+/*
+ * The consumer reads by the copy and in place in turn, the copy crosses the buffer
+ * end, the in place read ends on it
+ */
+static bool ringBuffTestSpsc(void)
+{
+    pthread_t producer;
+    uint8_t copy[RING_BUFF_TEST_SPSC_READ];
+    const uint8_t *data;
+    uint32_t pos = 0;
+    uint32_t errors = 0;
+    uint32_t size;
+    bool result;
+
+    result = ringBuffSpscInit(&spsc, spscBuff, sizeof(spscBuff)) == RING_BUFF_OK
+             && pthread_create(&producer, NULL, ringBuffTestSpscProducer, NULL) == 0;
+    while (result && pos < RING_BUFF_TEST_SPSC_BYTES) {
+        if (pos & 1) {
+            size = ringBuffSpscRead(&spsc, copy, sizeof(copy));
+            data = copy;
+        } else {
+            size = ringBuffSpscPeek(&spsc, &data);
+        }
+        if (size == 0) {
+            sched_yield();
+            continue;
+        }
+        for (uint32_t k = 0; k < size; k++) {
+            errors += data[k] != ringBuffTestPattern(pos + k);
+        }
+        if (data != copy) {
+            result = ringBuffSpscRelease(&spsc, size) == RING_BUFF_OK;
+        }
+        pos += size;
+    }
+    result = pthread_join(producer, NULL) == 0 && result && errors == 0 && ringBuffSpscGetUsed(&spsc) == 0;
+    PRINT_LOG("SPSC ring, %u MB: %s\n", (unsigned int)(RING_BUFF_TEST_SPSC_BYTES >> 20), result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+static RingBuffMpscH mpsc;
+static uint32_t mpscBuff[RING_BUFF_TEST_SIZE / sizeof(uint32_t)];
+
+static uint32_t ringBuffTestRecordSize(uint32_t producer, uint32_t seq)
+{
+    return RING_BUFF_TEST_RECORD_MIN
+           + (seq * 13 + producer) % (RING_BUFF_TEST_RECORD_MAX - RING_BUFF_TEST_RECORD_MIN + 1);
+}
+
+/*
+ * The producers push the records of the varied sizes by the copy and by the in place
+ * write in turn, the record of the full ring is retried. The commit of some in place
+ * records is delayed, so the other producers claim the space after them
+ */
+static void *ringBuffTestMpscProducer(void *arg)
+{
+    uint32_t producer = (uint32_t)(uintptr_t)arg;
+    uint8_t record[RING_BUFF_TEST_RECORD_MAX];
+    uint32_t size;
+    uint8_t *data;
+
+    for (uint32_t seq = 0; seq < RING_BUFF_TEST_RECORDS;) {
+        size = ringBuffTestRecordSize(producer, seq);
+        record[0] = (uint8_t)producer;
+        memcpy(&record[1], &seq, sizeof(seq));
+        for (uint32_t k = RING_BUFF_TEST_RECORD_MIN; k < size; k++) {
+            record[k] = ringBuffTestPattern(seq + k);
+        }
+        if (seq & 1) {
+            if (ringBuffMpscPush(&mpsc, record, size) != RING_BUFF_OK) {
+                sched_yield();
+                continue;
+            }
+        } else {
+            if (ringBuffMpscReserve(&mpsc, size, &data) != RING_BUFF_OK) {
+                sched_yield();
+                continue;
+            }
+            memcpy(data, record, size);
+            // The producer is preempted before the commit, the consumer stops on the record
+            if (seq % 64 == 0) {
+                sched_yield();
+            }
+            ringBuffMpscCommit(&mpsc, data);
+        }
+        seq++;
+    }
+
+    return NULL;
+}
+
+/*
+ * The records of each producer are consumed in its order without the loss, the
+ * records of the different producers are interleaved
+ */
+static bool ringBuffTestMpsc(void)
+{
+    pthread_t producers[RING_BUFF_TEST_PRODUCERS];
+    uint32_t next[RING_BUFF_TEST_PRODUCERS] = {0};
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    uint32_t started = 0;
+    uint32_t producer;
+    uint32_t seq;
+    uint32_t size;
+    const uint8_t *data;
+    bool result;
+
+    result = ringBuffMpscInit(&mpsc, (uint8_t *)mpscBuff, sizeof(mpscBuff)) == RING_BUFF_OK;
+    for (; started < RING_BUFF_TEST_PRODUCERS && result; started++) {
+        result = pthread_create(&producers[started], NULL, ringBuffTestMpscProducer,
+                                (void *)(uintptr_t)started) == 0;
+    }
+    while (result && received < RING_BUFF_TEST_PRODUCERS * RING_BUFF_TEST_RECORDS) {
+        size = ringBuffMpscPeek(&mpsc, &data);
+        if (size == 0) {
+            sched_yield();
+            continue;
+        }
+        producer = data[0];
+        memcpy(&seq, &data[1], sizeof(seq));
+        if (producer >= RING_BUFF_TEST_PRODUCERS || seq != next[producer]
+            || size != ringBuffTestRecordSize(producer, seq)) {
+            errors++;
+            result = false;
+            break;
+        }
+        for (uint32_t k = RING_BUFF_TEST_RECORD_MIN; k < size; k++) {
+            errors += data[k] != ringBuffTestPattern(seq + k);
+        }
+        ringBuffMpscRelease(&mpsc);
+        next[producer]++;
+        received++;
+    }
+    for (uint32_t k = 0; k < started; k++) {
+        // The failed consumer does not wait for the producers blocked on the full ring
+        if (result) {
+            pthread_join(producers[k], NULL);
+        } else {
+            pthread_detach(producers[k]);
+        }
+    }
+    result = result && errors == 0 && ringBuffMpscGetUsed(&mpsc) == 0;
+    PRINT_LOG("MPSC ring, %u producers, %u records: %s\n", RING_BUFF_TEST_PRODUCERS,
+              (unsigned int)received, result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+// The units test does not share the buffer with the producer left by the failed test
+static RingBuffBipH bip[2];
+static uint8_t bipBuff[2][RING_BUFF_TEST_SIZE];
+
+/*
+ * The producer reserves the region of the random size and commits its random part,
+ * or reserves and commits the whole units
+ */
+static void *ringBuffTestBipProducer(void *arg)
+{
+    bool units = (uintptr_t)arg != 0;
+    RingBuffBipH *ring = &bip[units];
+    unsigned int seed = 1;
+    uint32_t pos = 0;
+    uint32_t size;
+    uint32_t written;
+    uint8_t *data;
+
+    while (pos < RING_BUFF_TEST_BIP_BYTES) {
+        if (units) {
+            size = ringBuffBipReserveUnits(ring, RING_BUFF_TEST_UNIT, &data);
+            written = size != 0 ? (rand_r(&seed) % (size / RING_BUFF_TEST_UNIT) + 1) * RING_BUFF_TEST_UNIT : 0;
+        } else {
+            size = rand_r(&seed) % RING_BUFF_TEST_BIP_RESERVE + 1;
+            size = ringBuffBipReserve(ring, size, &data) == RING_BUFF_OK ? size : 0;
+            written = size != 0 ? rand_r(&seed) % size + 1 : 0;
+        }
+        if (size == 0) {
+            sched_yield();
+            continue;
+        }
+        for (uint32_t k = 0; k < written; k++) {
+            data[k] = ringBuffTestPattern(pos + k);
+        }
+        ringBuffBipCommit(ring, written);
+        pos += written;
+    }
+
+    return NULL;
+}
+
+/*
+ * The consumer releases the random part of the peeked data. In the units mode it gets
+ * the whole units only and releases all of them
+ */
+static bool ringBuffTestBip(bool units)
+{
+    RingBuffBipH *ring = &bip[units];
+    pthread_t producer;
+    unsigned int seed = 7;
+    const uint8_t *data;
+    const uint8_t *unitData;
+    uint32_t pos = 0;
+    uint32_t errors = 0;
+    uint32_t size;
+    uint32_t read;
+    bool result;
+
+    result = ringBuffBipInit(ring, bipBuff[units], sizeof(bipBuff[units])) == RING_BUFF_OK
+             && pthread_create(&producer, NULL, ringBuffTestBipProducer, (void *)(uintptr_t)units) == 0;
+    while (result && pos < RING_BUFF_TEST_BIP_BYTES) {
+        size = ringBuffBipPeek(ring, &data);
+        if (size == 0) {
+            sched_yield();
+            continue;
+        }
+        if (units) {
+            result = size % RING_BUFF_TEST_UNIT == 0
+                     && ringBuffBipPeekUnits(ring, RING_BUFF_TEST_UNIT, &unitData) == size && unitData == data;
+            read = size;
+        } else {
+            read = rand_r(&seed) % size + 1;
+        }
+        for (uint32_t k = 0; k < read; k++) {
+            errors += data[k] != ringBuffTestPattern(pos + k);
+        }
+        result = result && errors == 0 && ringBuffBipRelease(ring, read) == RING_BUFF_OK;
+        pos += read;
+    }
+    if (result) {
+        pthread_join(producer, NULL);
+    } else {
+        pthread_detach(producer);
+    }
+    PRINT_LOG("bip-buffer%s, %u MB: %s\n", units ? " by the units" : "", (unsigned int)(RING_BUFF_TEST_BIP_BYTES >> 20),
+              result ? "Ok" : "ERROR");
+
+    return result;
+}
+
+int main(void)
+{
+    bool result;
+
+    result = ringBuffTestSpsc();
+    result = ringBuffTestMpsc() && result;
+    result = ringBuffTestBip(false) && result;
+    result = ringBuffTestBip(true) && result;
+
+    return result ? 0 : 1;
+}
@@ -0,0 +1,590 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "SdSpiInternal.h"
+#include "SdCardSim.h"
+
+#define SD_CARD_SIM_BLOCK_SIZE        512
+#define SD_CARD_SIM_OUT_BUFF_SIZE     1024
+#define SD_CARD_SIM_INIT_CMD41_CNT    3
+#define SD_CARD_SIM_POLL_NS           100
+#define SD_CARD_SIM_ERROR_TOKEN       0x08 // out of range bit of the error token
+#define SD_CARD_SIM_DATA_ACCEPTED     (0xE0 | SD_WRITE_DATA_RESPONSE_ACCEPTED)
+#define SD_CARD_SIM_DATA_WRITE_ERROR  (0xE0 | SD_WRITE_DATA_RESPONSE_WRIRTE_ERROR)
+
+typedef enum {
+    SIM_STATE_IDLE,
+    SIM_STATE_READ_SINGLE,
+    SIM_STATE_READ_MULTI,
+    SIM_STATE_WRITE_SINGLE,
+    SIM_STATE_WRITE_MULTI,
+    SIM_STATE_WRITE_DATA,
+} SimState;
+
+static struct {
+    FILE *image;
+    SdCardSimConfig config;
+    SdCardSimStatistic statistic;
+    uint64_t timeNs;
+    uint32_t sckFrq;
+    bool selected;
+    bool idle;
+    bool app;
+    uint32_t cmd41Cnt;
+    uint8_t cmd[sizeof(SdReqLayout)];
+    uint32_t cmdLen;
+    SimState state;
+    SimState writeState;
+    uint32_t block;
+    uint32_t wellWritten;
+    uint64_t readyAtNs;
+    uint64_t busyUntilNs;
+    uint8_t data[SD_CARD_SIM_BLOCK_SIZE + SD_DATA_PACKET_CRC_SIZE];
+    uint32_t dataLen;
+    uint32_t eraseStart;
+    uint32_t eraseEnd;
+    uint8_t out[SD_CARD_SIM_OUT_BUFF_SIZE];
+    uint32_t outHead;
+    uint32_t outTail;
+    struct {
+        bool active;
+        SdCardSimFault fault;
+        uint32_t block;
+        uint32_t stallMs;
+    } faults[SD_CARD_SIM_MAX_FAULTS];
+} sim;
+
+/*
+ * Set the field of the register in the transmission order: the bit N of the
+ * register is the bit (N % 8) of the byte (size - 1 - N / 8)
+ */
+static void simSetBits(uint8_t *reg, uint32_t regSize, uint32_t pos, uint32_t width, uint32_t value)
+{
+    for (uint32_t k = 0; k < width; k++, pos++) {
+        uint8_t *byte = &reg[regSize - 1 - pos / 8];
+
+        if (value & (1u << k)) {
+            *byte |= 1 << (pos % 8);
+        } else {
+            *byte &= ~(1 << (pos % 8));
+        }
+    }
+}
+
+static void simAdvance(uint32_t bytes)
+{
+    sim.timeNs += (uint64_t)bytes * 8 * 1000000000u / sim.sckFrq;
+    sim.statistic.busBytes += bytes;
+}
+
+static void simPush(uint8_t byte)
+{
+    sim.out[sim.outTail++ % SD_CARD_SIM_OUT_BUFF_SIZE] = byte;
+}
+
+static void simPushBuff(const uint8_t *buff, uint32_t buffSize)
+{
+    for (uint32_t k = 0; k < buffSize; k++) {
+        simPush(buff[k]);
+    }
+}
+
+/*
+ * Data packet: Nac byte, the data token, the data and the CRC (not calculated)
+ */
+static void simPushDataPacket(const uint8_t *buff, uint32_t buffSize)
+{
+    simPush(0xFF);
+    simPush(SD_TOKEN_DATA_17_18_24);
+    simPushBuff(buff, buffSize);
+    simPush(0x00);
+    simPush(0x00);
+}
+
+static void simSetBusy(uint64_t busyNs)
+{
+    uint64_t start = sim.busyUntilNs > sim.timeNs ? sim.busyUntilNs : sim.timeNs;
+
+    sim.busyUntilNs = start + busyNs;
+    sim.statistic.busyNs += busyNs;
+}
+
+static bool simTakeFault(SdCardSimFault fault, uint32_t block, uint32_t *stallMs)
+{
+    for (uint32_t k = 0; k < SD_CARD_SIM_MAX_FAULTS; k++) {
+        if (sim.faults[k].active && sim.faults[k].fault == fault && sim.faults[k].block == block) {
+            sim.faults[k].active = false;
+            if (stallMs != NULL) {
+                *stallMs = sim.faults[k].stallMs;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void simImageRead(uint32_t block, uint8_t *buff)
+{
+    fseek(sim.image, (long)block * SD_CARD_SIM_BLOCK_SIZE, SEEK_SET);
+    if (fread(buff, 1, SD_CARD_SIM_BLOCK_SIZE, sim.image) != SD_CARD_SIM_BLOCK_SIZE) {
+        memset(buff, 0, SD_CARD_SIM_BLOCK_SIZE);
+    }
+}
+
+static void simImageWrite(uint32_t block, const uint8_t *buff)
+{
+    fseek(sim.image, (long)block * SD_CARD_SIM_BLOCK_SIZE, SEEK_SET);
+    fwrite(buff, 1, SD_CARD_SIM_BLOCK_SIZE, sim.image);
+}
+
+static void simPushCsd(void)
+{
+    uint8_t csd[SD_SPI_CSD_BYTES] = {0};
+
+    /*
+     * CSD Version 2.0, the capacity is (C_SIZE + 1) * 512 KB
+     */
+    simSetBits(csd, sizeof(csd), 126, 2, 1);                             // CSD_STRUCTURE
+    simSetBits(csd, sizeof(csd), 112, 8, 0x0E);                          // TAAC
+    simSetBits(csd, sizeof(csd), 96, 8, 0x32);                           // TRAN_SPEED
+    simSetBits(csd, sizeof(csd), 84, 12, 0x5B5);                         // CCC
+    simSetBits(csd, sizeof(csd), 80, 4, 9);                              // READ_BL_LEN
+    simSetBits(csd, sizeof(csd), 48, 22, sim.config.blockCount / 1024 - 1); // C_SIZE
+    simSetBits(csd, sizeof(csd), 46, 1, 1);                              // ERASE_BLK_EN
+    simSetBits(csd, sizeof(csd), 39, 7, 0x7F);                           // SECTOR_SIZE
+    simSetBits(csd, sizeof(csd), 22, 4, 9);                              // WRITE_BL_LEN
+    simSetBits(csd, sizeof(csd), 0, 1, 1);
+    simPushDataPacket(csd, sizeof(csd));
+}
+
+static void simPushCid(void)
+{
+    uint8_t cid[SD_SPI_CID_BYTES] = {0x03, 'S', 'D', 'S', 'I', 'M', '0', '1', 0x10, 0, 0, 0, 1, 0x01, 0x4A, 0x01};
+
+    simPushDataPacket(cid, sizeof(cid));
+}
+
+static void simPushSdStatus(void)
+{
+    uint8_t sdStatus[SD_SPI_SD_STATUS_BYTES] = {0};
+
+    sdStatus[SD_STATUS_SPEED_CLASS_BYTE] = 4;                            // Class 10
+    sdStatus[SD_STATUS_AU_SIZE_BYTE] = sim.config.auSize << SD_STATUS_AU_SIZE_POS;
+    sdStatus[SD_STATUS_ERASE_SIZE_BYTE + 1] = sim.config.auSize != 0 ? 1 : 0;
+    sdStatus[SD_STATUS_ERASE_TIMEOUT_BYTE] = (1 << SD_STATUS_ERASE_TIMEOUT_POS)
+                                             | (1 << SD_STATUS_ERASE_OFFSET_POS);
+    simPushDataPacket(sdStatus, sizeof(sdStatus));
+}
+
+static void simPushScr(void)
+{
+    uint8_t scr[SD_SPI_SCR_BYTES] = {0x02, 0x05, 0x80, 0x00, 0, 0, 0, 0};
+
+    if (!sim.config.erasedToZero) {
+        scr[SD_SCR_DATA_STAT_AFTER_ERASE_BYTE] |= 1 << SD_SCR_DATA_STAT_AFTER_ERASE_POS;
+    }
+    simPushDataPacket(scr, sizeof(scr));
+}
+
+static void simErase(void)
+{
+    uint8_t buff[SD_CARD_SIM_BLOCK_SIZE];
+
+    memset(buff, sim.config.erasedToZero ? 0x00 : 0xFF, sizeof(buff));
+    for (uint32_t block = sim.eraseStart; block <= sim.eraseEnd && block < sim.config.blockCount; block++) {
+        simImageWrite(block, buff);
+    }
+}
+
+static void simExecuteCmd(void)
+{
+    uint32_t cmd = sim.cmd[0] & 0x3F;
+    uint32_t arg;
+    uint8_t r1;
+    bool app = sim.app;
+
+    arg = (sim.cmd[1] << 24) | (sim.cmd[2] << 16) | (sim.cmd[3] << 8) | sim.cmd[4];
+    sim.app = false;
+    sim.statistic.commands++;
+    r1 = sim.idle ? SD_R1_IDLE_STATE : 0;
+
+    /*
+     * Ncr: the response is after the one byte
+     */
+    sim.outHead = sim.outTail = 0;
+    simPush(0xFF);
+
+    switch (cmd) {
+    case SD_CMD0:
+        sim.idle = true;
+        sim.cmd41Cnt = 0;
+        sim.state = SIM_STATE_IDLE;
+        simPush(SD_R1_IDLE_STATE);
+        break;
+
+    case SD_CMD8:
+        simPush(r1);
+        simPush(0x00);
+        simPush(0x00);
+        simPush((arg >> 8) & 0x0F);
+        simPush(arg & 0xFF);
+        break;
+
+    case SD_CMD55:
+        sim.app = true;
+        simPush(r1);
+        break;
+
+    case SD_CMD41:
+        if (!app) {
+            simPush(r1 | SD_R1_ILIGAL_COMMAND);
+            break;
+        }
+        if (++sim.cmd41Cnt >= SD_CARD_SIM_INIT_CMD41_CNT) {
+            sim.idle = false;
+        }
+        simPush(sim.idle ? SD_R1_IDLE_STATE : 0);
+        break;
+
+    case SD_CMD58:
+        simPush(r1);
+        simPush((1 << (SD_OCR_POWER_UP_POS - 24)) | (1 << (SD_OCR_CCS_POS - 24)));
+        simPush((1 << (SD_OCR_v_32_33_POS - 16)) | (1 << (SD_OCR_v_33_34_POS - 16)));
+        simPush(0x00);
+        simPush(0x00);
+        break;
+
+    case SD_CMD16:
+        simPush(r1);
+        break;
+
+    case SD_CMD9:
+        simPush(r1);
+        simPushCsd();
+        break;
+
+    case SD_CMD10:
+        simPush(r1);
+        simPushCid();
+        break;
+
+    case SD_CMD13:
+        simPush(r1);
+        simPush(0x00);
+        if (app) {
+            simPushSdStatus();
+        }
+        break;
+
+    case SD_CMD22:
+        if (!app) {
+            simPush(r1 | SD_R1_ILIGAL_COMMAND);
+            break;
+        }
+        simPush(r1);
+        {
+            uint8_t numWrBlocks[SD_NUM_WR_BLOCKS_BYTES];
+
+            numWrBlocks[0] = sim.wellWritten >> 24;
+            numWrBlocks[1] = sim.wellWritten >> 16;
+            numWrBlocks[2] = sim.wellWritten >> 8;
+            numWrBlocks[3] = sim.wellWritten;
+            simPushDataPacket(numWrBlocks, sizeof(numWrBlocks));
+        }
+        break;
+
+    case SD_CMD51:
+        if (!app) {
+            simPush(r1 | SD_R1_ILIGAL_COMMAND);
+            break;
+        }
+        simPush(r1);
+        simPushScr();
+        break;
+
+    case SD_CMD17:
+    case SD_CMD18:
+    case SD_CMD24:
+    case SD_CMD25:
+        if (arg >= sim.config.blockCount) {
+            simPush(r1 | SD_R1_PARAMETER_ERROR);
+            break;
+        }
+        simPush(r1);
+        sim.block = arg;
+        if (cmd == SD_CMD17 || cmd == SD_CMD18) {
+            sim.statistic.readCommands++;
+            sim.state = cmd == SD_CMD17 ? SIM_STATE_READ_SINGLE : SIM_STATE_READ_MULTI;
+            sim.readyAtNs = sim.timeNs + sim.config.readLatencyUs * 1000ull;
+        } else {
+            sim.statistic.writeCommands++;
+            sim.state = cmd == SD_CMD24 ? SIM_STATE_WRITE_SINGLE : SIM_STATE_WRITE_MULTI;
+            sim.wellWritten = 0;
+        }
+        break;
+
+    case SD_CMD12:
+        /*
+         * The stuff byte, R1 and the short busy
+         */
+        sim.state = SIM_STATE_IDLE;
+        simPush(r1);
+        simSetBusy(sim.config.stopBusyUs * 1000ull);
+        break;
+
+    case SD_CMD32:
+        sim.eraseStart = arg;
+        simPush(r1);
+        break;
+
+    case SD_CMD33:
+        sim.eraseEnd = arg;
+        simPush(r1);
+        break;
+
+    case SD_CMD38:
+        sim.statistic.eraseCommands++;
+        simPush(r1);
+        simErase();
+        simSetBusy(sim.config.eraseBusyUs * 1000ull);
+        break;
+
+    default:
+        simPush(r1 | SD_R1_ILIGAL_COMMAND);
+        break;
+    }
+}
+
+static void simWriteBlockDone(void)
+{
+    uint32_t stallMs = 0;
+
+    sim.state = sim.writeState;
+    if (simTakeFault(SD_CARD_SIM_FAULT_WRITE_ERROR, sim.block, NULL)) {
+        simPush(SD_CARD_SIM_DATA_WRITE_ERROR);
+        return;
+    }
+
+    simImageWrite(sim.block, sim.data);
+    simPush(SD_CARD_SIM_DATA_ACCEPTED);
+    simTakeFault(SD_CARD_SIM_FAULT_WRITE_STALL, sim.block, &stallMs);
+    simSetBusy(sim.config.writeBusyUs * 1000ull + stallMs * 1000000ull);
+    sim.statistic.blocksWritten++;
+    sim.wellWritten++;
+    sim.block++;
+    if (sim.state == SIM_STATE_WRITE_SINGLE) {
+        sim.state = SIM_STATE_IDLE;
+    }
+}
+
+/*
+ * The byte from the host
+ */
+static void simRxByte(uint8_t byte)
+{
+    if (sim.timeNs < sim.busyUntilNs) {
+        return;
+    }
+
+    switch (sim.state) {
+    case SIM_STATE_WRITE_DATA:
+        sim.data[sim.dataLen++] = byte;
+        if (sim.dataLen == sizeof(sim.data)) {
+            simWriteBlockDone();
+        }
+        return;
+
+    case SIM_STATE_WRITE_SINGLE:
+    case SIM_STATE_WRITE_MULTI:
+        if ((sim.state == SIM_STATE_WRITE_SINGLE && byte == SD_TOKEN_DATA_17_18_24)
+            || (sim.state == SIM_STATE_WRITE_MULTI && byte == SD_TOKEN_DATA_25)) {
+            sim.writeState = sim.state;
+            sim.state = SIM_STATE_WRITE_DATA;
+            sim.dataLen = 0;
+        } else if (sim.state == SIM_STATE_WRITE_MULTI && byte == SD_TOKEN_STOP_TRAN) {
+            sim.state = SIM_STATE_IDLE;
+            sim.outHead = sim.outTail = 0;
+            simPush(0xFF);
+            simSetBusy(sim.config.stopBusyUs * 1000ull);
+        }
+        return;
+
+    default:
+        break;
+    }
+
+    /*
+     * The command: the first byte starts from 0b01
+     */
+    if (sim.cmdLen == 0 && (byte & 0xC0) != 0x40) {
+        return;
+    }
+    sim.cmd[sim.cmdLen++] = byte;
+    if (sim.cmdLen == sizeof(sim.cmd)) {
+        sim.cmdLen = 0;
+        simExecuteCmd();
+    }
+}
+
+/*
+ * The byte to the host
+ */
+static uint8_t simTxByte(void)
+{
+    uint8_t buff[SD_CARD_SIM_BLOCK_SIZE];
+
+    if (sim.outHead != sim.outTail) {
+        return sim.out[sim.outHead++ % SD_CARD_SIM_OUT_BUFF_SIZE];
+    }
+    sim.outHead = sim.outTail = 0;
+
+    if (sim.timeNs < sim.busyUntilNs) {
+        return 0x00;
+    }
+
+    if ((sim.state == SIM_STATE_READ_SINGLE || sim.state == SIM_STATE_READ_MULTI)
+        && sim.timeNs >= sim.readyAtNs) {
+        if (sim.block >= sim.config.blockCount
+            || simTakeFault(SD_CARD_SIM_FAULT_READ_ERROR, sim.block, NULL)) {
+            sim.state = SIM_STATE_IDLE;
+            return SD_CARD_SIM_ERROR_TOKEN;
+        }
+        simImageRead(sim.block++, buff);
+        simPush(SD_TOKEN_DATA_17_18_24);
+        simPushBuff(buff, sizeof(buff));
+        simPush(0x00);
+        simPush(0x00);
+        sim.statistic.blocksRead++;
+        sim.readyAtNs = sim.timeNs + sim.config.readLatencyUs * 1000ull;
+        if (sim.state == SIM_STATE_READ_SINGLE) {
+            sim.state = SIM_STATE_IDLE;
+        }
+        return sim.out[sim.outHead++];
+    }
+
+    return 0xFF;
+}
+
+bool sdCardSimInit(const char *imagePath, const SdCardSimConfig *config)
+{
+    uint8_t zero = 0;
+
+    memset(&sim, 0, sizeof(sim));
+    if (config == NULL || config->blockCount == 0 || config->blockCount % 1024 != 0) {
+        return false;
+    }
+    sim.config = *config;
+    sim.sckFrq = SD_SPI_INITIAL_FRQ;
+
+    sim.image = fopen(imagePath, "r+b");
+    if (sim.image == NULL) {
+        sim.image = fopen(imagePath, "w+b");
+    }
+    if (sim.image == NULL) {
+        return false;
+    }
+
+    /*
+     * Extend the image up to the card capacity
+     */
+    fseek(sim.image, (long)config->blockCount * SD_CARD_SIM_BLOCK_SIZE - 1, SEEK_SET);
+    if (fread(&zero, 1, 1, sim.image) != 1) {
+        fseek(sim.image, (long)config->blockCount * SD_CARD_SIM_BLOCK_SIZE - 1, SEEK_SET);
+        fwrite(&zero, 1, 1, sim.image);
+    }
+
+    return true;
+}
+
+void sdCardSimDeinit(void)
+{
+    if (sim.image != NULL) {
+        fclose(sim.image);
+        sim.image = NULL;
+    }
+}
+
+bool sdCardSimSend(uint8_t *data, size_t dataLength)
+{
+    sim.timeNs += sim.config.callOverheadNs;
+    for (size_t k = 0; k < dataLength; k++) {
+        simAdvance(1);
+        if (sim.selected) {
+            simRxByte(data[k]);
+        }
+    }
+
+    return true;
+}
+
+bool sdCardSimReceive(uint8_t *data, size_t dataLength)
+{
+    sim.timeNs += sim.config.callOverheadNs;
+    for (size_t k = 0; k < dataLength; k++) {
+        simAdvance(1);
+        data[k] = sim.selected ? simTxByte() : 0xFF;
+    }
+
+    return true;
+}
+
+bool sdCardSimSetCsState(bool set)
+{
+    sim.selected = !set;
+    if (set) {
+        sim.cmdLen = 0;
+        sim.outHead = sim.outTail = 0;
+    }
+
+    return true;
+}
+
+bool sdCardSimSetSckFrq(uint32_t frq)
+{
+    if (frq == 0 || frq > sim.config.maxSckFrq) {
+        return false;
+    }
+    sim.sckFrq = frq;
+
+    return true;
+}
+
+uint32_t sdCardSimGetTimeMs(void)
+{
+    sim.timeNs += SD_CARD_SIM_POLL_NS;
+
+    return (uint32_t)(sim.timeNs / 1000000);
+}
+
+uint64_t sdCardSimGetTimeNs(void)
+{
+    return sim.timeNs;
+}
+
+void sdCardSimGetStatistic(SdCardSimStatistic *statistic)
+{
+    *statistic = sim.statistic;
+}
+
+void sdCardSimResetStatistic(void)
+{
+    memset(&sim.statistic, 0, sizeof(sim.statistic));
+}
+
+bool sdCardSimInjectFault(SdCardSimFault fault, uint32_t block, uint32_t stallMs)
+{
+    for (uint32_t k = 0; k < SD_CARD_SIM_MAX_FAULTS; k++) {
+        if (!sim.faults[k].active) {
+            sim.faults[k].active = true;
+            sim.faults[k].fault = fault;
+            sim.faults[k].block = block;
+            sim.faults[k].stallMs = stallMs;
+            return true;
+        }
+    }
+
+    return false;
+}
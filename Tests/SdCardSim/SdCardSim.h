@@ -0,0 +1,70 @@
+#ifndef __SD_CARD_SIM_H__
+#define __SD_CARD_SIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * SD card emulator on the SPI bus level for the host build. The card content is the
+ * image file, the time is simulated: every SPI byte takes 8 SCK periods, every bus
+ * callback call takes the callOverheadNs. The SdSpi callbacks are the sdCardSim* bus
+ * functions, so the simulated time is the time of the real bus at the same SCK.
+ */
+
+#define SD_CARD_SIM_MAX_FAULTS    8
+
+typedef enum {
+    SD_CARD_SIM_FAULT_READ_ERROR,  // the read of the block returns the error token
+    SD_CARD_SIM_FAULT_WRITE_ERROR, // the write of the block returns the write error response
+    SD_CARD_SIM_FAULT_WRITE_STALL, // the write of the block keeps the busy state stallMs
+} SdCardSimFault;
+
+typedef struct {
+    uint32_t blockCount;         // the card capacity, multiple of 1024 blocks
+    uint32_t maxSckFrq;
+    uint32_t callOverheadNs;     // time of the one bus callback call
+    uint32_t readLatencyUs;      // time up to the data token of the every read block
+    uint32_t writeBusyUs;        // busy time after the every written block
+    uint32_t stopBusyUs;         // busy time after the Stop Tran token and CMD12
+    uint32_t eraseBusyUs;
+    bool erasedToZero;
+    uint8_t auSize;              // the SD Status AU_SIZE code, 0 - not defined
+} SdCardSimConfig;
+
+typedef struct {
+    uint32_t commands;
+    uint32_t readCommands;       // CMD17 and CMD18
+    uint32_t writeCommands;      // CMD24 and CMD25
+    uint32_t eraseCommands;
+    uint32_t blocksRead;
+    uint32_t blocksWritten;
+    uint64_t busyNs;
+    uint64_t busBytes;
+} SdCardSimStatistic;
+
+bool sdCardSimInit(const char *imagePath, const SdCardSimConfig *config);
+void sdCardSimDeinit(void);
+
+/*
+ * The SdSpi bus callbacks
+ */
+bool sdCardSimSend(uint8_t *data, size_t dataLength);
+bool sdCardSimReceive(uint8_t *data, size_t dataLength);
+bool sdCardSimSetCsState(bool set);
+bool sdCardSimSetSckFrq(uint32_t frq);
+uint32_t sdCardSimGetTimeMs(void);
+
+/*
+ * The simulated time from the init
+ */
+uint64_t sdCardSimGetTimeNs(void);
+void sdCardSimGetStatistic(SdCardSimStatistic *statistic);
+void sdCardSimResetStatistic(void);
+
+/*
+ * The one-shot fault on the block access. Return false if all the fault slots are used
+ */
+bool sdCardSimInjectFault(SdCardSimFault fault, uint32_t block, uint32_t stallMs);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __DEBUG_SERVICES_H__
+#define __DEBUG_SERVICES_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/*
+ * Host build stub of the App/DebugServices: no debug pins and RTT
+ */
+
+typedef enum {
+    DebugPin1,
+    DebugPin2,
+    DebugPin3,
+    DebugPin4,
+    DebugPin5,
+    DebugPin6,
+    DebugPin7
+} ServicesPin;
+
+static inline void debugServicesPinSet(ServicesPin pin)
+{
+    (void)pin;
+}
+
+static inline void debugServicesPinClear(ServicesPin pin)
+{
+    (void)pin;
+}
+
+#endif